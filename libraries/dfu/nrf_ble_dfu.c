@@ -4,6 +4,14 @@
 #include "sdk_common.h"
 #include "nrf_dfu_req_handler.h"
 #include "nrf_dfu_transport.h"
+#include "nrf_dfu_page_writer.h"
+#include "nrf_dfu_types.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_dfu_settings_ext.h"
+#include "nrf_dfu_boot_trace.h"
+#include "nrf_dfu_crc32.h"
+#include "nrf_dfu_lzss.h"
+#include "nrf_dfu_delta.h"
 #include "nrf_dfu_mbr.h"
 #include "nrf_bootloader_info.h"
 #include "ble_conn_params.h"
@@ -24,6 +32,8 @@
 #define MIN_CONN_INTERVAL                    (uint16_t)(MSEC_TO_UNITS(15, UNIT_1_25_MS))            /**< Minimum acceptable connection interval. */
 #define MAX_CONN_INTERVAL_MS                 30                                                     /**< Maximum acceptable connection interval in milliseconds. */
 #define MAX_CONN_INTERVAL                    (uint16_t)(MSEC_TO_UNITS(MAX_CONN_INTERVAL_MS, UNIT_1_25_MS)) /**< Maximum acceptable connection interval . */
+#define FAST_MIN_CONN_INTERVAL               (uint16_t)(MSEC_TO_UNITS(7.5, UNIT_1_25_MS))           /**< Minimum connection interval requested while data objects are streaming. */
+#define FAST_MAX_CONN_INTERVAL               MIN_CONN_INTERVAL                                      /**< Maximum connection interval requested while data objects are streaming. */
 #define SLAVE_LATENCY                        0                                                      /**< Slave latency. */
 #define CONN_SUP_TIMEOUT                     (4 * 100)                                              /**< Connection supervisory timeout (4 seconds). */
 
@@ -33,38 +43,143 @@
 #define NEXT_CONN_PARAMS_UPDATE_DELAY        APP_TIMER_TICKS_COMPAT(500, APP_TIMER_PRESCALER)              /**< Time between each call to sd_ble_gap_conn_param_update after the first call (500 milliseconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT         3                                                      /**< Number of attempts before giving up the connection parameter negotiation. */
 
+#define DFU_PKTS_PER_CONN_EVT                4                                                      /**< Number of DFU packets the controller is assumed to send per connection event, used for the throughput estimate. */
+#define CONN_INTERVAL_UNITS_PER_SEC          800                                                    /**< Number of 1.25 ms units in one second. */
+
+#ifndef NRF_BLE_DFU_EXTENDED_OPCODES
+#define NRF_BLE_DFU_EXTENDED_OPCODES         1                                                      /**< Accept the extended control point opcodes. DFU Controllers opt in by using them. */
+#endif
+
+#ifndef NRF_BLE_DFU_CHECKPOINT_INTERVAL
+#define NRF_BLE_DFU_CHECKPOINT_INTERVAL      (4 * CODE_PAGE_SIZE)                                   /**< Amount of firmware image data between two persisted progress checkpoints, 0 to disable them. */
+#endif
+
+#ifndef NRF_BLE_DFU_DIRECTED_ADV
+#define NRF_BLE_DFU_DIRECTED_ADV             1                                                      /**< Advertise directed at the last DFU Controller for 1.28 s after a disconnect. */
+#endif
+
 #define MAX_ADV_DATA_LENGTH                  20                                                     /**< Maximum length of advertising data. */
+#define SCAN_RSP_DATA_LENGTH                 12                                                     /**< Length of the scan response data. */
+#define SCAN_RSP_COMPANY_ID                  0x0059                                                 /**< Company identifier of the manufacturer specific data in the scan response (Nordic Semiconductor ASA). */
 
 #define APP_ADV_INTERVAL                     MSEC_TO_UNITS(25, UNIT_0_625_MS)                       /**< The advertising interval (25 ms.). */
 #define APP_ADV_TIMEOUT_IN_SECONDS           BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED                  /**< The advertising timeout in units of seconds. This is set to @ref BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED so that the advertisement is done as long as there there is a call to @ref dfu_transport_close function.*/
 
 #define APP_FEATURE_NOT_SUPPORTED            BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2                   /**< Reply when unsupported features are requested. */
 
-#define MAX_DFU_PKT_LEN                     (20)                                                    /**< Maximum length (in bytes) of the DFU Packet characteristic. */
 #define PKT_CREATE_PARAM_LEN                (6)                                                     /**< Length (in bytes) of the parameters for Create Object request. */
 #define PKT_SET_PRN_PARAM_LEN               (3)                                                     /**< Length (in bytes) of the parameters for Set Packet Receipt Notification request. */
 #define PKT_READ_OBJECT_INFO_PARAM_LEN      (2)                                                     /**< Length (in bytes) of the parameters for Read Object Info request. */
+#define PKT_EXECUTE_CREATE_PARAM_LEN        (10)                                                    /**< Length (in bytes) of the parameters for Execute and Create Object request. */
+#define RSP_HEADER_LEN                      (3)                                                     /**< Length (in bytes) of the response opcode, request opcode and result of a response. */
 #define MAX_RESPONSE_LEN                    (15)                                                    /**< Maximum length (in bytes) of the response to a Control Point command. */
 
+#ifndef NRF_BLE_DFU_NOTIF_QUEUE_LEN
+#define NRF_BLE_DFU_NOTIF_QUEUE_LEN         (4)                                                     /**< Number of Control Point notifications that can wait for a SoftDevice TX buffer. */
+#endif
+
+// Packet Receipt Notifications leave one slot to the response of a held Control Point write.
+STATIC_ASSERT(NRF_BLE_DFU_NOTIF_QUEUE_LEN >= 2);
+
+#ifndef NRF_BLE_DFU_NOTIF_MERGE_PRN
+#define NRF_BLE_DFU_NOTIF_MERGE_PRN         (0)                                                     /**< Drop a Packet Receipt Notification that a queued one or a queued CRC response already covers. Requires a DFU Controller that only uses the latest offset and CRC. */
+#endif
+
+
+#define ATT_WRITE_HEADER_LEN                (3)                                                     /**< Length (in bytes) of the ATT opcode and handle preceding the value of a write. */
 
 #if (NRF_SD_BLE_API_VERSION >= 3)
-#define NRF_BLE_MAX_MTU_SIZE            GATT_MTU_SIZE_DEFAULT                                       /**< MTU size used in the softdevice enabling and to reply to a BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST event. */
+#ifndef NRF_BLE_MAX_MTU_SIZE
+#define NRF_BLE_MAX_MTU_SIZE                (247)                                                   /**< MTU size used in the softdevice enabling and to reply to a BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST event. Largest ATT MTU supported by the SoftDevice. */
+#endif
+#else
+#define NRF_BLE_MAX_MTU_SIZE                GATT_MTU_SIZE_DEFAULT                                   /**< SoftDevices before API version 3 (S130 on nRF51) only support the default ATT MTU. */
+#endif
+
+#define MAX_DFU_PKT_LEN                     (NRF_BLE_MAX_MTU_SIZE - ATT_WRITE_HEADER_LEN)           /**< Maximum length (in bytes) of a single write to the DFU Packet characteristic. */
+
+#ifndef NRF_BLE_DFU_DECODE_BUF_SIZE
+#define NRF_BLE_DFU_DECODE_BUF_SIZE         (512)                                                   /**< Size (in bytes) of the buffer holding compressed or delta data that arrived while the page writer was full. */
+#endif
+
+STATIC_ASSERT(NRF_BLE_DFU_DECODE_BUF_SIZE >= MAX_DFU_PKT_LEN);
+// While a match does not fit, the page writer has a page being programmed and reports back.
+STATIC_ASSERT((NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED * NRF_DFU_PAGE_WRITER_BUF_SIZE) >= NRF_DFU_LZSS_MAX_MATCH);
+
+#ifndef NRF_BLE_DFU_QUEUED_WRITE_LEN
+#define NRF_BLE_DFU_QUEUED_WRITE_LEN        (384)                                                   /**< Maximum length (in bytes) of a queued (long) write to the DFU Packet characteristic, 0 to disable queued writes. */
 #endif
 
+#define QWR_ENTRY_HEADER_LEN                (6)                                                     /**< Length (in bytes) of the handle, offset and length preceding each prepared write in the user memory block. */
+#define QWR_ENTRY_DATA_LEN                  (GATT_MTU_SIZE_DEFAULT - 5)                             /**< Smallest value length (in bytes) of a Prepare Write Request, which carries the ATT opcode, handle and offset. */
+#define QWR_MEM_SIZE                        (NRF_BLE_DFU_QUEUED_WRITE_LEN + 2 +                                  \
+                                             QWR_ENTRY_HEADER_LEN * CEIL_DIV(NRF_BLE_DFU_QUEUED_WRITE_LEN, QWR_ENTRY_DATA_LEN)) /**< Size (in bytes) of the user memory block for a queued write at the smallest ATT MTU. */
+
 
 static ble_dfu_t            m_dfu;                                                                   /**< Structure used to identify the Device Firmware Update service. */
 static uint16_t             m_pkt_notif_target;                                                      /**< Number of packets of firmware data to be received before transmitting the next Packet Receipt Notification to the DFU Controller. */
 static uint16_t             m_pkt_notif_target_cnt;                                                  /**< Number of packets of firmware data received after sending last Packet Receipt Notification or since the receipt of a @ref BLE_DFU_PKT_RCPT_NOTIF_ENABLED event from the DFU service, which ever occurs later.*/
 static uint16_t             m_conn_handle = BLE_CONN_HANDLE_INVALID;                      /**< Handle of the current connection. */
+static uint16_t             m_att_mtu = GATT_MTU_SIZE_DEFAULT;                           /**< ATT MTU negotiated on the current connection. */
+
+/**@brief Connection interval policy of the DFU transport. */
+typedef enum {
+    CONN_INTERVAL_RELAXED,                                      /**< Device is idle or flash-bound, the peripheral preferred parameters are used. */
+    CONN_INTERVAL_FAST                                          /**< Data objects are streaming in, the shortest interval is requested. */
+} conn_interval_mode_t;
+
+static conn_interval_mode_t m_conn_interval_mode;                                                   /**< Connection interval currently requested by the transport. */
+static ble_dfu_conn_stats_t m_conn_stats;                                                           /**< Connection interval statistics exposed through @ref ble_dfu_conn_stats_get. */
+static uint8_t              m_obj_type;                                                             /**< Type of the object that was last created. */
 
 #define DFU_BLE_FLAG_NONE                    (0)
 #define DFU_BLE_FLAG_SERVICE_INITIALIZED     (1 << 0)           /**< Flag to check if the DFU service was initialized by the application.*/
 #define DFU_BLE_FLAG_IS_ADVERTISING          (1 << 1)           /**< Flag to indicate if advertising is ongoing.*/
 #define DFU_BLE_FLAG_TEAR_DOWN_IN_PROGRESS   (1 << 2)           /**< Flag to indicate whether a tear down is in progress. A tear down could be because the application has initiated it or the peer has disconnected. */
+#define DFU_BLE_FLAG_RX_CRC_VALID            (1 << 4)           /**< Flag to indicate that the running offset and CRC match the request handler. */
+#define DFU_BLE_FLAG_COMPRESSED              (1 << 5)           /**< Flag to indicate that the current data object is received compressed. */
+#define DFU_BLE_FLAG_DELTA                   (1 << 6)           /**< Flag to indicate that the current data object is received as a delta patch. */
+#define DFU_BLE_FLAG_IDLE                    (1 << 7)           /**< Flag to indicate that another transport owns the DFU session. */
+#define DFU_BLE_FLAG_PEER_KNOWN              (1 << 8)           /**< Flag to indicate that m_peer_addr holds the address of the last DFU Controller. */
+#define DFU_BLE_FLAG_CTRL_PT_HELD            (1 << 9)           /**< Flag to indicate that the authorization of the Control Point write in m_ctrl_pt_req is held until it can be processed. */
+#define DFU_BLE_FLAG_DECODE_STALLED          (1 << 10)          /**< Flag to indicate that the decoder of the current data object waits for room in the page writer. */
+#define DFU_BLE_FLAG_DECODE_OVERRUN          (1 << 11)          /**< Flag to indicate that encoded data was lost because m_decode_buf was full. */
 
 static uint32_t             m_flags;
 
-static uint8_t  m_notif_buffer[MAX_RESPONSE_LEN];                                                    /**< Buffer used for sending notifications to peer. */
+static ble_dfu_stats_t      m_stats;                                                                 /**< Transfer statistics exposed through the DFU Statistics Characteristic. */
+static uint32_t             m_obj_create_ticks;                                                      /**< RTC1 counter when the current object was created. */
+static uint32_t             m_prn_held_ticks;                                                        /**< RTC1 counter when a Packet Receipt Notification was held back. */
+static uint16_t             m_prns_held;                                                             /**< Number of Packet Receipt Notifications held back, see @ref prn_is_held. */
+
+static uint32_t             m_rx_offset;                                                             /**< Offset of the object data received so far. */
+static uint32_t             m_rx_crc;                                                                /**< CRC32 of the object data received so far, updated per packet. */
+static uint8_t              m_adv_data[MAX_ADV_DATA_LENGTH];                                         /**< Advertising data last passed to the SoftDevice. */
+static uint16_t             m_adv_data_len;                                                          /**< Length of @ref m_adv_data, 0 if it must be encoded again. */
+static uint8_t              m_adv_flags;                                                             /**< Advertising flags encoded in @ref m_adv_data. */
+static ble_gap_addr_t       m_peer_addr;                                                             /**< Address of the last DFU Controller, for directed advertising. */
+static uint32_t             m_checkpoint_offset;                                                     /**< Firmware image offset of the last persisted progress checkpoint. */
+static uint8_t              m_ctrl_pt_req[BLE_L2CAP_MTU_DEF];                                        /**< Control Point write whose authorization is held. */
+static uint16_t             m_ctrl_pt_req_len;                                                       /**< Length of @ref m_ctrl_pt_req. */
+static uint8_t              m_decode_buf[NRF_BLE_DFU_DECODE_BUF_SIZE];                               /**< Encoded object data the decoder has not consumed yet. */
+static uint16_t             m_decode_len;                                                            /**< Length of @ref m_decode_buf. */
+
+#if NRF_BLE_DFU_QUEUED_WRITE_LEN
+static uint8_t  m_qwr_mem[QWR_MEM_SIZE];                                                             /**< User memory block in which the SoftDevice queues prepared writes. */
+#endif
+static uint8_t  m_notif_buffer[MAX_RESPONSE_LEN] = { BLE_DFU_OP_CODE_RESPONSE };                      /**< Buffer in which notifications to the peer are encoded. The response opcode never changes. */
+
+/**@brief Control Point notification waiting for a SoftDevice TX buffer. */
+typedef struct {
+    uint16_t value_handle;                                      /**< Handle of the characteristic value to notify. */
+    uint8_t  len;                                               /**< Length of the notification. */
+    bool     is_prn;                                            /**< Whether the notification is a Packet Receipt Notification. */
+    uint8_t  data[MAX_RESPONSE_LEN];                            /**< Notification data. */
+} notif_t;
+
+static notif_t  m_notif_queue[NRF_BLE_DFU_NOTIF_QUEUE_LEN];                                          /**< Notifications waiting for a SoftDevice TX buffer, oldest first. */
+static uint8_t  m_notif_head;                                                                        /**< Index of the oldest notification in @ref m_notif_queue. */
+static uint8_t  m_notif_count;                                                                       /**< Number of notifications in @ref m_notif_queue. */
 
 app_timer_id_t application_start_timer = NULL;
 
@@ -72,7 +187,8 @@ app_timer_id_t application_start_timer = NULL;
 DFU_TRANSPORT_REGISTER(nrf_dfu_transport_t const dfu_trans) =
 {
     .init_func = ble_dfu_transport_init,
-    .close_func = ble_dfu_transport_close
+    .close_func = ble_dfu_transport_close,
+    .idle_func = ble_dfu_transport_idle
 };
 //lint -restore
 
@@ -102,50 +218,177 @@ static uint32_t conn_params_init(void) {
 }
 
 
+/**@brief     Function for recording the connection interval in use on the current connection.
+ *
+ * @param[in] conn_interval Connection interval in 1.25 ms units.
+ */
+static void conn_stats_update(uint16_t conn_interval) {
+    if ((conn_interval != 0) && (conn_interval != m_stats.conn_interval_history[0])) {
+        memmove(&m_stats.conn_interval_history[1],
+            &m_stats.conn_interval_history[0],
+            sizeof(m_stats.conn_interval_history) - sizeof(m_stats.conn_interval_history[0]));
+        m_stats.conn_interval_history[0] = conn_interval;
+    }
+
+    m_conn_stats.conn_interval = conn_interval;
+    m_conn_stats.throughput = 0;
+
+    if (conn_interval != 0) {
+        m_conn_stats.throughput = ((uint32_t)DFU_PKTS_PER_CONN_EVT
+            * (m_att_mtu - ATT_WRITE_HEADER_LEN)
+            * CONN_INTERVAL_UNITS_PER_SEC) / conn_interval;
+    }
+
+    NRF_LOG_INFO("Connection interval: %d, throughput: %d B/s\r\n", conn_interval, m_conn_stats.throughput);
+}
+
+
+/**@brief     Function for getting the time elapsed since an earlier RTC1 counter value.
+ *
+ * @param[in] since RTC1 counter value to measure from.
+ *
+ * @return    Elapsed time in RTC1 ticks.
+ */
+static uint32_t ticks_since(uint32_t since) {
+    uint32_t now;
+    uint32_t diff = 0;
+
+    (void)app_timer_cnt_get(&now);
+    (void)app_timer_cnt_diff_compute(now, since, &diff);
+    return diff;
+}
+
+
+/**@brief     Function for switching the connection interval policy.
+ *
+ * @details   Requests the shortest connection interval while data objects are streaming and falls
+ *            back to the peripheral preferred parameters while the device is idle or flash-bound.
+ *
+ * @param[in] mode Connection interval policy to apply.
+ */
+static void conn_interval_request(conn_interval_mode_t mode) {
+    uint32_t              err_code;
+    ble_gap_conn_params_t conn_params;
+
+    if (mode == m_conn_interval_mode || m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+
+    if (mode == CONN_INTERVAL_FAST) {
+        conn_params.min_conn_interval = FAST_MIN_CONN_INTERVAL;
+        conn_params.max_conn_interval = FAST_MAX_CONN_INTERVAL;
+    }
+    else {
+        conn_params.min_conn_interval = MIN_CONN_INTERVAL;
+        conn_params.max_conn_interval = MAX_CONN_INTERVAL;
+    }
+    conn_params.slave_latency = SLAVE_LATENCY;
+    conn_params.conn_sup_timeout = CONN_SUP_TIMEOUT;
+
+    // The phase is latched even if the request fails, so that it is only tried again on the
+    // next phase change instead of on every packet.
+    m_conn_interval_mode = mode;
+
+    err_code = ble_conn_params_change_conn_params(&conn_params);
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_INFO("Could not change connection parameters: 0x%08x\r\n", err_code);
+        return;
+    }
+
+    m_conn_stats.requested_interval = conn_params.min_conn_interval;
+}
+
+
+/**@brief     Function for encoding the scan response data.
+ *
+ * @details   The manufacturer specific data carries the bootloader version and the space left for
+ *            a new image next to the current application, both 32-bit little endian. DFU
+ *            Controllers can use it to pick a target without connecting.
+ *
+ * @param[out] p_data   Buffer of @ref SCAN_RSP_DATA_LENGTH bytes.
+ *
+ * @return    Length of the scan response data.
+ */
+static uint16_t scan_rsp_encode(uint8_t *p_data) {
+    uint32_t app_end = CODE_REGION_1_START;
+    uint32_t region_end = BOOTLOADER_START_ADDR - DFU_APP_DATA_RESERVED;
+    uint16_t index = 0;
+
+    if (s_dfu_settings.bank_0.bank_code == NRF_DFU_BANK_VALID_APP) {
+        app_end += CEIL_DIV(s_dfu_settings.bank_0.image_size, CODE_PAGE_SIZE) * CODE_PAGE_SIZE;
+    }
+
+    p_data[index++] = SCAN_RSP_DATA_LENGTH - 1;
+    p_data[index++] = BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    index += uint16_encode(SCAN_RSP_COMPANY_ID, &p_data[index]);
+    index += uint32_encode(s_dfu_settings.bootloader_version, &p_data[index]);
+    index += uint32_encode((region_end > app_end) ? (region_end - app_end) : 0, &p_data[index]);
+
+    return index;
+}
+
+
 /**@brief     Function for the Advertising functionality initialization.
  *
  * @details   Encodes the required advertising data and passes it to the stack.
  *            The advertising data encoded here is specific for DFU.
- *            Setting advertising data can by done by calling @ref ble_advdata_set.
+ *            The SoftDevice keeps the advertising data across advertising start and stop, so it
+ *            is only encoded again if the flags changed or @ref m_adv_data_len was cleared
+ *            because the device name changed, or because the request handler may have changed
+ *            the bootloader settings and banks the scan response is encoded from.
  */
 static uint32_t advertising_init(uint8_t adv_flags) {
     uint32_t    err_code;
     uint16_t    len_advdata = 9;
     uint16_t    max_device_name_length = MAX_ADV_DATA_LENGTH - len_advdata;
     uint16_t    actual_device_name_length = max_device_name_length;
+    uint8_t     scan_rsp_data[SCAN_RSP_DATA_LENGTH];
+    uint16_t    len_scan_rsp;
 
-    uint8_t     p_encoded_advdata[MAX_ADV_DATA_LENGTH];
+    if ((m_adv_data_len != 0) && (m_adv_flags == adv_flags)) {
+        return NRF_SUCCESS;
+    }
 
     // Encode flags.
-    p_encoded_advdata[0] = 0x2;
-    p_encoded_advdata[1] = BLE_GAP_AD_TYPE_FLAGS;
-    p_encoded_advdata[2] = adv_flags;
+    m_adv_data[0] = 0x2;
+    m_adv_data[1] = BLE_GAP_AD_TYPE_FLAGS;
+    m_adv_data[2] = adv_flags;
 
     // Encode 'more available' uuid list.
-    p_encoded_advdata[3] = 0x3;
-    p_encoded_advdata[4] = BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE;
-    p_encoded_advdata[5] = LSB_16(BLE_DFU_SERVICE_UUID);
-    p_encoded_advdata[6] = MSB_16(BLE_DFU_SERVICE_UUID);
+    m_adv_data[3] = 0x3;
+    m_adv_data[4] = BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE;
+    m_adv_data[5] = LSB_16(BLE_DFU_SERVICE_UUID);
+    m_adv_data[6] = MSB_16(BLE_DFU_SERVICE_UUID);
 
     // Get GAP device name and length
-    err_code = sd_ble_gap_device_name_get(&p_encoded_advdata[9], &actual_device_name_length);
+    err_code = sd_ble_gap_device_name_get(&m_adv_data[9], &actual_device_name_length);
     if (err_code != NRF_SUCCESS) {
         return err_code;
     }
 
     // Set GAP device in advertising data.
     if (actual_device_name_length <= max_device_name_length) {
-        p_encoded_advdata[7] = actual_device_name_length + 1; // (actual_length + ADV_AD_TYPE_FIELD_SIZE(1))
-        p_encoded_advdata[8] = BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
+        m_adv_data[7] = actual_device_name_length + 1; // (actual_length + ADV_AD_TYPE_FIELD_SIZE(1))
+        m_adv_data[8] = BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
         len_advdata += actual_device_name_length;
     }
     else {
         // Must use a shorter advertising name than the actual name of the device
-        p_encoded_advdata[7] = max_device_name_length + 1; // (length + ADV_AD_TYPE_FIELD_SIZE(1))
-        p_encoded_advdata[8] = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+        m_adv_data[7] = max_device_name_length + 1; // (length + ADV_AD_TYPE_FIELD_SIZE(1))
+        m_adv_data[8] = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
         len_advdata = MAX_ADV_DATA_LENGTH;
     }
-    return sd_ble_gap_adv_data_set(p_encoded_advdata, len_advdata, NULL, 0);
+
+    len_scan_rsp = scan_rsp_encode(scan_rsp_data);
+
+    err_code = sd_ble_gap_adv_data_set(m_adv_data, len_advdata, scan_rsp_data, len_scan_rsp);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    m_adv_data_len = len_advdata;
+    m_adv_flags = adv_flags;
+    return NRF_SUCCESS;
 }
 
 
@@ -182,6 +425,47 @@ static uint32_t advertising_start(void) {
 }
 
 
+#if NRF_BLE_DFU_DIRECTED_ADV
+/**@brief     Function for advertising directed at the last DFU Controller.
+ *
+ * @details   High duty cycle directed advertising lets the DFU Controller reconnect within a few
+ *            milliseconds. The SoftDevice stops it after 1.28 s with BLE_GAP_EVT_TIMEOUT, then
+ *            undirected advertising takes over.
+ *
+ * @return    NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t advertising_directed_start(void) {
+    uint32_t err_code;
+    ble_gap_adv_params_t adv_params;
+
+    if ((m_flags & DFU_BLE_FLAG_PEER_KNOWN) == 0) {
+        return advertising_start();
+    }
+
+    if ((m_flags & DFU_BLE_FLAG_IS_ADVERTISING) != 0) {
+        return NRF_SUCCESS;
+    }
+
+    memset(&adv_params, 0, sizeof(adv_params));
+
+    adv_params.type = BLE_GAP_ADV_TYPE_ADV_DIRECT_IND;
+    adv_params.p_peer_addr = &m_peer_addr;
+    adv_params.fp = BLE_GAP_ADV_FP_ANY;
+    adv_params.interval = 0;    // Not used for high duty cycle directed advertising.
+    adv_params.timeout = 0;     // Required for high duty cycle directed advertising.
+
+    err_code = sd_ble_gap_adv_start(&adv_params);
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_INFO("Directed advertising failed: 0x%08x\r\n", err_code);
+        return advertising_start();
+    }
+
+    m_flags |= DFU_BLE_FLAG_IS_ADVERTISING;
+    return NRF_SUCCESS;
+}
+#endif
+
+
 /**@brief Function for stopping advertising.
  */
 static uint32_t advertising_stop(void) {
@@ -196,7 +480,7 @@ static uint32_t advertising_stop(void) {
 
     // nrf_gpio_pin_set(ADVERTISING_LED_PIN_NO);
 
-    m_flags |= DFU_BLE_FLAG_IS_ADVERTISING;
+    m_flags &= ~DFU_BLE_FLAG_IS_ADVERTISING;
     return NRF_SUCCESS;
 }
 
@@ -218,314 +502,1120 @@ static bool is_cccd_configured(ble_dfu_t *p_dfu) {
 }
 
 
-static uint32_t send_hvx(uint16_t conn_handle, uint16_t value_handle, uint16_t len) {
-    ble_gatts_hvx_params_t hvx_params = { 0 };
+/**@brief     Function for sending the notifications queued for the DFU Controller.
+ *
+ * @details   Stops at the first notification the SoftDevice has no TX buffer for, it is retried
+ *            on @ref BLE_EVT_TX_COMPLETE. Notifications that fail for any other reason, such as
+ *            notifications being disabled, are dropped.
+ */
+static void notif_queue_flush(void) {
+    ble_gatts_hvx_params_t hvx_params = { 0 };
+    notif_t *p_notif;
+    uint16_t len;
+    uint32_t err_code;
+
+    while (m_notif_count > 0) {
+        p_notif = &m_notif_queue[m_notif_head];
+        len = p_notif->len;
+
+        hvx_params.handle = p_notif->value_handle;
+        hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len = &len;
+        hvx_params.p_data = p_notif->data;
+
+        err_code = sd_ble_gatts_hvx(m_conn_handle, &hvx_params);
+        if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+            return;
+        }
+        if (err_code != NRF_SUCCESS) {
+            m_stats.hvx_failures++;
+        }
+
+        m_notif_head = (m_notif_head + 1) % NRF_BLE_DFU_NOTIF_QUEUE_LEN;
+        m_notif_count--;
+    }
+}
+
+
+/**@brief     Function for getting the number of notifications that can still be queued.
+ */
+static uint8_t notif_queue_room(void) {
+    return NRF_BLE_DFU_NOTIF_QUEUE_LEN - m_notif_count;
+}
+
+
+/**@brief     Function for queueing the notification encoded in @ref m_notif_buffer.
+ *
+ * @details   With @ref NRF_BLE_DFU_NOTIF_MERGE_PRN, a Packet Receipt Notification replaces one
+ *            that still waits for a TX buffer, and is dropped if a successful CRC response for
+ *            the same offset is waiting. Responses to requests are always queued on their own.
+ *
+ * @param[in] value_handle  Handle of the characteristic value to notify.
+ * @param[in] len           Length of the notification.
+ * @param[in] is_prn        Whether the notification is a Packet Receipt Notification.
+ *
+ * @retval    NRF_SUCCESS       If the notification was sent or queued.
+ * @retval    NRF_ERROR_NO_MEM  If the queue is full. The callers wait for room instead, see
+ *                              @ref ctrl_pt_held_run and @ref prn_is_held.
+ */
+static uint32_t send_hvx(uint16_t value_handle, uint16_t len, bool is_prn) {
+    notif_t *p_notif;
+
+    if (NRF_BLE_DFU_NOTIF_MERGE_PRN && is_prn && (m_notif_count > 0)) {
+        p_notif = &m_notif_queue[(m_notif_head + m_notif_count - 1) % NRF_BLE_DFU_NOTIF_QUEUE_LEN];
+        if ((p_notif->value_handle == value_handle) &&
+            (p_notif->data[1] == BLE_DFU_OP_CODE_CALCULATE_CRC) &&
+            (p_notif->data[2] == NRF_DFU_RES_CODE_SUCCESS)) {
+            if (p_notif->is_prn) {
+                memcpy(p_notif->data, m_notif_buffer, len);
+                p_notif->len = (uint8_t)len;
+                return NRF_SUCCESS;
+            }
+
+            if (uint32_decode(&p_notif->data[RSP_HEADER_LEN]) ==
+                uint32_decode(&m_notif_buffer[RSP_HEADER_LEN])) {
+                return NRF_SUCCESS;
+            }
+        }
+    }
+
+    if (m_notif_count >= NRF_BLE_DFU_NOTIF_QUEUE_LEN) {
+        m_stats.hvx_failures++;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_notif = &m_notif_queue[(m_notif_head + m_notif_count) % NRF_BLE_DFU_NOTIF_QUEUE_LEN];
+    memcpy(p_notif->data, m_notif_buffer, len);
+    p_notif->len = (uint8_t)len;
+    p_notif->value_handle = value_handle;
+    p_notif->is_prn = is_prn;
+    m_notif_count++;
+
+    notif_queue_flush();
+    return NRF_SUCCESS;
+}
+
+
+/**@brief     Function for sending the response encoded in @ref m_notif_buffer.
+ *
+ * @details   The response opcode is part of the template in @ref m_notif_buffer. Only the
+ *            request opcode and the result are filled in here, the parameters are encoded
+ *            by the caller.
+ *
+ * @param[in] p_dfu     DFU Service structure.
+ * @param[in] op_code   Opcode of the request.
+ * @param[in] resp_val  Result of the request.
+ * @param[in] len       Length of the response, including its parameters.
+ * @param[in] is_prn    Whether the response is a Packet Receipt Notification.
+ *
+ * @return    NRF_SUCCESS if the response was sent or queued. Otherwise an error code.
+ */
+static uint32_t response_send(ble_dfu_t *p_dfu,
+    uint8_t              op_code,
+    nrf_dfu_res_code_t   resp_val,
+    uint16_t             len,
+    bool                 is_prn) {
+    NRF_LOG_INFO("Sending Response: [0x%01x, 0x%01x], length: %d\r\n", op_code, resp_val, len);
+
+#ifndef NRF51
+    if (p_dfu == NULL) {
+        return NRF_ERROR_NULL;
+    }
+#endif
+
+    if ((m_conn_handle == BLE_CONN_HANDLE_INVALID) || (m_flags & DFU_BLE_FLAG_SERVICE_INITIALIZED) == 0) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_notif_buffer[1] = op_code;
+    m_notif_buffer[2] = (uint8_t)resp_val;
+
+    return send_hvx(p_dfu->dfu_ctrl_pt_handles.value_handle, len, is_prn);
+}
+
+
+/**@brief     Function for encoding an offset and CRC as response parameters.
+ *
+ * @param[in] offset    Offset of the data received so far.
+ * @param[in] crc       CRC of the data received so far.
+ *
+ * @return    Length of the response.
+ */
+static uint16_t response_crc_encode(uint32_t offset, uint32_t crc) {
+    uint16_t index = RSP_HEADER_LEN;
+
+    index += uint32_encode(offset, &m_notif_buffer[index]);
+    index += uint32_encode(crc, &m_notif_buffer[index]);
+
+    return index;
+}
+
+
+/**@brief     Function for seeding the running offset and CRC.
+ *
+ * @param[in] offset    Offset reported by the request handler.
+ * @param[in] crc       CRC reported by the request handler.
+ */
+static void rx_crc_seed(uint32_t offset, uint32_t crc) {
+    m_rx_offset = offset;
+    m_rx_crc = crc;
+    m_flags |= DFU_BLE_FLAG_RX_CRC_VALID;
+}
+
+
+/**@brief     Function for seeding the running offset and CRC from the current object.
+ *
+ * @details   The request handler keeps track of both without reading back flash, so this is
+ *            cheap enough to do on every Create Object request.
+ */
+static void rx_crc_sync(void) {
+    nrf_dfu_req_t dfu_req;
+    nrf_dfu_res_t dfu_res = { {{0}} };
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_CRC;
+
+    if (nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res) == NRF_DFU_RES_CODE_SUCCESS) {
+        rx_crc_seed(dfu_res.offset, dfu_res.crc);
+    }
+    else {
+        m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+    }
+}
+
+
+#if NRF_BLE_DFU_EXTENDED_OPCODES
+/**@brief     Function for getting the largest Packet Receipt Notification window.
+ *
+ * @details   Packet Receipt Notifications are held back until flash has programmed the received
+ *            pages, so the DFU Controller can send at most one window on top of the page writer
+ *            backlog. A larger window overruns the pages the request handler can hold. Encoded
+ *            data objects expand in the decoder, so their window is what @ref m_decode_buf holds
+ *            while the page writer is full.
+ */
+static uint16_t prn_window_max(void) {
+    uint32_t room = nrf_dfu_page_writer_room_get();
+
+    if ((m_flags & (DFU_BLE_FLAG_COMPRESSED | DFU_BLE_FLAG_DELTA)) != 0) {
+        room = sizeof(m_decode_buf);
+    }
+
+    return MAX(1, room / (m_att_mtu - ATT_WRITE_HEADER_LEN));
+}
+#endif
+
+
+/**@brief     Function for creating an object through the request handler.
+ *
+ * @param[in] obj_type      Type of the object.
+ * @param[in] object_size   Size of the object.
+ *
+ * @return    Result of the create request.
+ */
+static nrf_dfu_res_code_t object_create(uint8_t obj_type, uint32_t object_size) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+
+    // The first transport to create an object owns the DFU session.
+    if (nrf_dfu_transports_session_acquire(&dfu_trans) != NRF_SUCCESS) {
+        return NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+    }
+
+    // Reset the packet receipt notification on create object
+    m_pkt_notif_target_cnt = m_pkt_notif_target;
+
+    // The encoding flags are only known to the transport, the object size is the size of the
+    // data as it ends up in flash.
+    m_flags &= ~(DFU_BLE_FLAG_COMPRESSED | DFU_BLE_FLAG_DELTA |
+                 DFU_BLE_FLAG_DECODE_STALLED | DFU_BLE_FLAG_DECODE_OVERRUN);
+    m_decode_len = 0;
+    if ((obj_type & BLE_DFU_OBJ_TYPE_ENCODING_MASK) != 0) {
+        if (((obj_type & ~BLE_DFU_OBJ_TYPE_ENCODING_MASK) != NRF_DFU_OBJ_TYPE_DATA) ||
+            ((obj_type & BLE_DFU_OBJ_TYPE_ENCODING_MASK) == BLE_DFU_OBJ_TYPE_ENCODING_MASK)) {
+            return NRF_DFU_RES_CODE_INVALID_OBJECT;
+        }
+
+        m_flags |= ((obj_type & BLE_DFU_OBJ_TYPE_COMPRESSED_FLAG) != 0) ? DFU_BLE_FLAG_COMPRESSED : DFU_BLE_FLAG_DELTA;
+        obj_type &= ~BLE_DFU_OBJ_TYPE_ENCODING_MASK;
+    }
+
+    m_obj_type = obj_type;
+    (void)app_timer_cnt_get(&m_obj_create_ticks);
+
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_CREATE;
+    dfu_req.obj_type = obj_type;
+    dfu_req.object_size = object_size;
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+    rx_crc_sync();
+
+    // Creating an object can invalidate bank 0, which the scan response reports.
+    m_adv_data_len = 0;
+
+    if ((m_flags & DFU_BLE_FLAG_COMPRESSED) != 0) {
+        nrf_dfu_lzss_reset(object_size);
+    }
+    else if ((m_flags & DFU_BLE_FLAG_DELTA) != 0) {
+        // Checked after the create request, the installed application is no longer valid
+        // if the request handler decided to overwrite it.
+        if ((res_code == NRF_DFU_RES_CODE_SUCCESS) && (nrf_dfu_delta_reset(object_size) != NRF_SUCCESS)) {
+            res_code = NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+        }
+    }
+
+    return res_code;
+}
+
+
+/**@brief     Function for checking if the decoder of the current data object rejected its data.
+ *
+ * @retval    true    If the compressed stream or the delta patch was rejected, or part of it
+ *                    was lost.
+ * @retval    false   If the object is not encoded or was decoded so far.
+ */
+static bool object_decode_is_failed(void) {
+    if ((m_flags & DFU_BLE_FLAG_DECODE_OVERRUN) != 0) {
+        return true;
+    }
+
+    if ((m_flags & DFU_BLE_FLAG_COMPRESSED) != 0) {
+        return nrf_dfu_lzss_is_failed();
+    }
+
+    if ((m_flags & DFU_BLE_FLAG_DELTA) != 0) {
+        return nrf_dfu_delta_is_failed();
+    }
+
+    return false;
+}
+
+
+/**@brief     Function for executing the current object through the request handler.
+ *
+ * @return    Result of the execute request.
+ */
+static nrf_dfu_res_code_t object_execute(void) {
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+
+    // The request handler only sees the decoded data, which stopped at the failure.
+    if (object_decode_is_failed()) {
+        return NRF_DFU_RES_CODE_INVALID_OBJECT;
+    }
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_EXECUTE;
+
+    // Validating the init command is flash and CPU bound, no need for a short interval.
+    if (m_obj_type == NRF_DFU_OBJ_TYPE_COMMAND) {
+        conn_interval_request(CONN_INTERVAL_RELAXED);
+    }
+
+    m_stats.obj_latency_last = ticks_since(m_obj_create_ticks);
+    m_stats.obj_latency_max = MAX(m_stats.obj_latency_max, m_stats.obj_latency_last);
+
+    // Executing an object writes the settings and can activate a new bank.
+    m_adv_data_len = 0;
+
+    return nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+}
+
+
+/**@brief     Function for handling a Create Object request.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_create_object(uint8_t const *p_req) {
+    uint8_t  obj_type;
+    uint32_t object_size;
+
+    NRF_LOG_INFO("Received create object\r\n");
+
+    //lint -save -e415 -e416
+    obj_type = p_req[1];
+    object_size = uint32_decode(&p_req[2]);
+    //lint -restore
+
+    return object_create(obj_type, object_size);
+}
+
+
+/**@brief     Function for handling an Execute Object request.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_execute_object(uint8_t const *p_req) {
+    UNUSED_PARAMETER(p_req);
+
+    NRF_LOG_INFO("Received execute object\r\n");
+
+    return object_execute();
+}
+
+
+/**@brief     Function for handling a Set Packet Receipt Notification request.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_set_receipt_notif(uint8_t const *p_req) {
+    NRF_LOG_INFO("Set receipt notif\r\n");
+
+    //lint -save -e415
+    m_pkt_notif_target = uint16_decode(&p_req[1]);
+    //lint -restore
+    m_pkt_notif_target_cnt = m_pkt_notif_target;
+
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+#if NRF_BLE_DFU_EXTENDED_OPCODES
+/**@brief     Function for handling an extended Set Packet Receipt Notification request.
+ *
+ * @details   Clamps the requested target to the window the page writer can currently absorb, a
+ *            target of 0 (disabled) is replaced with that window. Responds with the effective and
+ *            the recommended Packet Receipt Notification target.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_set_receipt_notif_ext(uint8_t const *p_req) {
+    uint16_t index = RSP_HEADER_LEN;
+    uint16_t window = prn_window_max();
+    uint16_t prn;
+
+    NRF_LOG_INFO("Set receipt notif (extended)\r\n");
+
+    //lint -save -e415
+    prn = uint16_decode(&p_req[1]);
+    //lint -restore
+    m_pkt_notif_target = (prn == 0) ? window : MIN(prn, window);
+    m_pkt_notif_target_cnt = m_pkt_notif_target;
+
+    index += uint16_encode(m_pkt_notif_target, &m_notif_buffer[index]);
+    (void)uint16_encode(window, &m_notif_buffer[index]);
+
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+#endif
+
+
+/**@brief     Function for handling a Calculate Checksum request.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_calculate_crc(uint8_t const *p_req) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+
+    UNUSED_PARAMETER(p_req);
+
+    NRF_LOG_INFO("Received calculate CRC\r\n");
+
+    if (object_decode_is_failed()) {
+        return NRF_DFU_RES_CODE_OPERATION_FAILED;
+    }
+
+    // No need to ask the request handler while the running CRC is in sync.
+    if ((m_flags & DFU_BLE_FLAG_RX_CRC_VALID) != 0) {
+        (void)response_crc_encode(m_rx_offset, m_rx_crc);
+        return NRF_DFU_RES_CODE_SUCCESS;
+    }
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_CRC;
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+    if (res_code == NRF_DFU_RES_CODE_SUCCESS) {
+        rx_crc_seed(dfu_res.offset, dfu_res.crc);
+        (void)response_crc_encode(dfu_res.offset, dfu_res.crc);
+    }
+
+    return res_code;
+}
+
+
+/**@brief     Function for handling a Select Object request.
+ *
+ * @details   Responds with the maximum size, offset and CRC of the selected object.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_select_object(uint8_t const *p_req) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+
+    NRF_LOG_INFO("Received select object\r\n");
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_SELECT;
+
+    // Set object type to read info about
+    //lint -save -e415
+    dfu_req.obj_type = p_req[1];
+    //lint -restore
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+    if (res_code == NRF_DFU_RES_CODE_SUCCESS) {
+        rx_crc_seed(dfu_res.offset, dfu_res.crc);
+        (void)uint32_encode(dfu_res.max_size, &m_notif_buffer[RSP_HEADER_LEN]);
+        (void)uint32_encode(dfu_res.offset, &m_notif_buffer[RSP_HEADER_LEN + 4]);
+        (void)uint32_encode(dfu_res.crc, &m_notif_buffer[RSP_HEADER_LEN + 8]);
+    }
+
+    return res_code;
+}
+
+
+#if NRF_BLE_DFU_EXTENDED_OPCODES
+/**@brief     Function for handling an Execute and Create Object request.
+ *
+ * @details   Checks the CRC computed by the DFU Controller against the running CRC, executes the
+ *            current object and creates the next one. This replaces the Calculate Checksum,
+ *            Execute Object and Create Object round trips between two data objects with one.
+ *            A next object size of 0 only executes the current object. The response carries the
+ *            running offset and CRC whatever the result.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ *
+ * @return    Result of the request.
+ */
+static nrf_dfu_res_code_t on_execute_create(uint8_t const *p_req) {
+    nrf_dfu_res_code_t  res_code;
+    uint32_t            expected_crc;
+    uint8_t             obj_type;
+    uint32_t            object_size;
+
+    NRF_LOG_INFO("Received execute and create object\r\n");
+
+    //lint -save -e415 -e416
+    expected_crc = uint32_decode(&p_req[1]);
+    obj_type = p_req[5];
+    object_size = uint32_decode(&p_req[6]);
+    //lint -restore
+
+    if ((m_flags & DFU_BLE_FLAG_RX_CRC_VALID) == 0) {
+        rx_crc_sync();
+    }
+
+    if (((m_flags & DFU_BLE_FLAG_RX_CRC_VALID) == 0) || (m_rx_crc != expected_crc)) {
+        NRF_LOG_INFO("Execute and create: CRC mismatch\r\n");
+        (void)response_crc_encode(m_rx_offset, m_rx_crc);
+        return NRF_DFU_RES_CODE_OPERATION_FAILED;
+    }
+
+    res_code = object_execute();
+    if ((res_code == NRF_DFU_RES_CODE_SUCCESS) && (object_size != 0)) {
+        res_code = object_create(obj_type, object_size);
+    }
+
+    (void)response_crc_encode(m_rx_offset, m_rx_crc);
+    return res_code;
+}
+#endif
+
+
+/**@brief Handler of a Control Point request, encodes the response parameters into @ref m_notif_buffer. */
+typedef nrf_dfu_res_code_t (*ctrl_pt_handler_t)(uint8_t const *p_req);
+
+/**@brief Entry of the Control Point dispatch table. */
+typedef struct {
+    uint8_t             op_code;                                /**< Opcode of the request. */
+    uint8_t             req_len;                                /**< Length (in bytes) of the request including the opcode, 0 if any length is accepted. */
+    uint8_t             rsp_len;                                /**< Length (in bytes) of the response if the request succeeded. */
+    bool                rsp_on_error;                           /**< Whether the response parameters are sent if the request failed. */
+    bool                flush;                                  /**< Whether the request handler must have all received data before the request. */
+    ctrl_pt_handler_t   handler;                                /**< Handler of the request. */
+} ctrl_pt_cmd_t;
+
+static ctrl_pt_cmd_t const m_ctrl_pt_cmds[] =
+{
+    { BLE_DFU_OP_CODE_CREATE_OBJECT,         PKT_CREATE_PARAM_LEN,           RSP_HEADER_LEN,      false, true,  on_create_object     },
+    { BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF,     PKT_SET_PRN_PARAM_LEN,          RSP_HEADER_LEN,      false, false, on_set_receipt_notif },
+    { BLE_DFU_OP_CODE_CALCULATE_CRC,         0,                              RSP_HEADER_LEN + 8,  false, true,  on_calculate_crc     },
+    { BLE_DFU_OP_CODE_EXECUTE_OBJECT,        0,                              RSP_HEADER_LEN,      false, true,  on_execute_object    },
+    { BLE_DFU_OP_CODE_SELECT_OBJECT,         PKT_READ_OBJECT_INFO_PARAM_LEN, RSP_HEADER_LEN + 12, false, true,  on_select_object     },
+#if NRF_BLE_DFU_EXTENDED_OPCODES
+    { BLE_DFU_OP_CODE_EXECUTE_CREATE_OBJECT, PKT_EXECUTE_CREATE_PARAM_LEN,   RSP_HEADER_LEN + 8,  true,  true,  on_execute_create    },
+    { BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF_EXT, PKT_SET_PRN_PARAM_LEN,          RSP_HEADER_LEN + 4,  false, false, on_set_receipt_notif_ext },
+#endif
+};
+
+#define CTRL_PT_CMD_COUNT   (sizeof(m_ctrl_pt_cmds) / sizeof(m_ctrl_pt_cmds[0]))                    /**< Number of entries in @ref m_ctrl_pt_cmds. */
+
+
+/**@brief     Function for looking up a Control Point request in @ref m_ctrl_pt_cmds.
+ *
+ * @param[in] p_req     Request, starting with the opcode.
+ * @param[in] len       Length of the request.
+ *
+ * @return    Entry of the request, or NULL if the write is empty or the opcode is unknown.
+ */
+static ctrl_pt_cmd_t const *ctrl_pt_cmd_find(uint8_t const *p_req, uint16_t len) {
+    uint32_t i;
+
+    if (len == 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < CTRL_PT_CMD_COUNT; i++) {
+        if (m_ctrl_pt_cmds[i].op_code == p_req[0]) {
+            return &m_ctrl_pt_cmds[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**@brief     Function for handling a Write event on the Control Point characteristic.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_req     Request, starting with the opcode.
+ * @param[in] len       Length of the request.
+ *
+ * @return    NRF_SUCCESS on successful processing of control point write. Otherwise an error code.
+ */
+static uint32_t on_ctrl_pt_write(ble_dfu_t *p_dfu, uint8_t const *p_req, uint16_t len) {
+    ctrl_pt_cmd_t const *p_cmd;
+    nrf_dfu_res_code_t  res_code;
+    uint8_t             op_code;
+
+    if (len == 0) {
+        return response_send(p_dfu, 0, NRF_DFU_RES_CODE_OP_CODE_NOT_SUPPORTED, RSP_HEADER_LEN, false);
+    }
+
+    op_code = p_req[0];
+
+    if (!nrf_dfu_transports_session_check(&dfu_trans)) {
+        return response_send(p_dfu, op_code, NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED, RSP_HEADER_LEN, false);
+    }
+
+    p_cmd = ctrl_pt_cmd_find(p_req, len);
+    if (p_cmd == NULL) {
+        NRF_LOG_INFO("Received unsupported OP code\r\n");
+        return response_send(p_dfu, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, RSP_HEADER_LEN, false);
+    }
+
+    if ((p_cmd->req_len != 0) && (len != p_cmd->req_len)) {
+        return response_send(p_dfu, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, RSP_HEADER_LEN, false);
+    }
+
+    res_code = p_cmd->handler(p_req);
+
+    return response_send(p_dfu,
+        op_code,
+        res_code,
+        ((res_code == NRF_DFU_RES_CODE_SUCCESS) || p_cmd->rsp_on_error) ? p_cmd->rsp_len : RSP_HEADER_LEN,
+        false);
+}
+
+
+/**@brief     Function for processing the held Control Point write once the transport can take it.
+ *
+ * @details   Requests that read back the received data are held until flash has programmed it,
+ *            including the partial page handed to the request handler for them, so that they are
+ *            never answered ahead of the flash. The write is only authorized when it runs, which
+ *            keeps the DFU Controller from sending the next request in the meantime. It also
+ *            waits for a free notification slot, so its response is never dropped.
+ */
+static void ctrl_pt_held_run(void) {
+    ble_gatts_rw_authorize_reply_params_t   auth_reply = { 0 };
+    ctrl_pt_cmd_t const                    *p_cmd;
+    uint32_t                                err_code;
+
+    if (((m_flags & DFU_BLE_FLAG_CTRL_PT_HELD) == 0) || (notif_queue_room() == 0)) {
+        return;
+    }
+
+    p_cmd = ctrl_pt_cmd_find(m_ctrl_pt_req, m_ctrl_pt_req_len);
+    if ((p_cmd != NULL) && p_cmd->flush &&
+        ((p_cmd->req_len == 0) || (m_ctrl_pt_req_len == p_cmd->req_len)) &&
+        nrf_dfu_transports_session_check(&dfu_trans)) {
+        if (nrf_dfu_page_writer_is_busy() || ((m_flags & DFU_BLE_FLAG_DECODE_STALLED) != 0)) {
+            return;
+        }
+
+        // The request handler must see all received data before the request.
+        if (nrf_dfu_page_writer_flush(NULL) != NRF_DFU_RES_CODE_SUCCESS) {
+            m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+        }
+
+        if (nrf_dfu_page_writer_is_busy()) {
+            return;
+        }
+    }
+
+    m_flags &= ~DFU_BLE_FLAG_CTRL_PT_HELD;
+
+    auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.write.update = 1;
+    auth_reply.params.write.len = m_ctrl_pt_req_len;
+    auth_reply.params.write.p_data = m_ctrl_pt_req;
+
+    err_code = sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
+    if (err_code == NRF_SUCCESS) {
+        err_code = on_ctrl_pt_write(&m_dfu, m_ctrl_pt_req, m_ctrl_pt_req_len);
+    }
+
+#ifdef NRF_DFU_DEBUG_VERSION
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_ERROR("Could not handle on_ctrl_pt_write. err_code: 0x%04x\r\n", err_code);
+    }
+#else
+    // Swallow result
+    (void)err_code;
+#endif
+}
+
+
+/**@brief     Function for handling the @ref BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST event from the
+ *            SoftDevice.
+ *
+ * @details   A Control Point write is copied to @ref m_ctrl_pt_req and its authorization held,
+ *            @ref ctrl_pt_held_run grants it once the request can be processed.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_ble_evt Pointer to the event received from BLE stack.
+ *
+ * @return    true if a Control Point write is held, false otherwise.
+ */
+static bool on_rw_authorize_req(ble_dfu_t *p_dfu, ble_evt_t *p_ble_evt) {
+    ble_gatts_rw_authorize_reply_params_t   auth_reply = { 0 };
+    ble_gatts_evt_rw_authorize_request_t *p_authorize_request;
+    ble_gatts_evt_write_t *p_ble_write_evt;
+
+    p_authorize_request = &(p_ble_evt->evt.gatts_evt.params.authorize_request);
+    p_ble_write_evt = &(p_ble_evt->evt.gatts_evt.params.authorize_request.request.write);
+
+    if ((p_authorize_request->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
+        (p_authorize_request->request.write.handle == p_dfu->dfu_ctrl_pt_handles.value_handle) &&
+        (p_authorize_request->request.write.op != BLE_GATTS_OP_PREP_WRITE_REQ) &&
+        (p_authorize_request->request.write.op != BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) &&
+        (p_authorize_request->request.write.op != BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL)) {
+        if (!is_cccd_configured(p_dfu)) {
+            // Send an error response to the peer indicating that the CCCD is improperly configured.
+            auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+            auth_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR;
+
+            // Ignore response of auth reply
+            (void)sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
+            return false;
+        }
 
-    hvx_params.handle = value_handle;
-    hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
-    hvx_params.p_len = &len;
-    hvx_params.p_data = m_notif_buffer;
+        // The characteristic value is at most BLE_L2CAP_MTU_DEF bytes, the SoftDevice rejects longer writes.
+        m_ctrl_pt_req_len = MIN(p_ble_write_evt->len, sizeof(m_ctrl_pt_req));
+        memcpy(m_ctrl_pt_req, p_ble_write_evt->data, m_ctrl_pt_req_len);
+        m_flags |= DFU_BLE_FLAG_CTRL_PT_HELD;
+        return true;
+    }
+    else if (p_authorize_request->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) {
+        // Queued writes are only meant for the DFU Packet Characteristic, which needs no
+        // authorization. Refuse to queue Control Point commands, and let the SoftDevice
+        // execute or cancel the queue so the peer is not left waiting for a response.
+        auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        auth_reply.params.write.gatt_status =
+            (p_authorize_request->request.write.op == BLE_GATTS_OP_PREP_WRITE_REQ) ?
+            BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED : BLE_GATT_STATUS_SUCCESS;
 
-    return sd_ble_gatts_hvx(conn_handle, &hvx_params);
+        (void)sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
+        return false;
+    }
+    else {
+        return false;
+    }
 }
 
 
-static uint32_t response_send(ble_dfu_t *p_dfu,
-    uint8_t              op_code,
-    nrf_dfu_res_code_t   resp_val) {
-    uint16_t index = 0;
-
-    NRF_LOG_INFO("Sending Response: [0x%01x, 0x%01x]\r\n", op_code, resp_val);
-
-#ifndef NRF51
-    if (p_dfu == NULL) {
-        return NRF_ERROR_NULL;
-    }
-#endif
-
-    if ((m_conn_handle == BLE_CONN_HANDLE_INVALID) || (m_flags & DFU_BLE_FLAG_SERVICE_INITIALIZED) == 0) {
-        return NRF_ERROR_INVALID_STATE;
+/**@brief     Function for sending a Packet Receipt Notification for all data received so far.
+ *
+ * @details   Uses the running offset and CRC so that no partial page has to be written. Falls
+ *            back to the values of the request handler if they are out of sync.
+ */
+static void prn_send(void) {
+    nrf_dfu_res_t dfu_res;
+
+    m_stats.prns_sent++;
+
+    if ((m_flags & DFU_BLE_FLAG_RX_CRC_VALID) != 0) {
+        (void)response_send(&m_dfu,
+            BLE_DFU_OP_CODE_CALCULATE_CRC,
+            NRF_DFU_RES_CODE_SUCCESS,
+            response_crc_encode(m_rx_offset, m_rx_crc),
+            true);
+        return;
     }
 
-    m_notif_buffer[index++] = BLE_DFU_OP_CODE_RESPONSE;
-
-    // Encode the Request Op code
-    m_notif_buffer[index++] = op_code;
+    (void)nrf_dfu_page_writer_flush(&dfu_res);
+    (void)response_send(&m_dfu,
+        BLE_DFU_OP_CODE_CALCULATE_CRC,
+        NRF_DFU_RES_CODE_SUCCESS,
+        response_crc_encode(dfu_res.offset, dfu_res.crc),
+        true);
+}
 
-    // Encode the Response Value.
-    m_notif_buffer[index++] = (uint8_t)resp_val;
 
-    return send_hvx(m_conn_handle, p_dfu->dfu_ctrl_pt_handles.value_handle, index);
+/**@brief     Function for checking whether a Packet Receipt Notification has to be held back.
+ *
+ * @details   It waits for flash to program the received pages, and for a free notification slot
+ *            on top of the one kept for the response to a Control Point write.
+ */
+static bool prn_is_held(void) {
+    return nrf_dfu_page_writer_is_busy() ||
+           ((m_flags & DFU_BLE_FLAG_DECODE_STALLED) != 0) ||
+           (notif_queue_room() < 2);
 }
 
 
-static uint32_t response_crc_cmd_send(ble_dfu_t *p_dfu,
-    uint32_t            offset,
-    uint32_t            crc) {
-    uint16_t               index = 0;
+/**@brief     Function for sending the Packet Receipt Notifications that were held back.
+ */
+static void prn_held_run(void) {
+    while ((m_prns_held > 0) && !prn_is_held()) {
+        if (--m_prns_held == 0) {
+            m_stats.flash_wait += ticks_since(m_prn_held_ticks);
+        }
+        prn_send();
+    }
+}
 
-    NRF_LOG_INFO("Sending CRC: [0x60, 0x03, 0x01, 0:x%08x, CRC:0x%08x]\r\n", offset, crc);
 
-#ifndef NRF51
-    if (p_dfu == NULL) {
-        return NRF_ERROR_NULL;
+/**@brief     Function for persisting the transfer progress at checkpoint intervals.
+ *
+ * @details   Called once fstorage has programmed the pages, so a checkpoint never gets ahead of
+ *            the data in flash. Only page boundaries are recorded, the request handler keeps the
+ *            rest of a page in RAM until it is full. After a reset the bootloader restores it and
+ *            Select Object reports it, so the DFU Controller resumes mid-object. Compressed and
+ *            delta objects are left out, the DFU Controller cannot resume their encoded stream
+ *            at an offset of the decoded data.
+ *
+ * @param[in] p_res   Response of the request handler to the last page that is now in flash.
+ */
+static void checkpoint_update(nrf_dfu_res_t const *p_res) {
+    if ((NRF_BLE_DFU_CHECKPOINT_INTERVAL == 0) ||
+        (m_obj_type != NRF_DFU_OBJ_TYPE_DATA) ||
+        ((m_flags & (DFU_BLE_FLAG_COMPRESSED | DFU_BLE_FLAG_DELTA)) != 0) ||
+        ((p_res->offset % CODE_PAGE_SIZE) != 0)) {
+        return;
     }
-#endif
 
-    if ((m_conn_handle == BLE_CONN_HANDLE_INVALID) || (m_flags & DFU_BLE_FLAG_SERVICE_INITIALIZED) == 0) {
-        return NRF_ERROR_INVALID_STATE;
+    // A new update, or an object that was created again.
+    if (p_res->offset < m_checkpoint_offset) {
+        m_checkpoint_offset = 0;
     }
 
-    m_notif_buffer[index++] = BLE_DFU_OP_CODE_RESPONSE;
+    if ((p_res->offset - m_checkpoint_offset) < NRF_BLE_DFU_CHECKPOINT_INTERVAL) {
+        return;
+    }
 
-    // Encode the Request Op code
-    m_notif_buffer[index++] = BLE_DFU_OP_CODE_CALCULATE_CRC;
+    // Busy while the previous checkpoint is queued, the next page tries again.
+    if (nrf_dfu_settings_ext_checkpoint_store(s_dfu_settings.progress.command_crc,
+            p_res->offset,
+            p_res->crc) == NRF_SUCCESS) {
+        m_checkpoint_offset = p_res->offset;
+    }
+}
 
-    // Encode the Response Value.
-    m_notif_buffer[index++] = (uint8_t)NRF_DFU_RES_CODE_SUCCESS;
 
-    // Encode the Offset Value.
-    index += uint32_encode(offset, &m_notif_buffer[index]);
+/**@brief     Function for passing object data to the page writer.
+ *
+ * @details   Receives the packet payload directly, or the decompressed data for compressed data
+ *            objects, so that the running CRC covers the data as it ends up in flash.
+ *
+ * @param[in] p_data    Object data.
+ * @param[in] len       Length of the object data.
+ */
+static void rx_data_write(uint8_t const *p_data, uint32_t len) {
+    m_stats.bytes_written += len;
 
-    // Encode the Crc Value.
-    index += uint32_encode(crc, &m_notif_buffer[index]);
+    if ((m_flags & DFU_BLE_FLAG_RX_CRC_VALID) != 0) {
+        m_rx_crc = nrf_dfu_crc32_update(m_rx_crc, p_data, len);
+        m_rx_offset += len;
+    }
 
-    return send_hvx(m_conn_handle, p_dfu->dfu_ctrl_pt_handles.value_handle, index);
+    if (nrf_dfu_page_writer_write(p_data, len) != NRF_DFU_RES_CODE_SUCCESS) {
+        m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+    }
 }
 
 
-static uint32_t response_select_object_cmd_send(ble_dfu_t *p_dfu,
-    uint32_t            max_size,
-    uint32_t            offset,
-    uint32_t            crc) {
-    uint16_t               index = 0;
+/**@brief     Function for passing encoded data to the decoder of the current data object.
+ *
+ * @details   The decoder stops when the page writer has no room for its output. It is marked
+ *            stalled and runs again once flash has caught up, see @ref object_decode_resume.
+ *
+ * @param[in] p_data    Encoded data.
+ * @param[in] len       Length of the encoded data.
+ *
+ * @return    Number of bytes consumed by the decoder.
+ */
+static uint32_t object_decode(uint8_t const *p_data, uint32_t len) {
+    uint32_t consumed;
 
-    NRF_LOG_INFO("Sending Object Info: [0x60, 0x06, 0x01 max: 0:x%08x 0:x%08x, CRC:0x%08x]\r\n", max_size, offset, crc);
-#ifndef NRF51
-    if (p_dfu == NULL) {
-        return NRF_ERROR_NULL;
+    if ((m_flags & DFU_BLE_FLAG_COMPRESSED) != 0) {
+        consumed = nrf_dfu_lzss_decode(p_data, len);
+    }
+    else {
+        consumed = nrf_dfu_delta_decode(p_data, len);
     }
-#endif
 
-    if ((m_conn_handle == BLE_CONN_HANDLE_INVALID) || (m_flags & DFU_BLE_FLAG_SERVICE_INITIALIZED) == 0) {
-        return NRF_ERROR_INVALID_STATE;
+    // A delta copy can be cut short with all patch data consumed, the page writer is full then.
+    if ((consumed < len) || (nrf_dfu_page_writer_room_get() == 0)) {
+        m_flags |= DFU_BLE_FLAG_DECODE_STALLED;
     }
 
-    m_notif_buffer[index++] = BLE_DFU_OP_CODE_RESPONSE;
+    if (object_decode_is_failed()) {
+        m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+    }
 
-    // Encode the Request Op code
-    m_notif_buffer[index++] = BLE_DFU_OP_CODE_SELECT_OBJECT;
+    return consumed;
+}
 
-    // Encode the Success Response Value.
-    m_notif_buffer[index++] = (uint8_t)NRF_DFU_RES_CODE_SUCCESS;
 
-    // Encode the Max Size Value.
-    index += uint32_encode(max_size, &m_notif_buffer[index]);
+/**@brief     Function for running the decoder on the encoded data held back while it was stalled.
+ *
+ * @details   Called when the page writer reports that flash has caught up.
+ */
+static void object_decode_resume(void) {
+    uint32_t consumed;
 
-    // Encode the Offset Value.
-    index += uint32_encode(offset, &m_notif_buffer[index]);
+    if ((m_flags & DFU_BLE_FLAG_DECODE_STALLED) == 0) {
+        return;
+    }
 
-    // Encode the Crc Value.
-    index += uint32_encode(crc, &m_notif_buffer[index]);
+    m_flags &= ~DFU_BLE_FLAG_DECODE_STALLED;
 
-    return send_hvx(m_conn_handle, p_dfu->dfu_ctrl_pt_handles.value_handle, index);
+    consumed = object_decode(m_decode_buf, m_decode_len);
+    m_decode_len -= consumed;
+    memmove(m_decode_buf, &m_decode_buf[consumed], m_decode_len);
 }
 
 
-/**@brief     Function for handling a Write event on the Control Point characteristic.
- *
- * @param[in] p_dfu             DFU Service Structure.
- * @param[in] p_ble_write_evt   Pointer to the write event received from BLE stack.
+/**@brief     Function for handling the page writer reporting that flash has caught up.
  *
- * @return    NRF_SUCCESS on successful processing of control point write. Otherwise an error code.
+ * @details   A stalled decoder continues first. A Packet Receipt Notification held back while
+ *            pages were being programmed is sent once the decoder has caught up too, which keeps
+ *            the DFU Controller from running ahead of the flash. A Control Point request waiting
+ *            for the flash is processed after it.
  */
-static uint32_t on_ctrl_pt_write(ble_dfu_t *p_dfu, ble_gatts_evt_write_t *p_ble_write_evt) {
-    nrf_dfu_res_code_t  res_code;
-    nrf_dfu_req_t       dfu_req;
-    nrf_dfu_res_t       dfu_res = { {{0}} };
-
-    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
-
-    switch (p_ble_write_evt->data[0]) {
-        case BLE_DFU_OP_CODE_CREATE_OBJECT:
+static void page_writer_handler(nrf_dfu_res_code_t res_code, nrf_dfu_res_t const *p_res) {
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+        m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+    }
+    else {
+        checkpoint_update(p_res);
+    }
 
-            if (p_ble_write_evt->len != PKT_CREATE_PARAM_LEN) {
-                return response_send(p_dfu,
-                    BLE_DFU_OP_CODE_CREATE_OBJECT,
-                    NRF_DFU_RES_CODE_INVALID_PARAMETER);
-            }
+    object_decode_resume();
+    prn_held_run();
+    ctrl_pt_held_run();
+}
 
-            NRF_LOG_INFO("Received create object\r\n");
 
-            // Reset the packet receipt notification on create object
-            m_pkt_notif_target_cnt = m_pkt_notif_target;
+/**@brief     Function for passing the payload of one packet on to the page writer.
+ *
+ * @details   Packets are coalesced into a page sized buffer which is passed to the request handler
+ *            one page at a time instead of one packet at a time. Encoded packets are decoded
+ *            first. While the decoder is stalled they are queued in @ref m_decode_buf, a DFU
+ *            Controller that runs past its Packet Receipt Notification window fails the object.
+ *
+ * @param[in] p_data    Packet payload.
+ * @param[in] len       Length of the packet payload.
+ */
+static void pkt_data_write(uint8_t const *p_data, uint16_t len) {
+    m_stats.pkts_received++;
 
-            // Get type parameter
-            //lint -save -e415
-            dfu_req.obj_type = p_ble_write_evt->data[1];
-            //lint -restore
+    if ((m_flags & (DFU_BLE_FLAG_COMPRESSED | DFU_BLE_FLAG_DELTA)) == 0) {
+        rx_data_write(p_data, len);
+        return;
+    }
 
-            // Get length value
-            //lint -save -e416
-            dfu_req.object_size = uint32_decode(&(p_ble_write_evt->data[2]));
-            //lint -restore
+    if (object_decode_is_failed()) {
+        return;
+    }
 
-            // Set req type
-            dfu_req.req_type = NRF_DFU_OBJECT_OP_CREATE;
+    if ((m_flags & DFU_BLE_FLAG_DECODE_STALLED) == 0) {
+        uint32_t consumed = object_decode(p_data, len);
 
-            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-            return response_send(p_dfu, BLE_DFU_OP_CODE_CREATE_OBJECT, res_code);
+        p_data += consumed;
+        len -= consumed;
+    }
 
-        case BLE_DFU_OP_CODE_EXECUTE_OBJECT:
-            NRF_LOG_INFO("Received execute object\r\n");
+    if (len > (sizeof(m_decode_buf) - m_decode_len)) {
+        NRF_LOG_ERROR("Decode buffer overrun, %d bytes dropped\r\n", len);
+        m_flags |= DFU_BLE_FLAG_DECODE_OVERRUN;
+        m_flags &= ~(DFU_BLE_FLAG_DECODE_STALLED | DFU_BLE_FLAG_RX_CRC_VALID);
+        m_decode_len = 0;
+        return;
+    }
 
-            // Set req type
-            dfu_req.req_type = NRF_DFU_OBJECT_OP_EXECUTE;
+    memcpy(&m_decode_buf[m_decode_len], p_data, len);
+    m_decode_len += len;
+}
 
-            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-            return response_send(p_dfu, BLE_DFU_OP_CODE_EXECUTE_OBJECT, res_code);
 
-        case BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF:
-            NRF_LOG_INFO("Set receipt notif\r\n");
-            if (p_ble_write_evt->len != PKT_SET_PRN_PARAM_LEN) {
-                return (response_send(p_dfu,
-                    BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF,
-                    NRF_DFU_RES_CODE_INVALID_PARAMETER));
+/**@brief     Function for counting a received write towards the next Packet Receipt Notification.
+ */
+static void pkt_receipt_count(void) {
+    // Check if a packet receipt notification is needed to be sent.
+    if (m_pkt_notif_target != 0 && --m_pkt_notif_target_cnt == 0) {
+        if ((m_prns_held > 0) || prn_is_held()) {
+            if (m_prns_held++ == 0) {
+                (void)app_timer_cnt_get(&m_prn_held_ticks);
             }
+        }
+        else {
+            prn_send();
+        }
 
-            //lint -save -e415
-            m_pkt_notif_target = uint16_decode(&(p_ble_write_evt->data[1]));
-            //lint -restore
-            m_pkt_notif_target_cnt = m_pkt_notif_target;
-
-            return response_send(p_dfu, BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF, NRF_DFU_RES_CODE_SUCCESS);
-
-        case BLE_DFU_OP_CODE_CALCULATE_CRC:
-            NRF_LOG_INFO("Received calculate CRC\r\n");
-
-            dfu_req.req_type = NRF_DFU_OBJECT_OP_CRC;
-
-            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-            if (res_code == NRF_DFU_RES_CODE_SUCCESS) {
-                return response_crc_cmd_send(p_dfu, dfu_res.offset, dfu_res.crc);
-            }
-            else {
-                return response_send(p_dfu, BLE_DFU_OP_CODE_CALCULATE_CRC, res_code);
-            }
+        // Reset the counter for the number of firmware packets.
+        m_pkt_notif_target_cnt = m_pkt_notif_target;
+    }
+}
 
-        case BLE_DFU_OP_CODE_SELECT_OBJECT:
 
-            NRF_LOG_INFO("Received select object\r\n");
-            if (p_ble_write_evt->len != PKT_READ_OBJECT_INFO_PARAM_LEN) {
-                return response_send(p_dfu,
-                    BLE_DFU_OP_CODE_SELECT_OBJECT,
-                    NRF_DFU_RES_CODE_INVALID_PARAMETER);
-            }
+/**@brief     Function for handling a write to the DFU Packet characteristic.
+ *
+ * @details   Handles both Write Commands and Write Requests.
+ *
+ * @param[in] p_dfu     DFU Service structure.
+ * @param[in] p_data    Packet payload.
+ * @param[in] len       Length of the packet payload.
+ */
+static void on_pkt_write(ble_dfu_t *p_dfu, uint8_t const *p_data, uint16_t len) {
+    UNUSED_PARAMETER(p_dfu);
 
-            // Set object type to read info about
-            //lint -save -e415
-            dfu_req.obj_type = p_ble_write_evt->data[1];
-            //lint -restore
+    if (len > (m_att_mtu - ATT_WRITE_HEADER_LEN)) {
+        NRF_LOG_INFO("Packet exceeds negotiated MTU: %d\r\n", len);
+        return;
+    }
 
-            dfu_req.req_type = NRF_DFU_OBJECT_OP_SELECT;
+    // Data from a transport that does not own the session would end up in another object.
+    if (!nrf_dfu_transports_session_check(&dfu_trans)) {
+        return;
+    }
 
-            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-            if (res_code == NRF_DFU_RES_CODE_SUCCESS) {
-                return response_select_object_cmd_send(p_dfu, dfu_res.max_size, dfu_res.offset, dfu_res.crc);
-            }
-            else {
-                return response_send(p_dfu, BLE_DFU_OP_CODE_SELECT_OBJECT, res_code);
-            }
+    conn_interval_request(CONN_INTERVAL_FAST);
 
-        default:
-            NRF_LOG_INFO("Received unsupported OP code\r\n");
-            // Unsupported op code.
-            return response_send(p_dfu,
-                p_ble_write_evt->data[0],
-                NRF_DFU_RES_CODE_INVALID_PARAMETER);
-    }
+    pkt_data_write(p_data, len);
+    pkt_receipt_count();
 }
 
 
-/**@brief     Function for handling the @ref BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST event from the
- *            SoftDevice.
+#if NRF_BLE_DFU_QUEUED_WRITE_LEN
+/**@brief     Function for handling an executed queued write to the DFU Packet characteristic.
  *
- * @param[in] p_dfu     DFU Service Structure.
- * @param[in] p_ble_evt Pointer to the event received from BLE stack.
+ * @details   The SoftDevice leaves the prepared writes in @ref m_qwr_mem, each as handle, offset
+ *            and length (16-bit little endian) followed by the value, terminated by an invalid
+ *            handle. The values are passed on in order, so a long write of several hundred bytes
+ *            counts as a single packet towards the Packet Receipt Notification.
+ *
+ * @param[in] p_dfu     DFU Service structure.
  */
-static bool on_rw_authorize_req(ble_dfu_t *p_dfu, ble_evt_t *p_ble_evt) {
-    uint32_t                                err_code;
-    ble_gatts_rw_authorize_reply_params_t   auth_reply = { 0 };
-    ble_gatts_evt_rw_authorize_request_t *p_authorize_request;
-    ble_gatts_evt_write_t *p_ble_write_evt;
+static void on_pkt_queued_write(ble_dfu_t *p_dfu) {
+    uint16_t index = 0;
+    uint16_t expected_offset = 0;
+    bool     written = false;
 
-    p_authorize_request = &(p_ble_evt->evt.gatts_evt.params.authorize_request);
-    p_ble_write_evt = &(p_ble_evt->evt.gatts_evt.params.authorize_request.request.write);
+    if (!nrf_dfu_transports_session_check(&dfu_trans)) {
+        return;
+    }
 
-    if ((p_authorize_request->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
-        (p_authorize_request->request.write.handle == p_dfu->dfu_ctrl_pt_handles.value_handle) &&
-        (p_authorize_request->request.write.op != BLE_GATTS_OP_PREP_WRITE_REQ) &&
-        (p_authorize_request->request.write.op != BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) &&
-        (p_authorize_request->request.write.op != BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL)) {
-        auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
-        auth_reply.params.write.update = 1;
-        auth_reply.params.write.offset = p_ble_write_evt->offset;
-        auth_reply.params.write.len = p_ble_write_evt->len;
-        auth_reply.params.write.p_data = p_ble_write_evt->data;
+    conn_interval_request(CONN_INTERVAL_FAST);
 
-        if (!is_cccd_configured(p_dfu)) {
-            // Send an error response to the peer indicating that the CCCD is improperly configured.
-            auth_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR;
+    while ((index + QWR_ENTRY_HEADER_LEN) <= sizeof(m_qwr_mem)) {
+        uint16_t handle = uint16_decode(&m_qwr_mem[index]);
+        uint16_t offset = uint16_decode(&m_qwr_mem[index + 2]);
+        uint16_t len = uint16_decode(&m_qwr_mem[index + 4]);
 
-            // Ignore response of auth reply
-            (void)sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
-            return false;
+        if (handle == BLE_GATT_HANDLE_INVALID) {
+            break;
         }
 
-        auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+        index += QWR_ENTRY_HEADER_LEN;
+        if ((index + len) > sizeof(m_qwr_mem)) {
+            break;
+        }
+
+        if (handle == p_dfu->dfu_pkt_handles.value_handle) {
+            // The running offset and CRC only hold if the long write arrives in order.
+            if (offset != expected_offset) {
+                NRF_LOG_INFO("Queued write out of order: %d\r\n", offset);
+                m_flags &= ~DFU_BLE_FLAG_RX_CRC_VALID;
+                break;
+            }
 
-        err_code = sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
-        return err_code == NRF_SUCCESS ? true : false;
+            pkt_data_write(&m_qwr_mem[index], len);
+            expected_offset += len;
+            written = true;
+        }
+
+        index += len;
     }
-    else {
-        return false;
+
+    if (written) {
+        pkt_receipt_count();
     }
 }
+#endif
 
 
-/**@brief     Function for handling the @ref BLE_GATTS_EVT_WRITE event from the SoftDevice.
+/**@brief     Function for handling a read of the DFU Statistics Characteristic.
  *
- * @param[in] p_dfu     DFU Service Structure.
+ * @details   The value is only encoded for the first read of a long read so that all parts
+ *            returned to the peer belong to the same snapshot.
+ *
+ * @param[in] p_dfu     DFU Service structure.
  * @param[in] p_ble_evt Pointer to the event received from BLE stack.
  */
-static void on_write(ble_dfu_t *p_dfu, ble_evt_t *p_ble_evt) {
-    if (p_ble_evt->evt.gatts_evt.params.write.handle == p_dfu->dfu_pkt_handles.value_handle) {
-        nrf_dfu_res_code_t  res_code;
-        nrf_dfu_req_t       dfu_req;
-        nrf_dfu_res_t       dfu_res = { {{0}} };
-
-        memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
-
-        // Set req type
-        dfu_req.req_type = NRF_DFU_OBJECT_OP_WRITE;
+static void on_stats_read(ble_dfu_t *p_dfu, ble_evt_t *p_ble_evt) {
+    ble_gatts_evt_read_t const *p_read = &p_ble_evt->evt.gatts_evt.params.authorize_request.request.read;
+    ble_gatts_rw_authorize_reply_params_t auth_reply = { 0 };
+    uint8_t  value[BLE_DFU_STATS_LEN];
+    uint16_t index = 0;
 
-        // Set data and length
-        dfu_req.p_req = p_ble_evt->evt.gatts_evt.params.write.data;
-        dfu_req.req_len = p_ble_evt->evt.gatts_evt.params.write.len;
+    if (p_read->handle != p_dfu->dfu_stats_handles.value_handle) {
+        return;
+    }
 
-        res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-        if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
-            NRF_LOG_INFO("Failure to run packet write\r\n");
+    auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+
+    if (p_read->offset == 0) {
+        index += uint32_encode(m_stats.pkts_received, &value[index]);
+        index += uint32_encode(m_stats.bytes_written, &value[index]);
+        index += uint16_encode(m_stats.prns_sent, &value[index]);
+        index += uint16_encode(m_stats.hvx_failures, &value[index]);
+        index += uint32_encode(m_stats.obj_latency_last, &value[index]);
+        index += uint32_encode(m_stats.obj_latency_max, &value[index]);
+        index += uint32_encode(m_stats.flash_wait, &value[index]);
+        for (uint8_t i = 0; i < BLE_DFU_CONN_INTERVAL_HISTORY_LEN; i++) {
+            index += uint16_encode(m_stats.conn_interval_history[i], &value[index]);
         }
 
-        // Check if a packet receipt notification is needed to be sent.
-        if (m_pkt_notif_target != 0 && --m_pkt_notif_target_cnt == 0) {
-            (void)response_crc_cmd_send(p_dfu, dfu_res.offset, dfu_res.crc);
-
-            // Reset the counter for the number of firmware packets.
-            m_pkt_notif_target_cnt = m_pkt_notif_target;
-        }
+        auth_reply.params.read.update = 1;
+        auth_reply.params.read.len = index;
+        auth_reply.params.read.p_data = value;
     }
+
+    (void)sd_ble_gatts_rw_authorize_reply(m_conn_handle, &auth_reply);
 }
 
 
@@ -535,6 +1625,10 @@ static void on_write(ble_dfu_t *p_dfu, ble_evt_t *p_ble_evt) {
  */
 static void on_ble_evt(ble_evt_t *p_ble_evt) {
     uint32_t err_code;
+    uint32_t timeout_ms;
+#if NRF_BLE_DFU_QUEUED_WRITE_LEN
+    ble_user_mem_block_t mem_block;
+#endif
 
     switch (p_ble_evt->header.evt_id) {
         case BLE_GAP_EVT_CONNECTED:
@@ -542,26 +1636,84 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
             // nrf_gpio_pin_set(ADVERTISING_LED_PIN_NO);
             NRF_LOG_INFO("new connection, stopping application timer\n");
             app_timer_stop(application_start_timer);
+            nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_CONNECTED);
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
             m_flags &= ~DFU_BLE_FLAG_IS_ADVERTISING;
+            m_peer_addr = p_ble_evt->evt.gap_evt.params.connected.peer_addr;
+            m_flags |= DFU_BLE_FLAG_PEER_KNOWN;
+            m_att_mtu = GATT_MTU_SIZE_DEFAULT;
+            m_conn_interval_mode = CONN_INTERVAL_RELAXED;
+            conn_stats_update(p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval);
+
+#if (NRF_SD_BLE_API_VERSION >= 3)
+            // Ask for the largest MTU right away instead of waiting for the controller to do it.
+            err_code = sd_ble_gattc_exchange_mtu_request(m_conn_handle, NRF_BLE_MAX_MTU_SIZE);
+            if (err_code != NRF_SUCCESS) {
+                NRF_LOG_INFO("Could not request MTU exchange: 0x%08x\r\n", err_code);
+            }
+#endif
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
+            // Keep whatever was received before the link dropped. While flash is busy, the next
+            // request flushes it.
+            m_flags &= ~DFU_BLE_FLAG_CTRL_PT_HELD;
+            m_prns_held = 0;
+            if (!nrf_dfu_page_writer_is_busy()) {
+                (void)nrf_dfu_page_writer_flush(NULL);
+            }
+            m_notif_count = 0;
+
+            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            m_att_mtu = GATT_MTU_SIZE_DEFAULT;
+            m_conn_interval_mode = CONN_INTERVAL_RELAXED;
+            conn_stats_update(0);
+
+            // Another transport owns the session and the application start timer.
+            if ((m_flags & DFU_BLE_FLAG_IDLE) != 0) {
+                break;
+            }
+
             // Restart advertising so that the DFU Controller can reconnect if possible.
+#if NRF_BLE_DFU_DIRECTED_ADV
+            err_code = advertising_directed_start();
+#else
             err_code = advertising_start();
+#endif
             APP_ERROR_CHECK(err_code);
 
-            m_conn_handle = BLE_CONN_HANDLE_INVALID;
-
-            NRF_LOG_INFO("restarting long bootloader timeout\n");
+            timeout_ms = nrf_dfu_settings_ext_timeout_get(NRF_DFU_TIMEOUT_POST_DISCONNECT);
+            NRF_LOG_INFO("restarting bootloader timeout of %d ms\n", timeout_ms);
             app_timer_start(
                 application_start_timer,
-                APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER),
+                APP_TIMER_TICKS_COMPAT(timeout_ms, APP_TIMER_PRESCALER),
                 NULL
             );
 
             break;
 
+        case BLE_GAP_EVT_TIMEOUT:
+            // Directed advertising ended without a reconnect, fall back to undirected advertising.
+            if (p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISING) {
+                m_flags &= ~DFU_BLE_FLAG_IS_ADVERTISING;
+                if ((m_flags & DFU_BLE_FLAG_IDLE) == 0) {
+                    err_code = advertising_start();
+                    APP_ERROR_CHECK(err_code);
+                }
+            }
+            break;
+
+        case BLE_EVT_TX_COMPLETE:
+            // The freed slots take the notifications that were held back, in order.
+            notif_queue_flush();
+            prn_held_run();
+            ctrl_pt_held_run();
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            conn_stats_update(p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval);
+            break;
+
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
         {
             err_code = sd_ble_gap_sec_params_reply(m_conn_handle,
@@ -581,24 +1733,34 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
             break;
 
         case BLE_EVT_USER_MEM_REQUEST:
+#if NRF_BLE_DFU_QUEUED_WRITE_LEN
+            memset(m_qwr_mem, 0, sizeof(m_qwr_mem));
+            mem_block.p_mem = m_qwr_mem;
+            mem_block.len = sizeof(m_qwr_mem);
+            err_code = sd_ble_user_mem_reply(m_conn_handle, &mem_block);
+#else
             err_code = sd_ble_user_mem_reply(m_conn_handle, NULL);
+#endif
             APP_ERROR_CHECK(err_code);
             break;
 
+#if NRF_BLE_DFU_QUEUED_WRITE_LEN
+        case BLE_GATTS_EVT_WRITE:
+            if (p_ble_evt->evt.gatts_evt.params.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) {
+                on_pkt_queued_write(&m_dfu);
+            }
+            break;
+#endif
+
         case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
             if (p_ble_evt->evt.gatts_evt.params.authorize_request.type
+                == BLE_GATTS_AUTHORIZE_TYPE_READ) {
+                on_stats_read(&m_dfu, p_ble_evt);
+            }
+            else if (p_ble_evt->evt.gatts_evt.params.authorize_request.type
                 != BLE_GATTS_AUTHORIZE_TYPE_INVALID) {
                 if (on_rw_authorize_req(&m_dfu, p_ble_evt)) {
-                    err_code = on_ctrl_pt_write(&m_dfu,
-                        &(p_ble_evt->evt.gatts_evt.params.authorize_request.request.write));
-#ifdef NRF_DFU_DEBUG_VERSION  
-                    if (err_code != NRF_SUCCESS) {
-                        NRF_LOG_ERROR("Could not handle on_ctrl_pt_write. err_code: 0x%04x\r\n", err_code);
-                    }
-#else
-                    // Swallow result
-                    (void)err_code;
-#endif
+                    ctrl_pt_held_run();
                 }
             }
             break;
@@ -613,16 +1775,26 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
             APP_ERROR_CHECK(err_code);
             break;
 
-        case BLE_GATTS_EVT_WRITE:
-            on_write(&m_dfu, p_ble_evt);
-            break;
-
 #if (NRF_SD_BLE_API_VERSION >= 3)
         case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
             err_code = sd_ble_gatts_exchange_mtu_reply(p_ble_evt->evt.gatts_evt.conn_handle,
                 NRF_BLE_MAX_MTU_SIZE);
             APP_ERROR_CHECK(err_code);
+
+            m_att_mtu = MIN(p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu,
+                NRF_BLE_MAX_MTU_SIZE);
+            m_att_mtu = MAX(m_att_mtu, GATT_MTU_SIZE_DEFAULT);
+            NRF_LOG_INFO("ATT MTU set to %d\r\n", m_att_mtu);
+            conn_stats_update(m_conn_stats.conn_interval);
             break; // BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST
+
+        case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+            m_att_mtu = MIN(p_ble_evt->evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu,
+                NRF_BLE_MAX_MTU_SIZE);
+            m_att_mtu = MAX(m_att_mtu, GATT_MTU_SIZE_DEFAULT);
+            NRF_LOG_INFO("ATT MTU set to %d\r\n", m_att_mtu);
+            conn_stats_update(m_conn_stats.conn_interval);
+            break; // BLE_GATTC_EVT_EXCHANGE_MTU_RSP
 #endif
 
         default:
@@ -640,6 +1812,17 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
  * @param[in] p_ble_evt SoftDevice event.
  */
 static void ble_evt_dispatch(ble_evt_t *p_ble_evt) {
+    // Fast path for DFU packets, none of the other handlers are interested in them.
+    if ((p_ble_evt->header.evt_id == BLE_GATTS_EVT_WRITE) &&
+        (p_ble_evt->evt.gatts_evt.params.write.handle == m_dfu.dfu_pkt_handles.value_handle) &&
+        ((p_ble_evt->evt.gatts_evt.params.write.op == BLE_GATTS_OP_WRITE_CMD) ||
+         (p_ble_evt->evt.gatts_evt.params.write.op == BLE_GATTS_OP_WRITE_REQ))) {
+        on_pkt_write(&m_dfu,
+            p_ble_evt->evt.gatts_evt.params.write.data,
+            p_ble_evt->evt.gatts_evt.params.write.len);
+        return;
+    }
+
     ble_conn_params_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
 }
@@ -712,6 +1895,9 @@ static uint32_t gap_params_init(void) {
         strlen(DEVICE_NAME));
     VERIFY_SUCCESS(err_code);
 
+    // The advertising data carries the device name.
+    m_adv_data_len = 0;
+
     gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
     gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
     gap_conn_params.slave_latency = SLAVE_LATENCY;
@@ -764,7 +1950,9 @@ static uint32_t dfu_pkt_char_add(ble_dfu_t *const p_dfu) {
     ble_gatts_attr_md_t attr_md = { {0} };
     ble_uuid_t          char_uuid;
 
+    // Write Requests and long writes for DFU Controllers that cannot keep several Write Commands in flight.
     char_md.char_props.write_wo_resp = 1;
+    char_md.char_props.write = 1;
 
     char_uuid.type = p_dfu->uuid_type;
     char_uuid.uuid = BLE_DFU_PKT_CHAR_UUID;
@@ -777,7 +1965,7 @@ static uint32_t dfu_pkt_char_add(ble_dfu_t *const p_dfu) {
 
     attr_char_value.p_uuid = &char_uuid;
     attr_char_value.p_attr_md = &attr_md;
-    attr_char_value.max_len = MAX_DFU_PKT_LEN;
+    attr_char_value.max_len = MAX(MAX_DFU_PKT_LEN, NRF_BLE_DFU_QUEUED_WRITE_LEN);
     attr_char_value.p_value = NULL;
 
     return sd_ble_gatts_characteristic_add(p_dfu->service_handle,
@@ -824,6 +2012,42 @@ static uint32_t dfu_ctrl_pt_add(ble_dfu_t *const p_dfu) {
 }
 
 
+/**@brief       Function for adding DFU Statistics characteristic to the BLE Stack.
+ *
+ * @param[in]   p_dfu DFU Service structure.
+ *
+ * @return      NRF_SUCCESS on success. Otherwise an error code.
+ */
+static uint32_t dfu_stats_char_add(ble_dfu_t *const p_dfu) {
+    ble_gatts_char_md_t char_md = { {0} };
+    ble_gatts_attr_t    attr_char_value = { 0 };
+    ble_gatts_attr_md_t attr_md = { {0} };
+    ble_uuid_t          char_uuid;
+
+    char_md.char_props.read = 1;
+
+    char_uuid.type = p_dfu->uuid_type;
+    char_uuid.uuid = BLE_DFU_STATS_CHAR_UUID;
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+    attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 1;
+    attr_md.vlen = 1;
+
+    attr_char_value.p_uuid = &char_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.max_len = BLE_DFU_STATS_LEN;
+    attr_char_value.p_value = NULL;
+
+    return sd_ble_gatts_characteristic_add(p_dfu->service_handle,
+        &char_md,
+        &attr_char_value,
+        &p_dfu->dfu_stats_handles);
+}
+
+
 /**@brief     Function for checking if the CCCD of DFU Control point is configured for Notification.
  *
  * @details   This function checks if the CCCD of DFU Control Point characteristic is configured
@@ -869,6 +2093,9 @@ uint32_t ble_dfu_init(ble_dfu_t *p_dfu) {
     err_code = dfu_ctrl_pt_add(p_dfu);
     VERIFY_SUCCESS(err_code);
 
+    err_code = dfu_stats_char_add(p_dfu);
+    VERIFY_SUCCESS(err_code);
+
     m_flags |= DFU_BLE_FLAG_SERVICE_INITIALIZED;
 
     return NRF_SUCCESS;
@@ -882,10 +2109,17 @@ uint32_t ble_dfu_transport_init(app_timer_id_t application_start_timer_) {
 
     application_start_timer = application_start_timer_;
 
+    err_code = nrf_dfu_page_writer_init(page_writer_handler);
+    VERIFY_SUCCESS(err_code);
+
+    nrf_dfu_lzss_init(rx_data_write, nrf_dfu_page_writer_room_get);
+    nrf_dfu_delta_init(rx_data_write, nrf_dfu_page_writer_room_get);
+
     // leds_init();
 
     err_code = ble_stack_init(true);
     VERIFY_SUCCESS(err_code);
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_SD_ENABLED);
 
     err_code = softdevice_ble_evt_handler_set(ble_evt_dispatch);
     VERIFY_SUCCESS(err_code);
@@ -902,11 +2136,22 @@ uint32_t ble_dfu_transport_init(app_timer_id_t application_start_timer_) {
 
     err_code = advertising_start();
     VERIFY_SUCCESS(err_code);
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_ADVERTISING);
 
     return NRF_SUCCESS;
 }
 
 
+void ble_dfu_conn_stats_get(ble_dfu_conn_stats_t *p_stats) {
+    *p_stats = m_conn_stats;
+}
+
+
+void ble_dfu_stats_get(ble_dfu_stats_t *p_stats) {
+    *p_stats = m_stats;
+}
+
+
 uint32_t ble_dfu_transport_close(void) {
     uint32_t err_code = NRF_SUCCESS;
 
@@ -935,3 +2180,19 @@ uint32_t ble_dfu_transport_close(void) {
     (void)ble_conn_params_stop();
     return err_code;
 }
+
+
+void ble_dfu_transport_idle(void) {
+    NRF_LOG_INFO("Another transport owns the DFU session, idling\r\n");
+
+    m_flags |= DFU_BLE_FLAG_IDLE;
+
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+        (void)sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    }
+    else {
+        (void)advertising_stop();
+    }
+
+    (void)ble_conn_params_stop();
+}
@@ -17,6 +17,16 @@ extern "C" {
 // These UUIDs are used with the Nordic base address to create a 128-bit UUID (0x8EC9XXXXF3154F609FB8838830DAEA50).
 #define BLE_DFU_CTRL_PT_UUID                 0x0001                       //!< The UUID of the DFU Control Point.
 #define BLE_DFU_PKT_CHAR_UUID                0x0002                       //!< The UUID of the DFU Packet Characteristic.
+// 0x0003 and 0x0004 are the Buttonless DFU characteristics of applications, DFU Controllers take
+// a device exposing them for an application. Vendor specific characteristics start at 0x0100.
+#define BLE_DFU_STATS_CHAR_UUID              0x0100                       //!< The UUID of the vendor specific DFU Statistics Characteristic.
+
+#define BLE_DFU_OBJ_TYPE_COMPRESSED_FLAG     0x80                         //!< Set in the object type of a Create Object request to send a data object compressed, see nrf_dfu_lzss.h.
+#define BLE_DFU_OBJ_TYPE_DELTA_FLAG          0x40                         //!< Set in the object type of a Create Object request to send a data object as a delta patch, see nrf_dfu_delta.h.
+#define BLE_DFU_CONN_INTERVAL_HISTORY_LEN    4                            //!< Number of connection intervals kept in @ref ble_dfu_stats_t.
+#define BLE_DFU_STATS_LEN                    (32)                         //!< Length (in bytes) of the encoded DFU Statistics Characteristic value.
+
+#define BLE_DFU_OBJ_TYPE_ENCODING_MASK       (BLE_DFU_OBJ_TYPE_COMPRESSED_FLAG | BLE_DFU_OBJ_TYPE_DELTA_FLAG) //!< Object type flags selecting how a data object is encoded.
 
 
 /**@brief   BLE DFU opcodes.
@@ -30,6 +40,8 @@ extern "C" {
         BLE_DFU_OP_CODE_CALCULATE_CRC = 0x03,                                 /**< Value of the opcode field for a 'Calculating checksum' request. */
         BLE_DFU_OP_CODE_EXECUTE_OBJECT = 0x04,                                 /**< Value of the opcode field for an 'Initialize DFU parameters' request. */
         BLE_DFU_OP_CODE_SELECT_OBJECT = 0x06,                                 /**< Value of the opcode field for a 'Select object' request. */
+        BLE_DFU_OP_CODE_EXECUTE_CREATE_OBJECT = 0x80,                         /**< Value of the opcode field for an extended 'Check CRC, execute and create next object' request. */
+        BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF_EXT = 0x81,                         /**< Value of the opcode field for an extended 'Set Packet Receipt Notification' request, answered with the effective and recommended target. */
         BLE_DFU_OP_CODE_RESPONSE = 0x60                                  /**< Value of the opcode field for a response.*/
     } ble_dfu_op_code_t;
 
@@ -44,9 +56,38 @@ extern "C" {
         uint8_t                      uuid_type;                             /**< UUID type assigned to the DFU Service by the SoftDevice. */
         ble_gatts_char_handles_t     dfu_pkt_handles;                       /**< Handles related to the DFU Packet Characteristic. */
         ble_gatts_char_handles_t     dfu_ctrl_pt_handles;                   /**< Handles related to the DFU Control Point Characteristic. */
+        ble_gatts_char_handles_t     dfu_stats_handles;                     /**< Handles related to the DFU Statistics Characteristic. */
     } ble_dfu_t;
 
 
+    /**@brief   Connection interval statistics of the DFU transport.
+     */
+    typedef struct
+    {
+        uint16_t                     conn_interval;                         /**< Connection interval in use, in 1.25 ms units. 0 when not connected. */
+        uint16_t                     requested_interval;                    /**< Minimum connection interval last requested by the transport, in 1.25 ms units. */
+        uint32_t                     throughput;                            /**< Estimated throughput at the current connection interval, in bytes per second. */
+    } ble_dfu_conn_stats_t;
+
+
+    /**@brief   Transfer statistics of the DFU transport.
+     *
+     * @details The DFU Statistics Characteristic holds the fields in this order, little endian.
+     *          Latencies are in RTC1 ticks.
+     */
+    typedef struct
+    {
+        uint32_t                     pkts_received;                         /**< Number of DFU packets received. */
+        uint32_t                     bytes_written;                         /**< Number of object data bytes passed to the page writer. */
+        uint16_t                     prns_sent;                             /**< Number of Packet Receipt Notifications sent. */
+        uint16_t                     hvx_failures;                          /**< Number of notifications the SoftDevice refused. */
+        uint32_t                     obj_latency_last;                      /**< Time from Create Object to Execute Object of the last object. */
+        uint32_t                     obj_latency_max;                       /**< Longest time from Create Object to Execute Object. */
+        uint32_t                     flash_wait;                            /**< Total time Packet Receipt Notifications were held back waiting for flash or a free notification slot. */
+        uint16_t                     conn_interval_history[BLE_DFU_CONN_INTERVAL_HISTORY_LEN]; /**< Last connection intervals, newest first, in 1.25 ms units. */
+    } ble_dfu_stats_t;
+
+
     /**@brief      Function for initializing the DFU Service.
      *
      * @retval     NRF_SUCCESS If the DFU Service and its characteristics were successfully added to the
@@ -61,6 +102,27 @@ extern "C" {
      */
     uint32_t ble_dfu_transport_close(void);
 
+
+    /**@brief      Function for idling the DFU Service while another transport owns the DFU session.
+     *
+     * @details    Stops advertising and disconnects the peer, advertising is not restarted.
+     */
+    void ble_dfu_transport_idle(void);
+
+
+    /**@brief      Function for reading the connection interval statistics of the DFU transport.
+     *
+     * @param[out] p_stats  Statistics structure to fill.
+     */
+    void ble_dfu_conn_stats_get(ble_dfu_conn_stats_t *p_stats);
+
+
+    /**@brief      Function for reading the transfer statistics of the DFU transport.
+     *
+     * @param[out] p_stats  Statistics structure to fill.
+     */
+    void ble_dfu_stats_get(ble_dfu_stats_t *p_stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,9 @@
 #include "nrf_dfu_utils.h"
 #include "nrf_bootloader_app_start.h"
 #include "nrf_dfu_settings.h"
+#include "nrf_dfu_settings_ext.h"
+#include "nrf_dfu_crc32.h"
+#include "nrf_dfu_boot_trace.h"
 #include "nrf_gpio.h"
 #include "app_scheduler.h"
 #include "app_timer_appsh.h"
@@ -10,6 +13,7 @@
 #include "boards.h"
 #include "nrf_bootloader_info.h"
 #include "nrf_dfu_req_handler.h"
+#include "nrf_soc.h"
 
 #define SCHED_MAX_EVENT_DATA_SIZE       MAX(APP_TIMER_SCHED_EVT_SIZE, 0)                        /**< Maximum size of scheduler events. */
 
@@ -19,11 +23,25 @@
 #define APP_TIMER_OP_QUEUE_SIZE         4                                                       /**< Size of timer operation queues. */
 
 
-#define APPLICATION_START_TIMEOUT      APP_TIMER_TICKS_COMPAT(2000, APP_TIMER_PRESCALER)
-#define APPLICATION_START_TIMEOUT_LONG APP_TIMER_TICKS_COMPAT(60000, APP_TIMER_PRESCALER)
+#ifndef NRF_DFU_FAST_BOOT
+#define NRF_DFU_FAST_BOOT               0                                                       /**< Jump straight to a valid application after power-on, brown-out, watchdog and wake-up resets. */
+#endif
+
+#define FAST_BOOT_RESET_REASON_MASK     (POWER_RESETREAS_RESETPIN_Msk | \
+                                         POWER_RESETREAS_SREQ_Msk     | \
+                                         POWER_RESETREAS_LOCKUP_Msk)                            /**< Reset reasons that always go through the regular bootloader path. */
+
+#ifndef NRF_DFU_APP_REVERIFY_INTERVAL
+#define NRF_DFU_APP_REVERIFY_INTERVAL   0                                                       /**< Number of boots after which the application is fully validated again, 0 to only validate new applications. */
+#endif
+
+#define APP_HEADER_LEN                  64                                                      /**< Length (in bytes) of the start of the application covered by the cheap header checksum. */
+#define APP_CACHE_WAIT_MS               10                                                      /**< Time to wait for the validation result to reach flash before the reset is tried again. */
 
 APP_TIMER_DEF(application_start_timer);
 
+static bool m_app_cache_pending;                                                                /**< Whether the validation result is still being written to flash. */
+
 // Weak function implementation
 
 /** @brief Weak implemenation of nrf_dfu_check_enter.
@@ -49,12 +67,94 @@ __WEAK bool nrf_dfu_enter_check(void) {
     return false;
 }
 
+/**@brief Function for handling the validation result being written to flash.
+ */
+static void app_cache_written(fs_evt_t const * const evt, fs_ret_t result) {
+    UNUSED_PARAMETER(evt);
+    UNUSED_PARAMETER(result);
+
+    m_app_cache_pending = false;
+}
+
+
+/**@brief Function for checking if the application is valid, using the cached result if possible.
+ *
+ * @details A full validation of the application is only done the first time a new application
+ *          is booted, and optionally every NRF_DFU_APP_REVERIFY_INTERVAL boots. The result is
+ *          stored with a new generation in the extended settings. Later calls only compare the
+ *          bank 0 settings and a checksum over the start of the application against it.
+ *          Before the SoftDevice is enabled the result is written to flash before this returns,
+ *          afterwards @ref m_app_cache_pending is set until the write is done.
+ *
+ * @retval  true    If the application is valid.
+ * @retval  false   If there is no valid application.
+ */
+static bool app_is_valid(void) {
+    static bool reverify_due = (NRF_DFU_APP_REVERIFY_INTERVAL > 0);
+    uint32_t    header_crc;
+
+    if (s_dfu_settings.bank_0.bank_code != NRF_DFU_BANK_VALID_APP) {
+        return false;
+    }
+
+    header_crc = nrf_dfu_crc32_update(0, (uint8_t const *)MAIN_APPLICATION_START_ADDR, APP_HEADER_LEN);
+
+    // Count this boot once, the first time the cache is consulted.
+    if (reverify_due) {
+        reverify_due = nrf_dfu_settings_ext_boot_tally(NRF_DFU_APP_REVERIFY_INTERVAL);
+    }
+
+    if (!reverify_due &&
+        (s_dfu_settings_ext.app_generation != 0) &&
+        (s_dfu_settings_ext.app_image_crc == s_dfu_settings.bank_0.image_crc) &&
+        (s_dfu_settings_ext.app_image_size == s_dfu_settings.bank_0.image_size) &&
+        (s_dfu_settings_ext.app_header_crc == header_crc)) {
+        return true;
+    }
+
+    NRF_LOG_INFO("Validating application\r\n");
+    if (!nrf_dfu_app_is_valid()) {
+        return false;
+    }
+
+    reverify_due = false;
+
+    s_dfu_settings_ext.app_generation++;
+    s_dfu_settings_ext.app_image_crc = s_dfu_settings.bank_0.image_crc;
+    s_dfu_settings_ext.app_image_size = s_dfu_settings.bank_0.image_size;
+    s_dfu_settings_ext.app_header_crc = header_crc;
+
+    // Erasing the page must not lose the checkpoint of an update that is still in progress.
+    m_app_cache_pending = true;
+    if (nrf_dfu_settings_ext_cache_write(app_cache_written) != NRF_SUCCESS) {
+        m_app_cache_pending = false;
+    }
+
+    return true;
+}
+
+
 void application_start_timer_handler(void *context) {
     NRF_LOG_INFO("application start timeout\n");
-    if (nrf_dfu_app_is_valid()) {
+    if (app_is_valid()) {
+        // A reset now would lose the validation result and validate again on the next boot.
+        if (m_app_cache_pending) {
+            app_timer_start(
+                application_start_timer,
+                APP_TIMER_TICKS_COMPAT(APP_CACHE_WAIT_MS, APP_TIMER_PRESCALER),
+                NULL
+            );
+            return;
+        }
+
         (void)nrf_dfu_transports_close();
         NVIC_SystemReset();
     }
+    else if (nrf_dfu_settings_ext_timeout_get(NRF_DFU_TIMEOUT_INVALID_APP) != 0) {
+        NRF_LOG_ERROR("no valid app, powering off\n");
+        (void)nrf_dfu_transports_close();
+        (void)sd_power_system_off();
+    }
     else {
         NRF_LOG_ERROR("no valid app\n");
     }
@@ -63,6 +163,111 @@ void application_start_timer_handler(void *context) {
 
 // Internal Functions
 
+#if NRF_DFU_FAST_BOOT
+/**@brief Function for checking if the bootloader setup can be skipped for a valid application.
+ *
+ * @details Power-on and brown-out resets leave RESETREAS empty. Together with watchdog resets
+ *          and wake-ups from System OFF they are not a request for DFU, so a valid application
+ *          can be started without bringing up the SoftDevice.
+ *          RESETREAS is only read. It belongs to the application, which sees the reason of
+ *          the reset that started it. Reasons the application does not clear keep later
+ *          boots on the regular path.
+ *
+ * @param[in] reset_reason  Value of RESETREAS.
+ *
+ * @retval  true    If a valid application can be started right away.
+ * @retval  false   If the regular bootloader path must be taken.
+ */
+static bool fast_boot_check(uint32_t reset_reason) {
+    return ((reset_reason & FAST_BOOT_RESET_REASON_MASK) == 0);
+}
+#endif
+
+
+/**@brief Function for restoring the transfer progress from the last checkpoint.
+ *
+ * @details The bootloader settings only record progress when a data object is executed. A
+ *          checkpoint of the same update that lies inside the object after that is restored,
+ *          so that Select Object reports it and the DFU Controller resumes in the middle of
+ *          the object.
+ *
+ *          Create Object rewinds the progress to the last executed object, so the checkpoint
+ *          becomes the start of the object: the rest of the object is left as its size, which
+ *          is what Execute Object checks whether the DFU Controller streams the remainder
+ *          directly or creates an object for it. The result is written to the bootloader
+ *          settings before the request handler is initialized from them.
+ */
+static void progress_restore(void) {
+    nrf_dfu_checkpoint_t checkpoint;
+    uint32_t             object_end;
+
+    if (!nrf_dfu_settings_ext_checkpoint_get(&checkpoint)) {
+        return;
+    }
+
+    object_end = s_dfu_settings.progress.firmware_image_offset_last +
+                 s_dfu_settings.progress.data_object_size;
+
+    if ((s_dfu_settings.progress.command_size == 0) ||
+        (checkpoint.key != s_dfu_settings.progress.command_crc) ||
+        (checkpoint.offset <= s_dfu_settings.progress.firmware_image_offset_last) ||
+        (checkpoint.offset >= object_end)) {
+        return;
+    }
+
+    NRF_LOG_INFO("Resuming at checkpoint: 0x%08x\r\n", checkpoint.offset);
+    s_dfu_settings.progress.data_object_size = object_end - checkpoint.offset;
+    s_dfu_settings.progress.firmware_image_offset = checkpoint.offset;
+    s_dfu_settings.progress.firmware_image_offset_last = checkpoint.offset;
+    s_dfu_settings.progress.firmware_image_crc = checkpoint.crc;
+    s_dfu_settings.progress.firmware_image_crc_last = checkpoint.crc;
+    s_dfu_settings.write_offset = checkpoint.offset;
+
+    APP_ERROR_CHECK(nrf_dfu_settings_write(NULL));
+}
+
+
+/**@brief Function for selecting the timeout policy entry that applies to this boot.
+ *
+ * @param[in] app_valid     Whether there is a valid application.
+ * @param[in] should_stay   Whether DFU mode was requested or a DFU operation is ongoing.
+ *
+ * @return  Reason the bootloader is waiting for a DFU Controller.
+ */
+static nrf_dfu_timeout_reason_t timeout_reason_select(bool app_valid, bool should_stay) {
+    if (!app_valid) {
+        return NRF_DFU_TIMEOUT_INVALID_APP;
+    }
+
+    if (should_stay) {
+        return NRF_DFU_TIMEOUT_BUTTONLESS;
+    }
+
+    return NRF_DFU_TIMEOUT_FIRST_BOOT;
+}
+
+
+/**@brief Function for starting the application start timer with the timeout from the policy.
+ *
+ * @param[in] reason  Reason the bootloader is waiting for a DFU Controller.
+ */
+static void application_start_timer_start(nrf_dfu_timeout_reason_t reason) {
+    uint32_t timeout_ms = nrf_dfu_settings_ext_timeout_get(reason);
+
+    if (timeout_ms == 0) {
+        NRF_LOG_INFO("no bootloader timeout\n");
+        return;
+    }
+
+    NRF_LOG_INFO("starting bootloader timeout of %d ms\n", timeout_ms);
+    app_timer_start(
+        application_start_timer,
+        APP_TIMER_TICKS_COMPAT(timeout_ms, APP_TIMER_PRESCALER),
+        NULL
+    );
+}
+
+
 /**@brief Function for initializing the timer handler module (app_timer).
  */
 static void timers_init(void) {
@@ -84,11 +289,25 @@ static void scheduler_init(void) {
 }
 
 
+/** @brief Weak implemenation of nrf_dfu_idle_hook.
+ *
+ * @note    Override this function to observe the wait loop, for instance to count wakeups.
+ */
+__WEAK void nrf_dfu_idle_hook(void) {
+}
+
+
 static void wait_for_event() {
     // Transport is waiting for event?
     while (true) {
         // Can't be emptied like this because of lack of static variables
         app_sched_execute();
+
+        nrf_dfu_idle_hook();
+
+        // Sleep until the SoftDevice or a peripheral puts the next event in the scheduler.
+        // Events raised since the queue was drained make this return immediately.
+        (void)sd_app_evt_wait();
     }
 }
 
@@ -101,9 +320,13 @@ uint32_t nrf_dfu_init() {
     uint32_t ret_val = NRF_SUCCESS;
     uint32_t enter_bootloader_mode = 0;
 
+    nrf_dfu_boot_trace_init();
+
     NRF_LOG_INFO("In real nrf_dfu_init\r\n");
 
     nrf_dfu_settings_init();
+    nrf_dfu_settings_ext_init();
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_SETTINGS_LOADED);
 
     // Continue ongoing DFU operations
     // Note that this part does not rely on SoftDevice interaction
@@ -112,6 +335,7 @@ uint32_t nrf_dfu_init() {
         NRF_LOG_INFO("Could not continue DFU operation: 0x%08x\r\n");
         enter_bootloader_mode = 1;
     }
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_CONTINUED);
 
     // Check if there is a reason to enter DFU mode
     // besides the effect of the continuation
@@ -122,42 +346,41 @@ uint32_t nrf_dfu_init() {
 
     bool bootloader_should_stay = enter_bootloader_mode;
 
-    bool app_is_valid = nrf_dfu_app_is_valid();
+    // Checked once for the fast and the regular path.
+    bool app_valid = app_is_valid();
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_APP_CHECKED);
 
+#if NRF_DFU_FAST_BOOT
+    if ((enter_bootloader_mode == 0) && app_valid && fast_boot_check(NRF_POWER->RESETREAS)) {
+        // Later soft resets must not be taken for a first boot.
+        NRF_POWER->GPREGRET++;
+
+        NRF_LOG_INFO("Fast boot, jumping to: 0x%08x\r\n", MAIN_APPLICATION_START_ADDR);
+        nrf_dfu_boot_trace_finish();
+        nrf_bootloader_app_start(MAIN_APPLICATION_START_ADDR);
+    }
+#endif
 
     bool first_boot = (NRF_POWER->GPREGRET++) == 0;
     enter_bootloader_mode |= first_boot;
 
-    if (enter_bootloader_mode != 0 || !app_is_valid) {
+    if (enter_bootloader_mode != 0 || !app_valid) {
         timers_init();
         scheduler_init();
 
         // Initializing transports
+        nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_TRANSPORTS_INIT);
         ret_val = nrf_dfu_transports_init(application_start_timer);
         if (ret_val != NRF_SUCCESS) {
             NRF_LOG_INFO("Could not initalize DFU transport: 0x%08x\r\n");
             return ret_val;
         }
+        nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_TRANSPORTS_READY);
 
+        progress_restore();
         (void)nrf_dfu_req_handler_init();
 
-        if (app_is_valid) {
-            if(bootloader_should_stay){
-                NRF_LOG_INFO("starting long bootloader timeout\n");
-                app_timer_start(
-                    application_start_timer,
-                    APPLICATION_START_TIMEOUT_LONG,
-                    NULL
-                );
-            }else{
-                NRF_LOG_INFO("starting short bootloader timeout\n");
-                app_timer_start(
-                    application_start_timer,
-                    APPLICATION_START_TIMEOUT,
-                    NULL
-                );
-            }
-        }
+        application_start_timer_start(timeout_reason_select(app_valid, bootloader_should_stay));
 
         // This function will never return
         NRF_LOG_INFO("Waiting for events\r\n");
@@ -165,8 +388,9 @@ uint32_t nrf_dfu_init() {
         NRF_LOG_INFO("After waiting for events\r\n");
     }
 
-    if (nrf_dfu_app_is_valid()) {
+    if (app_valid) {
         NRF_LOG_INFO("Jumping to: 0x%08x\r\n", MAIN_APPLICATION_START_ADDR);
+        nrf_dfu_boot_trace_finish();
         nrf_bootloader_app_start(MAIN_APPLICATION_START_ADDR);
     }
 
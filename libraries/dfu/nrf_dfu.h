@@ -46,6 +46,13 @@ extern "C" {
    */
   void nrf_dfu_wait(void);
 
+
+  /** @brief Function called once per iteration of the bootloader wait loop, before sleeping.
+   *
+   * The default implementation does nothing.
+   */
+  void nrf_dfu_idle_hook(void);
+
 #ifdef __cplusplus
 }
 #endif
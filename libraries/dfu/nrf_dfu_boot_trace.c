@@ -0,0 +1,77 @@
+#include "nrf_dfu_boot_trace.h"
+
+#if NRF_DFU_BOOT_TRACE_ENABLED
+
+#include "sdk_common.h"
+#include "nrf.h"
+#include "nrf_sdm.h"
+#include "boards.h"
+
+#define m_trace     (*(nrf_dfu_boot_trace_t *)NRF_DFU_BOOT_TRACE_ADDRESS)
+
+// The SoftDevice encodes the LFCLK source like the LFCLKSRC register.
+STATIC_ASSERT(NRF_CLOCK_LF_SRC_RC == CLOCK_LFCLKSRC_SRC_RC);
+STATIC_ASSERT(NRF_CLOCK_LF_SRC_XTAL == CLOCK_LFCLKSRC_SRC_Xtal);
+STATIC_ASSERT(NRF_CLOCK_LF_SRC_SYNTH == CLOCK_LFCLKSRC_SRC_Synth);
+
+static bool m_lfclk_started;                /**< Whether the trace started the LFCLK. */
+static bool m_rtc_started;                  /**< Whether the trace started RTC1. */
+
+
+void nrf_dfu_boot_trace_init(void) {
+    if (m_trace.magic == NRF_DFU_BOOT_TRACE_MAGIC) {
+        m_trace.boot_count++;
+    }
+    else {
+        m_trace.magic = NRF_DFU_BOOT_TRACE_MAGIC;
+        m_trace.boot_count = 1;
+    }
+    m_trace.count = 0;
+
+    // The SoftDevice takes over the LFCLK when it is enabled, RTC1 keeps counting. The source
+    // is the one the SoftDevice is enabled with, it does not restart a running clock.
+    m_lfclk_started = ((NRF_CLOCK->LFCLKSTAT & CLOCK_LFCLKSTAT_STATE_Msk) == 0);
+    if (m_lfclk_started) {
+        nrf_clock_lf_cfg_t const lf_cfg = NRF_CLOCK_LFCLKSRC;
+
+        NRF_CLOCK->LFCLKSRC = (uint32_t)lf_cfg.source << CLOCK_LFCLKSRC_SRC_Pos;
+        NRF_CLOCK->TASKS_LFCLKSTART = 1;
+    }
+
+    // Same prescaler as the app_timer of the bootloader, which cannot change it once RTC1 runs.
+    m_rtc_started = (NRF_RTC1->COUNTER == 0);
+    if (m_rtc_started) {
+        NRF_RTC1->PRESCALER = 0;
+        NRF_RTC1->TASKS_START = 1;
+    }
+
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_INIT);
+}
+
+
+void nrf_dfu_boot_trace_record(nrf_dfu_boot_phase_t phase) {
+    if (m_trace.count >= NRF_DFU_BOOT_TRACE_LEN) {
+        return;
+    }
+
+    m_trace.entries[m_trace.count++] = ((uint32_t)phase << 24) | (NRF_RTC1->COUNTER & 0x00FFFFFF);
+}
+
+
+void nrf_dfu_boot_trace_finish(void) {
+    nrf_dfu_boot_trace_record(NRF_DFU_BOOT_PHASE_APP_START);
+
+    // The application sets up RTC1 with its own prescaler, which needs a stopped RTC.
+    if (m_rtc_started) {
+        NRF_RTC1->TASKS_STOP = 1;
+        NRF_RTC1->TASKS_CLEAR = 1;
+        NRF_RTC1->PRESCALER = 0;
+    }
+
+    if (m_lfclk_started) {
+        NRF_CLOCK->TASKS_LFCLKSTOP = 1;
+        NRF_CLOCK->EVENTS_LFCLKSTARTED = 0;
+    }
+}
+
+#endif
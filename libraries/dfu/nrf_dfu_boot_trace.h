@@ -0,0 +1,108 @@
+#ifndef NRF_DFU_BOOT_TRACE_H__
+#define NRF_DFU_BOOT_TRACE_H__
+
+#include <stdint.h>
+#include "compiler_abstraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NRF_DFU_BOOT_TRACE_ENABLED
+#define NRF_DFU_BOOT_TRACE_ENABLED      0                                   /**< Record the boot phases of the bootloader. Requires NRF_DFU_BOOT_TRACE_ADDRESS. */
+#endif
+
+#define NRF_DFU_BOOT_TRACE_LEN          16                                  /**< Maximum number of entries recorded per boot. */
+#define NRF_DFU_BOOT_TRACE_MAGIC        0x54425346                          /**< Marks a boot trace that was written by the bootloader. */
+
+#define NRF_DFU_BOOT_TRACE_PHASE(entry) ((nrf_dfu_boot_phase_t)((entry) >> 24))   /**< Phase of a trace entry. */
+#define NRF_DFU_BOOT_TRACE_TICK(entry)  ((entry) & 0x00FFFFFF)              /**< RTC1 counter value of a trace entry, wraps at 24 bits. */
+
+
+  /** @brief Boot phases recorded by the bootloader. */
+  typedef enum {
+    NRF_DFU_BOOT_PHASE_INIT,                /**< nrf_dfu_init was entered. */
+    NRF_DFU_BOOT_PHASE_SETTINGS_LOADED,     /**< The bootloader settings were loaded. */
+    NRF_DFU_BOOT_PHASE_CONTINUED,           /**< Ongoing DFU operations were continued. */
+    NRF_DFU_BOOT_PHASE_APP_CHECKED,         /**< The application was checked for validity. */
+    NRF_DFU_BOOT_PHASE_TRANSPORTS_INIT,     /**< The DFU transports are being initialized. */
+    NRF_DFU_BOOT_PHASE_SD_ENABLED,          /**< The SoftDevice was enabled by the BLE transport. */
+    NRF_DFU_BOOT_PHASE_ADVERTISING,         /**< The BLE transport started advertising. */
+    NRF_DFU_BOOT_PHASE_TRANSPORTS_READY,    /**< All DFU transports were initialized. */
+    NRF_DFU_BOOT_PHASE_CONNECTED,           /**< A DFU Controller connected over BLE. */
+    NRF_DFU_BOOT_PHASE_APP_START,           /**< The application is about to be started. */
+  } nrf_dfu_boot_phase_t;
+
+
+  /** @brief Boot trace, kept in RAM that neither the bootloader nor the application initializes.
+   *
+   * @details Each entry holds the phase in the upper 8 bits and the RTC1 counter in the lower 24 bits.
+   */
+  typedef struct {
+    uint32_t magic;                             /**< @ref NRF_DFU_BOOT_TRACE_MAGIC if the trace is valid. */
+    uint32_t boot_count;                        /**< Number of boots recorded since the trace was last lost. */
+    uint32_t count;                             /**< Number of valid entries. */
+    uint32_t entries[NRF_DFU_BOOT_TRACE_LEN];   /**< Entries of the last boot, oldest first. */
+  } nrf_dfu_boot_trace_t;
+
+
+#if NRF_DFU_BOOT_TRACE_ENABLED
+
+#ifndef NRF_DFU_BOOT_TRACE_ADDRESS
+#error "NRF_DFU_BOOT_TRACE_ADDRESS must point to RAM excluded from the bootloader and application linker scripts."
+#endif
+
+  /** @brief Function for starting the trace of this boot.
+   *
+   * @details Starts the LFCLK from the board's NRF_CLOCK_LFCLKSRC and RTC1 if they are not
+   *          running yet, so that phases before the SoftDevice is enabled get a timestamp.
+   */
+  void nrf_dfu_boot_trace_init(void);
+
+
+  /** @brief Function for recording that a boot phase was reached.
+   *
+   * @param[in] phase   Boot phase.
+   */
+  void nrf_dfu_boot_trace_record(nrf_dfu_boot_phase_t phase);
+
+
+  /** @brief Function for ending the trace right before the application is started.
+   *
+   * @details Records @ref NRF_DFU_BOOT_PHASE_APP_START, then stops and clears RTC1 and stops
+   *          the LFCLK if @ref nrf_dfu_boot_trace_init started them, so that the application
+   *          finds them as after a reset.
+   */
+  void nrf_dfu_boot_trace_finish(void);
+
+#else
+
+#define nrf_dfu_boot_trace_init()
+#define nrf_dfu_boot_trace_record(phase)
+#define nrf_dfu_boot_trace_finish()
+
+#endif
+
+
+  /** @brief Function for getting the trace of the last boot, for instance from the application.
+   *
+   * @return  The boot trace, or NULL if there is none.
+   */
+  static __INLINE nrf_dfu_boot_trace_t const *nrf_dfu_boot_trace_get(void) {
+#if defined(NRF_DFU_BOOT_TRACE_ADDRESS)
+    nrf_dfu_boot_trace_t const *p_trace = (nrf_dfu_boot_trace_t const *)NRF_DFU_BOOT_TRACE_ADDRESS;
+
+    if ((p_trace->magic == NRF_DFU_BOOT_TRACE_MAGIC) && (p_trace->count <= NRF_DFU_BOOT_TRACE_LEN)) {
+      return p_trace;
+    }
+#endif
+    return NULL;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_BOOT_TRACE_H__
+
+/** @} */
@@ -0,0 +1,34 @@
+#ifndef NRF_DFU_CRC32_H__
+#define NRF_DFU_CRC32_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NRF_DFU_CRC32_SLICE_BY_4
+#define NRF_DFU_CRC32_SLICE_BY_4    1       /**< Use four lookup tables (4 kB of flash) instead of one (1 kB) to fold four bytes per step. */
+#endif
+
+
+  /** @brief Function for updating a running CRC32 with more data.
+   *
+   * @details Produces the same values as crc32_compute, so the result can be compared against
+   *          the CRC reported by the request handler.
+   *
+   * @param[in] crc       CRC32 of the data so far, 0 for the first call.
+   * @param[in] p_data    Data to add to the CRC.
+   * @param[in] len       Length of the data.
+   *
+   * @return  CRC32 of the data so far followed by p_data.
+   */
+  uint32_t nrf_dfu_crc32_update(uint32_t crc, void const *p_data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_CRC32_H__
+
+/** @} */
@@ -0,0 +1,241 @@
+#include "nrf_dfu_delta.h"
+
+#include "sdk_common.h"
+#include "nrf_dfu_types.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_log.h"
+
+#define OUTPUT_BUF_SIZE     32      /**< Number of reconstructed bytes collected before calling the output function. */
+#define MAX_HEADER_LEN      8       /**< Length of the longest command header. */
+#define COPY_CHUNK_LEN      CODE_PAGE_SIZE /**< Largest part of a copy passed to the output function at once. */
+
+/**@brief Position of the decoder in the patch. */
+typedef enum {
+    DELTA_STATE_OP,                 /**< Next byte is a command. */
+    DELTA_STATE_HEADER,             /**< Collecting the header of the current command. */
+    DELTA_STATE_COPY,               /**< Copying from the installed application. */
+    DELTA_STATE_ADD,                /**< Next bytes are difference bytes. */
+    DELTA_STATE_INSERT,             /**< Next bytes are literal bytes. */
+    DELTA_STATE_FAILED              /**< The patch is rejected. */
+} delta_state_t;
+
+static nrf_dfu_delta_output_t m_output;                     /**< Function receiving reconstructed data. */
+static nrf_dfu_delta_room_t   m_room;                       /**< Function reporting how much reconstructed data @ref m_output can take. */
+static delta_state_t          m_state;                      /**< Position in the patch. */
+static uint8_t                m_op;                         /**< Current command. */
+static uint8_t                m_header[MAX_HEADER_LEN];     /**< Header of the current command. */
+static uint8_t                m_header_len;                 /**< Number of header bytes received. */
+static uint8_t                m_header_needed;              /**< Length of the header of the current command. */
+static uint8_t const         *p_m_src;                      /**< Next byte of the installed application to read. */
+static uint32_t               m_remaining;                  /**< Bytes left in the current command. */
+static uint32_t               m_out_avail;                  /**< Number of bytes left before the data object is full. */
+static uint8_t                m_out_buf[OUTPUT_BUF_SIZE];   /**< Reconstructed bytes not yet passed to @ref m_output. */
+static uint8_t                m_out_len;                    /**< Number of bytes in @ref m_out_buf. */
+
+
+static void out_flush(void) {
+    if (m_out_len > 0) {
+        m_output(m_out_buf, m_out_len);
+        m_out_len = 0;
+    }
+}
+
+
+/**@brief Function for checking that a command fits into the data object.
+ */
+static bool out_range_check(uint32_t len) {
+    if (len > m_out_avail) {
+        NRF_LOG_ERROR("Delta exceeds the object\r\n");
+        m_state = DELTA_STATE_FAILED;
+        return false;
+    }
+
+    m_out_avail -= len;
+    return true;
+}
+
+
+/**@brief Function for checking that a command only reads the installed application.
+ *
+ * @details The settings are checked again for every command, in case the installed application
+ *          was invalidated since the patch started.
+ */
+static bool src_range_check(uint32_t offset, uint32_t len) {
+    uint32_t src_size = s_dfu_settings.bank_0.image_size;
+
+    if ((s_dfu_settings.bank_0.bank_code != NRF_DFU_BANK_VALID_APP) ||
+        (offset > src_size) || (len > (src_size - offset))) {
+        NRF_LOG_ERROR("Delta refers outside of the application: 0x%08x\r\n", offset);
+        m_state = DELTA_STATE_FAILED;
+        return false;
+    }
+
+    p_m_src = (uint8_t const *)(MAIN_APPLICATION_START_ADDR + offset);
+    return true;
+}
+
+
+/**@brief Function for handling a complete command header.
+ */
+static void header_handle(void) {
+    switch (m_op) {
+        case NRF_DFU_DELTA_OP_COPY:
+            m_remaining = uint32_decode(&m_header[4]);
+            if (out_range_check(m_remaining) &&
+                src_range_check(uint32_decode(&m_header[0]), m_remaining)) {
+                m_state = (m_remaining > 0) ? DELTA_STATE_COPY : DELTA_STATE_OP;
+            }
+            break;
+
+        case NRF_DFU_DELTA_OP_ADD:
+            m_remaining = uint32_decode(&m_header[4]);
+            if (out_range_check(m_remaining) &&
+                src_range_check(uint32_decode(&m_header[0]), m_remaining)) {
+                m_state = (m_remaining > 0) ? DELTA_STATE_ADD : DELTA_STATE_OP;
+            }
+            break;
+
+        default:
+            m_remaining = uint32_decode(&m_header[0]);
+            if (out_range_check(m_remaining)) {
+                m_state = (m_remaining > 0) ? DELTA_STATE_INSERT : DELTA_STATE_OP;
+            }
+            break;
+    }
+}
+
+
+void nrf_dfu_delta_init(nrf_dfu_delta_output_t output, nrf_dfu_delta_room_t room) {
+    m_output = output;
+    m_room = room;
+    m_state = DELTA_STATE_FAILED;
+}
+
+
+uint32_t nrf_dfu_delta_reset(uint32_t max_len) {
+    m_out_len = 0;
+    m_out_avail = max_len;
+
+    if (s_dfu_settings.bank_0.bank_code != NRF_DFU_BANK_VALID_APP) {
+        m_state = DELTA_STATE_FAILED;
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_state = DELTA_STATE_OP;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t nrf_dfu_delta_decode(uint8_t const *p_data, uint32_t len) {
+    uint32_t room = m_room();       // Reconstructed bytes the output takes during this call.
+    uint32_t consumed = 0;
+    bool     stalled = false;
+
+    while ((m_state != DELTA_STATE_FAILED) && !stalled) {
+        // A copy needs no patch data, it goes on when the output has room again.
+        if (m_state == DELTA_STATE_COPY) {
+            uint32_t chunk_len = MIN(MIN(m_remaining, room), COPY_CHUNK_LEN);
+
+            if (chunk_len == 0) {
+                stalled = true;
+                break;
+            }
+
+            // Flash is memory mapped, hand it out directly.
+            out_flush();
+            m_output(p_m_src, chunk_len);
+            p_m_src += chunk_len;
+            m_remaining -= chunk_len;
+            room -= chunk_len;
+
+            if (m_remaining == 0) {
+                m_state = DELTA_STATE_OP;
+            }
+            continue;
+        }
+
+        if (consumed == len) {
+            break;
+        }
+
+        switch (m_state) {
+            case DELTA_STATE_OP:
+                m_op = p_data[consumed++];
+                m_header_len = 0;
+
+                if ((m_op == NRF_DFU_DELTA_OP_COPY) || (m_op == NRF_DFU_DELTA_OP_ADD)) {
+                    m_header_needed = 8;
+                }
+                else if (m_op == NRF_DFU_DELTA_OP_INSERT) {
+                    m_header_needed = 4;
+                }
+                else {
+                    NRF_LOG_ERROR("Unknown delta command: 0x%02x\r\n", m_op);
+                    m_state = DELTA_STATE_FAILED;
+                    break;
+                }
+                m_state = DELTA_STATE_HEADER;
+                break;
+
+            case DELTA_STATE_HEADER:
+                m_header[m_header_len++] = p_data[consumed++];
+
+                if (m_header_len == m_header_needed) {
+                    header_handle();
+                }
+                break;
+
+            case DELTA_STATE_ADD:
+                if (room == 0) {
+                    stalled = true;
+                    break;
+                }
+                room--;
+
+                m_out_buf[m_out_len++] = (uint8_t)(*p_m_src++ + p_data[consumed++]);
+
+                if (m_out_len == OUTPUT_BUF_SIZE) {
+                    out_flush();
+                }
+                if (--m_remaining == 0) {
+                    m_state = DELTA_STATE_OP;
+                }
+                break;
+
+            case DELTA_STATE_INSERT:
+            {
+                uint32_t chunk_len = MIN(MIN(len - consumed, m_remaining), room);
+
+                if (chunk_len == 0) {
+                    stalled = true;
+                    break;
+                }
+
+                out_flush();
+                m_output(&p_data[consumed], chunk_len);
+                consumed += chunk_len;
+                m_remaining -= chunk_len;
+                room -= chunk_len;
+
+                if (m_remaining == 0) {
+                    m_state = DELTA_STATE_OP;
+                }
+            }
+            break;
+
+            case DELTA_STATE_FAILED:
+            default:
+                break;
+        }
+    }
+
+    out_flush();
+
+    // The rest of a rejected patch is discarded.
+    return (m_state == DELTA_STATE_FAILED) ? len : consumed;
+}
+
+
+bool nrf_dfu_delta_is_failed(void) {
+    return m_state == DELTA_STATE_FAILED;
+}
@@ -0,0 +1,96 @@
+#ifndef NRF_DFU_DELTA_H__
+#define NRF_DFU_DELTA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /** @brief Delta patch format.
+   *
+   * @details A patch is a sequence of commands that reconstruct the new application from the
+   *          one currently installed at MAIN_APPLICATION_START_ADDR. All values are little endian
+   *          and offsets are relative to the start of the installed application.
+   *          - @ref NRF_DFU_DELTA_OP_COPY, offset (4), length (4): copy bytes of the installed application.
+   *          - @ref NRF_DFU_DELTA_OP_ADD, offset (4), length (4), length bytes: add each byte
+   *            to the byte at the same position in the installed application (bsdiff style).
+   *          - @ref NRF_DFU_DELTA_OP_INSERT, length (4), length bytes: copy the bytes as they are.
+   *
+   *          Each data object carries the commands producing exactly its own object size, so
+   *          a re-created object can be patched again. Commands may be split across packets.
+   *          Only the command header is buffered, so RAM use does not depend on the patch.
+   */
+#define NRF_DFU_DELTA_OP_COPY       0x00    /**< Copy from the installed application. */
+#define NRF_DFU_DELTA_OP_ADD        0x01    /**< Add difference bytes to the installed application. */
+#define NRF_DFU_DELTA_OP_INSERT     0x02    /**< Insert literal bytes. */
+
+
+  /** @brief Function type receiving reconstructed data.
+   *
+   * @param[in] p_data    Reconstructed data.
+   * @param[in] len       Length of the data.
+   */
+  typedef void (*nrf_dfu_delta_output_t)(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Function type reporting how many reconstructed bytes the output can take.
+   *
+   * @return  Number of bytes the output function accepts before it must be asked again.
+   */
+  typedef uint32_t (*nrf_dfu_delta_room_t)(void);
+
+
+  /** @brief Function for initializing the patch decoder.
+   *
+   * @param[in] output    Function receiving the reconstructed data.
+   * @param[in] room      Function reporting how much reconstructed data the output can take.
+   */
+  void nrf_dfu_delta_init(nrf_dfu_delta_output_t output, nrf_dfu_delta_room_t room);
+
+
+  /** @brief Function for starting the patch of a new data object.
+   *
+   * @details The installed application is only read, never written, so this requires the new
+   *          image to be received into the second bank.
+   *
+   * @param[in] max_len   Size of the data object, the patch is rejected if it produces more.
+   *
+   * @retval  NRF_SUCCESS                 If the installed application can be patched.
+   * @retval  NRF_ERROR_INVALID_STATE     If there is no valid application to patch, for
+   *                                      instance because it is being overwritten.
+   */
+  uint32_t nrf_dfu_delta_reset(uint32_t max_len);
+
+
+  /** @brief Function for applying part of a patch.
+   *
+   * @details Copies are output in chunks of at most one flash page. Stops when the output has
+   *          no room left. The bytes that were not consumed must be passed again, once the
+   *          output has room, before any further data. A copy that was cut short continues on
+   *          the next call, which may then consume nothing.
+   *
+   * @param[in] p_data    Patch data.
+   * @param[in] len       Length of the patch data.
+   *
+   * @return  Number of bytes consumed. All of them if the patch is rejected.
+   */
+  uint32_t nrf_dfu_delta_decode(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Function for checking if the patch referred outside of the installed application or
+   *         produced more than the data object size.
+   *
+   * @retval  true    If the patch was rejected. No more data is output until the next reset.
+   * @retval  false   If the patch was applied so far.
+   */
+  bool nrf_dfu_delta_is_failed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_DELTA_H__
+
+/** @} */
@@ -0,0 +1,151 @@
+#include "nrf_dfu_lzss.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "nrf_log.h"
+
+#define OUTPUT_BUF_SIZE     32      /**< Number of decompressed bytes collected before calling the output function. */
+
+STATIC_ASSERT(NRF_DFU_LZSS_WINDOW_SIZE == 256);
+
+/**@brief Position of the decoder in the token stream. */
+typedef enum {
+    LZSS_STATE_FLAGS,               /**< Next byte is a flag byte. */
+    LZSS_STATE_TOKEN,               /**< Next byte is a literal or the distance of a match. */
+    LZSS_STATE_MATCH_LEN,           /**< Next byte is the length of a match. */
+    LZSS_STATE_FAILED               /**< The stream is rejected. */
+} lzss_state_t;
+
+static nrf_dfu_lzss_output_t m_output;                              /**< Function receiving decompressed data. */
+static nrf_dfu_lzss_room_t   m_room;                                /**< Function reporting how much decompressed data @ref m_output can take. */
+static uint8_t               m_window[NRF_DFU_LZSS_WINDOW_SIZE];    /**< Last decompressed bytes. */
+static uint8_t               m_window_pos;                          /**< Next write position in @ref m_window, wraps at 256. */
+static uint8_t               m_out_buf[OUTPUT_BUF_SIZE];            /**< Decompressed bytes not yet passed to @ref m_output. */
+static uint8_t               m_out_len;                             /**< Number of bytes in @ref m_out_buf. */
+static lzss_state_t          m_state;                               /**< Position in the token stream. */
+static uint8_t               m_flags;                               /**< Remaining flag bits of the current group. */
+static uint8_t               m_flag_count;                          /**< Number of tokens left in the current group. */
+static uint16_t              m_distance;                            /**< Distance of the match being decoded. */
+static uint32_t              m_out_avail;                           /**< Number of bytes left before the data object is full. */
+
+
+static void out_flush(void) {
+    if (m_out_len > 0) {
+        m_output(m_out_buf, m_out_len);
+        m_out_len = 0;
+    }
+}
+
+
+static void out_byte(uint8_t byte) {
+    if (m_out_avail == 0) {
+        NRF_LOG_ERROR("Compressed data exceeds the object\r\n");
+        m_state = LZSS_STATE_FAILED;
+        return;
+    }
+
+    m_out_avail--;
+    m_window[m_window_pos++] = byte;
+    m_out_buf[m_out_len++] = byte;
+
+    if (m_out_len == OUTPUT_BUF_SIZE) {
+        out_flush();
+    }
+}
+
+
+static void next_token(void) {
+    m_flags >>= 1;
+    m_state = (--m_flag_count == 0) ? LZSS_STATE_FLAGS : LZSS_STATE_TOKEN;
+}
+
+
+void nrf_dfu_lzss_init(nrf_dfu_lzss_output_t output, nrf_dfu_lzss_room_t room) {
+    m_output = output;
+    m_room = room;
+    nrf_dfu_lzss_reset(0);
+}
+
+
+void nrf_dfu_lzss_reset(uint32_t max_len) {
+    memset(m_window, 0, sizeof(m_window));
+    m_window_pos = 0;
+    m_out_len = 0;
+    m_out_avail = max_len;
+    m_state = LZSS_STATE_FLAGS;
+}
+
+
+uint32_t nrf_dfu_lzss_decode(uint8_t const *p_data, uint32_t len) {
+    uint32_t room = m_room();       // Decompressed bytes the output takes during this call.
+    uint32_t consumed = 0;
+    bool     stalled = false;
+
+    while ((consumed < len) && (m_state != LZSS_STATE_FAILED) && !stalled) {
+        uint8_t byte = p_data[consumed];
+
+        switch (m_state) {
+            case LZSS_STATE_FLAGS:
+                m_flags = byte;
+                m_flag_count = 8;
+                m_state = LZSS_STATE_TOKEN;
+                break;
+
+            case LZSS_STATE_TOKEN:
+                if ((m_flags & 0x01) != 0) {
+                    if (room == 0) {
+                        stalled = true;
+                        break;
+                    }
+                    room--;
+                    out_byte(byte);
+                    if (m_state != LZSS_STATE_FAILED) {
+                        next_token();
+                    }
+                }
+                else {
+                    m_distance = (uint16_t)byte + 1;
+                    m_state = LZSS_STATE_MATCH_LEN;
+                }
+                break;
+
+            case LZSS_STATE_MATCH_LEN:
+            {
+                uint16_t match_len = (uint16_t)byte + NRF_DFU_LZSS_MIN_MATCH;
+
+                // The length byte stays unconsumed until the whole match fits.
+                if (room < match_len) {
+                    stalled = true;
+                    break;
+                }
+                room -= match_len;
+
+                while ((match_len-- > 0) && (m_state != LZSS_STATE_FAILED)) {
+                    out_byte(m_window[(uint8_t)(m_window_pos - m_distance)]);
+                }
+                if (m_state != LZSS_STATE_FAILED) {
+                    next_token();
+                }
+            }
+            break;
+
+            case LZSS_STATE_FAILED:
+            default:
+                break;
+        }
+
+        if (!stalled) {
+            consumed++;
+        }
+    }
+
+    out_flush();
+
+    // The rest of a rejected stream is discarded.
+    return (m_state == LZSS_STATE_FAILED) ? len : consumed;
+}
+
+
+bool nrf_dfu_lzss_is_failed(void) {
+    return m_state == LZSS_STATE_FAILED;
+}
@@ -0,0 +1,89 @@
+#ifndef NRF_DFU_LZSS_H__
+#define NRF_DFU_LZSS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /** @brief Compressed stream format.
+   *
+   * @details The stream is a sequence of groups of up to eight tokens. Each group starts with
+   *          a flag byte whose bits, least significant first, give the kind of each token:
+   *          - 1: literal, one byte copied to the output.
+   *          - 0: match, two bytes. The first is the distance back into the output minus one
+   *               (1 to 256), the second is the length minus three (3 to 258).
+   *
+   *          Matches refer to the last @ref NRF_DFU_LZSS_WINDOW_SIZE bytes of output of the
+   *          current object. Tokens may be split across packets.
+   */
+#define NRF_DFU_LZSS_WINDOW_SIZE    256     /**< Size (in bytes) of the sliding window. */
+#define NRF_DFU_LZSS_MIN_MATCH      3       /**< Shortest match encoded as a match token. */
+#define NRF_DFU_LZSS_MAX_MATCH      (255 + NRF_DFU_LZSS_MIN_MATCH) /**< Longest match encoded as a match token. */
+
+
+  /** @brief Function type receiving decompressed data.
+   *
+   * @param[in] p_data    Decompressed data.
+   * @param[in] len       Length of the data.
+   */
+  typedef void (*nrf_dfu_lzss_output_t)(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Function type reporting how many decompressed bytes the output can take.
+   *
+   * @details Once the output has caught up it must report room for at least
+   *          @ref NRF_DFU_LZSS_MAX_MATCH bytes, a match is only decoded as a whole.
+   *
+   * @return  Number of bytes the output function accepts before it must be asked again.
+   */
+  typedef uint32_t (*nrf_dfu_lzss_room_t)(void);
+
+
+  /** @brief Function for initializing the decoder.
+   *
+   * @param[in] output    Function receiving the decompressed data.
+   * @param[in] room      Function reporting how much decompressed data the output can take.
+   */
+  void nrf_dfu_lzss_init(nrf_dfu_lzss_output_t output, nrf_dfu_lzss_room_t room);
+
+
+  /** @brief Function for starting a new compressed stream.
+   *
+   * @details Clears the window and the token state. Called for every new data object.
+   *
+   * @param[in] max_len   Size of the data object, the stream is rejected if it decompresses to more.
+   */
+  void nrf_dfu_lzss_reset(uint32_t max_len);
+
+
+  /** @brief Function for decompressing part of a compressed stream.
+   *
+   * @details Stops at the first literal or match the output has no room for. The bytes that
+   *          were not consumed must be passed again, once the output has room, before any
+   *          further data.
+   *
+   * @param[in] p_data    Compressed data.
+   * @param[in] len       Length of the compressed data.
+   *
+   * @return  Number of bytes consumed. All of them if the stream is rejected.
+   */
+  uint32_t nrf_dfu_lzss_decode(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Function for checking if the stream decompressed to more than the data object size.
+   *
+   * @retval  true    If the stream was rejected. No more data is output until the next reset.
+   * @retval  false   If the stream was decompressed so far.
+   */
+  bool nrf_dfu_lzss_is_failed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_LZSS_H__
+
+/** @} */
@@ -0,0 +1,187 @@
+#include "nrf_dfu_page_writer.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "fstorage.h"
+#include "nrf_log.h"
+
+#define APP_TIMER_PRESCALER             0                                   /**< Value of the RTC1 PRESCALER register. */
+
+static uint32_t                      m_buf[NRF_DFU_PAGE_WRITER_BUF_SIZE / sizeof(uint32_t)]; /**< Word-aligned staging buffer. */
+static uint16_t                      m_len;                                 /**< Number of bytes in the staging buffer. */
+static uint8_t                       m_unconfirmed;                         /**< Number of pages handed to the request handler that are not yet known to be in flash. */
+static nrf_dfu_res_code_t            m_res_code;                            /**< Result of the first failed write of a page that was kept back, since the last notification. */
+static nrf_dfu_page_writer_handler_t m_handler;                             /**< Function notified when the pages are in flash. */
+
+APP_TIMER_DEF(m_poll_timer);
+
+static nrf_dfu_req_t                 m_req =                                /**< Write request reused for every page. */
+{
+    .req_type = NRF_DFU_OBJECT_OP_WRITE
+};
+static nrf_dfu_res_t                 m_res;                                 /**< Response to the last write request. */
+static nrf_dfu_res_t                 m_page_res;                            /**< Response to the write request of the last unconfirmed page. */
+
+
+static nrf_dfu_res_code_t buf_write(void) {
+    nrf_dfu_res_code_t res_code;
+
+    m_req.p_req = (uint8_t *)m_buf;
+    m_req.req_len = m_len;
+    m_len = 0;
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &m_req, &m_res);
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+        NRF_LOG_INFO("Failure to run packet write\r\n");
+    }
+
+    return res_code;
+}
+
+
+/**@brief Function for handing the staged data to the request handler as an unconfirmed page.
+ */
+static nrf_dfu_res_code_t page_write(void) {
+    nrf_dfu_res_code_t res_code;
+
+    res_code = buf_write();
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+        return res_code;
+    }
+
+    m_page_res = m_res;
+
+    if (m_unconfirmed++ == 0) {
+        (void)app_timer_start(m_poll_timer,
+            APP_TIMER_TICKS_COMPAT(NRF_DFU_PAGE_WRITER_POLL_MS, APP_TIMER_PRESCALER),
+            NULL);
+    }
+
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+/**@brief Timer handler checking whether flash has programmed the unconfirmed pages.
+ *
+ * @details fstorage runs its operations in order, so once its queue is empty every page handed
+ *          to the request handler before is in flash. A full page that was kept back because
+ *          the request handler could not hold more is handed over first, the handler is only
+ *          notified once that page is in flash as well.
+ */
+static void poll_timeout_handler(void *p_context) {
+    nrf_dfu_res_code_t res_code;
+    uint32_t           op_count;
+
+    UNUSED_PARAMETER(p_context);
+
+    if ((fs_queued_op_count_get(&op_count) != FS_SUCCESS) || (op_count != 0)) {
+        return;
+    }
+
+    m_unconfirmed = 0;
+
+    if (m_len == NRF_DFU_PAGE_WRITER_BUF_SIZE) {
+        res_code = buf_write();
+        if (res_code == NRF_DFU_RES_CODE_SUCCESS) {
+            m_page_res = m_res;
+            m_unconfirmed = 1;
+            return;
+        }
+
+        if (m_res_code == NRF_DFU_RES_CODE_SUCCESS) {
+            m_res_code = res_code;
+        }
+    }
+
+    (void)app_timer_stop(m_poll_timer);
+
+    if (m_handler != NULL) {
+        m_handler(m_res_code, &m_page_res);
+    }
+
+    m_res_code = NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+uint32_t nrf_dfu_page_writer_init(nrf_dfu_page_writer_handler_t handler) {
+    m_handler = handler;
+    m_len = 0;
+    m_unconfirmed = 0;
+    m_res_code = NRF_DFU_RES_CODE_SUCCESS;
+
+    return app_timer_create(&m_poll_timer, APP_TIMER_MODE_REPEATED, poll_timeout_handler);
+}
+
+
+nrf_dfu_res_code_t nrf_dfu_page_writer_write(uint8_t const *p_data, uint32_t len) {
+    nrf_dfu_res_code_t res_code;
+
+    while (len > 0) {
+        uint32_t chunk_len;
+
+        if (m_len == NRF_DFU_PAGE_WRITER_BUF_SIZE) {
+            // The peer did not wait for the flash.
+            if (m_unconfirmed >= NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED) {
+                NRF_LOG_ERROR("Page writer overrun, %d bytes dropped\r\n", len);
+                return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+            }
+
+            res_code = page_write();
+            if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+                return res_code;
+            }
+        }
+
+        chunk_len = MIN(len, NRF_DFU_PAGE_WRITER_BUF_SIZE - m_len);
+
+        memcpy((uint8_t *)m_buf + m_len, p_data, chunk_len);
+        m_len += chunk_len;
+        p_data += chunk_len;
+        len -= chunk_len;
+    }
+
+    // A full page waits in the staging buffer while the request handler cannot hold it.
+    if ((m_len == NRF_DFU_PAGE_WRITER_BUF_SIZE) &&
+        (m_unconfirmed < NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED)) {
+        return page_write();
+    }
+
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+nrf_dfu_res_code_t nrf_dfu_page_writer_flush(nrf_dfu_res_t *p_res) {
+    nrf_dfu_res_code_t res_code = NRF_DFU_RES_CODE_SUCCESS;
+
+    if (m_unconfirmed >= NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED) {
+        return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+    }
+
+    if (m_len > 0) {
+        res_code = page_write();
+    }
+
+    if (p_res != NULL) {
+        *p_res = m_res;
+    }
+
+    return res_code;
+}
+
+
+bool nrf_dfu_page_writer_is_busy(void) {
+    return (m_unconfirmed != 0);
+}
+
+
+uint32_t nrf_dfu_page_writer_backlog_get(void) {
+    return m_len + (uint32_t)m_unconfirmed * NRF_DFU_PAGE_WRITER_BUF_SIZE;
+}
+
+
+uint32_t nrf_dfu_page_writer_room_get(void) {
+    uint32_t backlog = nrf_dfu_page_writer_backlog_get();
+
+    return (backlog < NRF_DFU_PAGE_WRITER_CAPACITY) ? (NRF_DFU_PAGE_WRITER_CAPACITY - backlog) : 0;
+}
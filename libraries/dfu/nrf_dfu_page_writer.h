@@ -0,0 +1,114 @@
+#ifndef NRF_DFU_PAGE_WRITER_H__
+#define NRF_DFU_PAGE_WRITER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_dfu_req_handler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NRF_DFU_PAGE_WRITER_BUF_SIZE
+#define NRF_DFU_PAGE_WRITER_BUF_SIZE    CODE_PAGE_SIZE      /**< Size (in bytes) of the staging buffer, one flash page. */
+#endif
+
+#ifndef NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED
+#define NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED 2               /**< Number of pages the request handler can hold while they are being programmed. Further data waits in the staging buffer. */
+#endif
+
+#ifndef NRF_DFU_PAGE_WRITER_POLL_MS
+#define NRF_DFU_PAGE_WRITER_POLL_MS     5                   /**< Interval (in milliseconds) at which the flash queue is checked while pages are being programmed. */
+#endif
+
+#define NRF_DFU_PAGE_WRITER_CAPACITY    ((NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED + 1) * NRF_DFU_PAGE_WRITER_BUF_SIZE) /**< Amount of data (in bytes) the page writer can hold before flash has caught up. */
+
+
+  /** @brief Function type for being notified when the pages handed to the request handler are in flash.
+   *
+   * @param[in] res_code    Result of the first failed write of a page that was kept back in the
+   *                        staging buffer since the last notification, or NRF_DFU_RES_CODE_SUCCESS.
+   *                        Other failures are returned by the call that caused them.
+   * @param[in] p_res       Response of the request handler to the last page handed over.
+   */
+  typedef void (*nrf_dfu_page_writer_handler_t)(nrf_dfu_res_code_t res_code, nrf_dfu_res_t const *p_res);
+
+
+  /** @brief Function for initializing the page writer.
+   *
+   * @details Must be called after the app_timer module was initialized.
+   *
+   * @param[in] handler   Function called each time the flash has programmed all pages handed to the
+   *                      request handler. Can be NULL.
+   *
+   * @return  NRF_SUCCESS or the error of creating the poll timer.
+   */
+  uint32_t nrf_dfu_page_writer_init(nrf_dfu_page_writer_handler_t handler);
+
+
+  /** @brief Function for adding data object data to the page writer.
+   *
+   * @details Data is accumulated in a page sized staging buffer, which is handed to the request
+   *          handler as soon as it is full. The page then counts as unconfirmed until the flash
+   *          operation queue has run empty. While @ref NRF_DFU_PAGE_WRITER_MAX_UNCONFIRMED pages
+   *          are unconfirmed, a full staging buffer is kept back until flash has caught up. The
+   *          caller is expected to hold back the DFU Controller while
+   *          @ref nrf_dfu_page_writer_is_busy returns true, and to pass at most
+   *          @ref nrf_dfu_page_writer_room_get bytes.
+   *
+   * @param[in] p_data    Data to write.
+   * @param[in] len       Length of the data.
+   *
+   * @retval  NRF_DFU_RES_CODE_SUCCESS                  If all data was taken.
+   * @retval  NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES   If the staging buffer was full while the
+   *                                                    request handler could not hold another page.
+   *                                                    The data that did not fit is dropped.
+   * @return  Otherwise the result of the failed write request.
+   */
+  nrf_dfu_res_code_t nrf_dfu_page_writer_write(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Function for handing all staged data to the request handler.
+   *
+   * @details Must be called before any other request is handed to the request handler. A
+   *          partial page counts as unconfirmed like a full one, so the request should wait
+   *          until @ref nrf_dfu_page_writer_is_busy returns false again.
+   *
+   * @param[out] p_res    Response of the request handler to the last write. Can be NULL.
+   *
+   * @retval  NRF_DFU_RES_CODE_SUCCESS                  If all staged data was handed over.
+   * @retval  NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES   If the request handler cannot hold another
+   *                                                    page yet. Nothing was handed over.
+   * @return  Otherwise the result of the failed write request.
+   */
+  nrf_dfu_res_code_t nrf_dfu_page_writer_flush(nrf_dfu_res_t *p_res);
+
+
+  /** @brief Function for checking if pages handed to the request handler are not yet in flash.
+   *
+   * @retval  true    If at least one page is still being programmed.
+   * @retval  false   If all pages handed to the request handler are in flash.
+   */
+  bool nrf_dfu_page_writer_is_busy(void);
+
+
+  /** @brief Function for getting the amount of data the flash has not caught up with yet.
+   *
+   * @return  Number of bytes in the staging buffer and in pages that are still being programmed.
+   */
+  uint32_t nrf_dfu_page_writer_backlog_get(void);
+
+
+  /** @brief Function for getting the amount of data the page writer can take right now.
+   *
+   * @return  Number of bytes @ref nrf_dfu_page_writer_write accepts without dropping any.
+   */
+  uint32_t nrf_dfu_page_writer_room_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_PAGE_WRITER_H__
+
+/** @} */
@@ -0,0 +1,221 @@
+#include "nrf_dfu_serial.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+#define CREATE_PARAM_LEN        6       /**< Length of a Create Object request: opcode, object type and object size. */
+#define SET_PRN_PARAM_LEN       3       /**< Length of a Set Packet Receipt Notification request: opcode and target. */
+#define SELECT_PARAM_LEN        2       /**< Length of a Select Object request: opcode and object type. */
+#define PING_PARAM_LEN          2       /**< Length of a Ping request: opcode and ping id. */
+
+
+/**@brief Function for encoding the response header and sending the response.
+ *
+ * @param[in] p_serial  Parser state, the payload is already encoded behind the header.
+ * @param[in] op_code   Opcode of the request.
+ * @param[in] res_code  Result of the request.
+ * @param[in] len       Length of the payload.
+ */
+static void response_send(nrf_dfu_serial_t *p_serial, uint8_t op_code, nrf_dfu_res_code_t res_code, uint32_t len) {
+    NRF_LOG_INFO("Sending Response: [0x%01x, 0x%01x]\r\n", op_code, res_code);
+
+    p_serial->rsp_buf[0] = NRF_DFU_SERIAL_OP_CODE_RESPONSE;
+    p_serial->rsp_buf[1] = op_code;
+    p_serial->rsp_buf[2] = (uint8_t)res_code;
+
+    // Errors carry no payload.
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+        len = 0;
+    }
+
+    p_serial->rsp_func(p_serial->rsp_buf, 3 + len);
+}
+
+
+/**@brief Function for asking the request handler for the checksum and sending it.
+ *
+ * @param[in] p_serial  Parser state.
+ */
+static void crc_send(nrf_dfu_serial_t *p_serial) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+    uint32_t            len = 0;
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_CRC;
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+
+    len += uint32_encode(dfu_res.offset, &p_serial->rsp_buf[3 + len]);
+    len += uint32_encode(dfu_res.crc, &p_serial->rsp_buf[3 + len]);
+
+    response_send(p_serial, NRF_DFU_SERIAL_OP_CODE_CALCULATE_CRC, res_code, len);
+}
+
+
+/**@brief Function for handling a Write Object request.
+ *
+ * @param[in] p_serial  Parser state.
+ * @param[in] p_data    Object data.
+ * @param[in] len       Length of the object data.
+ */
+static void on_object_write(nrf_dfu_serial_t *p_serial, uint8_t const *p_data, uint32_t len) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_WRITE;
+    dfu_req.p_req = (uint8_t *)p_data;
+    dfu_req.req_len = len;
+
+    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS) {
+        NRF_LOG_INFO("Failure to run packet write\r\n");
+        response_send(p_serial, NRF_DFU_SERIAL_OP_CODE_WRITE_OBJECT, res_code, 0);
+        return;
+    }
+
+    // Writes are not acknowledged one by one, the checksum notification paces the DFU Controller.
+    if (p_serial->pkt_notif_target == 0) {
+        return;
+    }
+
+    p_serial->pkt_notif_target_cnt--;
+    if (p_serial->pkt_notif_target_cnt == 0) {
+        p_serial->pkt_notif_target_cnt = p_serial->pkt_notif_target;
+        crc_send(p_serial);
+    }
+}
+
+
+void nrf_dfu_serial_init(nrf_dfu_serial_t           *p_serial,
+                         nrf_dfu_transport_t const  *p_transport,
+                         nrf_dfu_serial_rsp_func_t   rsp_func,
+                         uint16_t                    mtu) {
+    memset(p_serial, 0, sizeof(nrf_dfu_serial_t));
+
+    p_serial->p_transport = p_transport;
+    p_serial->rsp_func = rsp_func;
+    p_serial->mtu = mtu;
+}
+
+
+void nrf_dfu_serial_on_packet(nrf_dfu_serial_t *p_serial, uint8_t const *p_data, uint32_t len) {
+    nrf_dfu_res_code_t  res_code;
+    nrf_dfu_req_t       dfu_req;
+    nrf_dfu_res_t       dfu_res = { {{0}} };
+    uint32_t            rsp_len = 0;
+    uint8_t             op_code;
+
+    if (len == 0) {
+        return;
+    }
+
+    op_code = p_data[0];
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+
+    if (!nrf_dfu_transports_session_check(p_serial->p_transport)) {
+        response_send(p_serial, op_code, NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED, 0);
+        return;
+    }
+
+    switch (op_code) {
+        case NRF_DFU_SERIAL_OP_CODE_CREATE_OBJECT:
+            NRF_LOG_INFO("Received create object\r\n");
+            if (len != CREATE_PARAM_LEN) {
+                response_send(p_serial, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, 0);
+                return;
+            }
+
+            // The first transport to create an object owns the DFU session.
+            if (nrf_dfu_transports_session_acquire(p_serial->p_transport) != NRF_SUCCESS) {
+                response_send(p_serial, op_code, NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED, 0);
+                return;
+            }
+
+            // Reset the packet receipt notification on create object
+            p_serial->pkt_notif_target_cnt = p_serial->pkt_notif_target;
+
+            dfu_req.req_type = NRF_DFU_OBJECT_OP_CREATE;
+            dfu_req.obj_type = p_data[1];
+            dfu_req.object_size = uint32_decode(&p_data[2]);
+
+            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+            response_send(p_serial, op_code, res_code, 0);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_SET_RECEIPT_NOTIF:
+            NRF_LOG_INFO("Set receipt notif\r\n");
+            if (len != SET_PRN_PARAM_LEN) {
+                response_send(p_serial, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, 0);
+                return;
+            }
+
+            p_serial->pkt_notif_target = uint16_decode(&p_data[1]);
+            p_serial->pkt_notif_target_cnt = p_serial->pkt_notif_target;
+
+            response_send(p_serial, op_code, NRF_DFU_RES_CODE_SUCCESS, 0);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_CALCULATE_CRC:
+            NRF_LOG_INFO("Received calculate CRC\r\n");
+            crc_send(p_serial);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_EXECUTE_OBJECT:
+            NRF_LOG_INFO("Received execute object\r\n");
+            dfu_req.req_type = NRF_DFU_OBJECT_OP_EXECUTE;
+
+            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+            response_send(p_serial, op_code, res_code, 0);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_SELECT_OBJECT:
+            NRF_LOG_INFO("Received select object\r\n");
+            if (len != SELECT_PARAM_LEN) {
+                response_send(p_serial, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, 0);
+                return;
+            }
+
+            dfu_req.req_type = NRF_DFU_OBJECT_OP_SELECT;
+            dfu_req.obj_type = p_data[1];
+
+            res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+
+            rsp_len += uint32_encode(dfu_res.max_size, &p_serial->rsp_buf[3 + rsp_len]);
+            rsp_len += uint32_encode(dfu_res.offset, &p_serial->rsp_buf[3 + rsp_len]);
+            rsp_len += uint32_encode(dfu_res.crc, &p_serial->rsp_buf[3 + rsp_len]);
+
+            response_send(p_serial, op_code, res_code, rsp_len);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_GET_MTU:
+            rsp_len += uint16_encode(p_serial->mtu, &p_serial->rsp_buf[3]);
+            response_send(p_serial, op_code, NRF_DFU_RES_CODE_SUCCESS, rsp_len);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_WRITE_OBJECT:
+            on_object_write(p_serial, &p_data[1], len - 1);
+            return;
+
+        case NRF_DFU_SERIAL_OP_CODE_PING:
+            if (len != PING_PARAM_LEN) {
+                response_send(p_serial, op_code, NRF_DFU_RES_CODE_INVALID_PARAMETER, 0);
+                return;
+            }
+
+            p_serial->rsp_buf[3] = p_data[1];
+            response_send(p_serial, op_code, NRF_DFU_RES_CODE_SUCCESS, 1);
+            return;
+
+        default:
+            NRF_LOG_INFO("Received unsupported OP code\r\n");
+            response_send(p_serial, op_code, NRF_DFU_RES_CODE_OP_CODE_NOT_SUPPORTED, 0);
+            return;
+    }
+}
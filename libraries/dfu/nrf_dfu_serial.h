@@ -0,0 +1,82 @@
+#ifndef NRF_DFU_SERIAL_H__
+#define NRF_DFU_SERIAL_H__
+
+#include <stdint.h>
+#include "nrf_dfu_req_handler.h"
+#include "nrf_dfu_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NRF_DFU_SERIAL_RSP_MAX_LEN      16          /**< Length (in bytes) of the longest response. */
+
+
+  /** @brief Serial DFU opcodes.
+   *
+   * @details The opcodes of the BLE control point, with object data sent as Write Object
+   *          requests on the same channel.
+   */
+  typedef enum {
+    NRF_DFU_SERIAL_OP_CODE_CREATE_OBJECT = 0x01,        /**< Value of the opcode field for a 'Create object' request. */
+    NRF_DFU_SERIAL_OP_CODE_SET_RECEIPT_NOTIF = 0x02,    /**< Value of the opcode field for a 'Set Packet Receipt Notification' request. */
+    NRF_DFU_SERIAL_OP_CODE_CALCULATE_CRC = 0x03,        /**< Value of the opcode field for a 'Calculating checksum' request. */
+    NRF_DFU_SERIAL_OP_CODE_EXECUTE_OBJECT = 0x04,       /**< Value of the opcode field for an 'Execute object' request. */
+    NRF_DFU_SERIAL_OP_CODE_SELECT_OBJECT = 0x06,        /**< Value of the opcode field for a 'Select object' request. */
+    NRF_DFU_SERIAL_OP_CODE_GET_MTU = 0x07,              /**< Value of the opcode field for a 'Get MTU' request. */
+    NRF_DFU_SERIAL_OP_CODE_WRITE_OBJECT = 0x08,         /**< Value of the opcode field for a 'Write object' request. */
+    NRF_DFU_SERIAL_OP_CODE_PING = 0x09,                 /**< Value of the opcode field for a 'Ping' request. */
+    NRF_DFU_SERIAL_OP_CODE_RESPONSE = 0x60              /**< Value of the opcode field for a response. */
+  } nrf_dfu_serial_op_code_t;
+
+
+  /** @brief Function type for sending a response to the DFU Controller.
+   *
+   * @param[in] p_data    Encoded response, valid until the function returns.
+   * @param[in] len       Length of the response.
+   */
+  typedef void (*nrf_dfu_serial_rsp_func_t)(uint8_t const *p_data, uint32_t len);
+
+
+  /** @brief Request parser state of one serial DFU transport. */
+  typedef struct {
+    nrf_dfu_transport_t const  *p_transport;                    /**< Registration of the transport, used for the DFU session arbitration. */
+    nrf_dfu_serial_rsp_func_t   rsp_func;                       /**< Function sending responses on the transport. */
+    uint16_t                    mtu;                            /**< Length (in bytes) of the longest request the transport can receive. */
+    uint16_t                    pkt_notif_target;               /**< Number of Write Object requests between two checksum notifications, 0 to disable them. */
+    uint16_t                    pkt_notif_target_cnt;           /**< Number of Write Object requests left until the next checksum notification. */
+    uint8_t                     rsp_buf[NRF_DFU_SERIAL_RSP_MAX_LEN]; /**< Buffer the responses are encoded in. */
+  } nrf_dfu_serial_t;
+
+
+  /** @brief Function for initializing the request parser of a serial DFU transport.
+   *
+   * @param[out] p_serial     Parser state.
+   * @param[in]  p_transport  Registration of the transport.
+   * @param[in]  rsp_func     Function sending responses on the transport.
+   * @param[in]  mtu          Length (in bytes) of the longest request the transport can receive.
+   */
+  void nrf_dfu_serial_init(nrf_dfu_serial_t           *p_serial,
+                           nrf_dfu_transport_t const  *p_transport,
+                           nrf_dfu_serial_rsp_func_t   rsp_func,
+                           uint16_t                    mtu);
+
+
+  /** @brief Function for handling a request received by a serial DFU transport.
+   *
+   * @details Decodes the request, hands it to the request handler and sends the response.
+   *          Must be called from the scheduler, like the request handling of the BLE transport.
+   *
+   * @param[in] p_serial  Parser state.
+   * @param[in] p_data    Request, starting with the opcode.
+   * @param[in] len       Length of the request.
+   */
+  void nrf_dfu_serial_on_packet(nrf_dfu_serial_t *p_serial, uint8_t const *p_data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_SERIAL_H__
+
+/** @} */
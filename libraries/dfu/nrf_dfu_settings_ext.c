@@ -0,0 +1,300 @@
+#include "nrf_dfu_settings_ext.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "nrf_dfu_crc32.h"
+#include "nrf_log.h"
+
+#define SETTINGS_EXT_WORDS      (sizeof(nrf_dfu_settings_ext_t) / sizeof(uint32_t))                 /**< Length of @ref nrf_dfu_settings_ext_t in words. */
+#define BOOT_TALLY_ADDRESS      (NRF_DFU_SETTINGS_EXT_ADDRESS + sizeof(nrf_dfu_settings_ext_t))     /**< First word of the boot tally. */
+#define BOOT_TALLY_ERASED       0xFFFFFFFF                                                          /**< Value of a boot tally word that was not counted yet. */
+#define BOOT_TALLY_COUNTED      0x00000000                                                          /**< Value of a counted boot tally word. */
+#define CHECKPOINT_ADDRESS      (BOOT_TALLY_ADDRESS + NRF_DFU_BOOT_TALLY_MAX * sizeof(uint32_t))     /**< First progress checkpoint. */
+#define CHECKPOINT_WORDS        (sizeof(nrf_dfu_checkpoint_t) / sizeof(uint32_t))                   /**< Length of @ref nrf_dfu_checkpoint_t in words. */
+#define CHECKPOINT_ERASED       0xFFFFFFFF                                                          /**< Value of the key of a checkpoint that was not stored yet. */
+
+STATIC_ASSERT((NRF_DFU_SETTINGS_EXT_ADDRESS % CODE_PAGE_SIZE) == 0);
+STATIC_ASSERT(NRF_DFU_SETTINGS_EXT_ADDRESS >= BOOTLOADER_START_ADDR);
+STATIC_ASSERT((NRF_DFU_SETTINGS_EXT_ADDRESS + CODE_PAGE_SIZE) <= BOOTLOADER_SETTINGS_ADDRESS);
+#if defined(NRF_MBR_PARAMS_PAGE_ADDRESS)
+STATIC_ASSERT((NRF_DFU_SETTINGS_EXT_ADDRESS + CODE_PAGE_SIZE) <= NRF_MBR_PARAMS_PAGE_ADDRESS);
+#endif
+STATIC_ASSERT((sizeof(nrf_dfu_settings_ext_t) % sizeof(uint32_t)) == 0);
+STATIC_ASSERT((sizeof(nrf_dfu_settings_ext_t) +
+               NRF_DFU_BOOT_TALLY_MAX * sizeof(uint32_t) +
+               NRF_DFU_CHECKPOINT_MAX * sizeof(nrf_dfu_checkpoint_t)) <= CODE_PAGE_SIZE);
+
+/**@brief Reservation of the extended settings page, keeps the linker from placing code in it. */
+#if defined ( __CC_ARM )
+    uint8_t m_dfu_settings_ext_buffer[CODE_PAGE_SIZE] __attribute__((at(NRF_DFU_SETTINGS_EXT_ADDRESS))) __attribute__((used));
+#elif defined ( __GNUC__ )
+    uint8_t m_dfu_settings_ext_buffer[CODE_PAGE_SIZE] __attribute__((section(".bootloaderSettingsExt"))) __attribute__((used));
+    extern uint8_t __bootloader_settings_ext_start__[];    /**< Start of the page, set by nrf_dfu_settings_ext_gcc.ld. */
+#elif defined ( __ICCARM__ )
+    __no_init __root uint8_t m_dfu_settings_ext_buffer[CODE_PAGE_SIZE] @ NRF_DFU_SETTINGS_EXT_ADDRESS;
+#else
+    #error Not a valid compiler/linker for m_dfu_settings_ext_buffer placement.
+#endif
+
+nrf_dfu_settings_ext_t s_dfu_settings_ext;
+
+static const uint32_t m_boot_tally_counted[NRF_DFU_BOOT_TALLY_MAX] = { BOOT_TALLY_COUNTED };     /**< Source of boot tally writes, must outlive the flash operation. All words are BOOT_TALLY_COUNTED (0). */
+
+static nrf_dfu_checkpoint_t m_checkpoint;                          /**< Source of checkpoint writes, must outlive the flash operation. */
+static bool     m_checkpoint_pending;                              /**< Whether @ref m_checkpoint is still being programmed. */
+static dfu_flash_callback_t m_checkpoint_callback;                  /**< Callback of the policy write that programs @ref m_checkpoint again. */
+static uint32_t m_checkpoint_next = NRF_DFU_CHECKPOINT_MAX + 1;     /**< Index of the next free checkpoint slot, out of range until the page was scanned. */
+
+static const uint32_t m_timeout_defaults[NRF_DFU_TIMEOUT_REASON_COUNT] = {
+    [NRF_DFU_TIMEOUT_FIRST_BOOT]      = NRF_DFU_TIMEOUT_FIRST_BOOT_MS,
+    [NRF_DFU_TIMEOUT_BUTTONLESS]      = NRF_DFU_TIMEOUT_BUTTONLESS_MS,
+    [NRF_DFU_TIMEOUT_INVALID_APP]     = NRF_DFU_TIMEOUT_INVALID_APP_MS,
+    [NRF_DFU_TIMEOUT_POST_DISCONNECT] = NRF_DFU_TIMEOUT_POST_DISCONNECT_MS,
+};
+
+
+static uint32_t settings_ext_crc(nrf_dfu_settings_ext_t const *p_settings) {
+    return nrf_dfu_crc32_update(0,
+        (uint8_t const *)p_settings + sizeof(p_settings->crc),
+        sizeof(nrf_dfu_settings_ext_t) - sizeof(p_settings->crc));
+}
+
+
+void nrf_dfu_settings_ext_init(void) {
+    nrf_dfu_settings_ext_t const *p_flash = (nrf_dfu_settings_ext_t const *)NRF_DFU_SETTINGS_EXT_ADDRESS;
+
+#if !defined ( __CC_ARM ) && defined ( __GNUC__ )
+    // The linker script must reserve the page that is written, code placed there would be erased.
+    if ((uint32_t)__bootloader_settings_ext_start__ != NRF_DFU_SETTINGS_EXT_ADDRESS) {
+        NRF_LOG_ERROR("Extended settings page linked at 0x%08x\r\n", (uint32_t)__bootloader_settings_ext_start__);
+        APP_ERROR_HANDLER(NRF_ERROR_INVALID_ADDR);
+    }
+#endif
+
+    if ((p_flash->settings_version == NRF_DFU_SETTINGS_EXT_VERSION) &&
+        (p_flash->crc == settings_ext_crc(p_flash))) {
+        memcpy(&s_dfu_settings_ext, p_flash, sizeof(nrf_dfu_settings_ext_t));
+        return;
+    }
+
+    NRF_LOG_INFO("Extended settings invalid, using defaults\r\n");
+
+    memset(&s_dfu_settings_ext, 0, sizeof(nrf_dfu_settings_ext_t));
+    s_dfu_settings_ext.settings_version = NRF_DFU_SETTINGS_EXT_VERSION;
+    memcpy(s_dfu_settings_ext.timeout_ms, m_timeout_defaults, sizeof(m_timeout_defaults));
+}
+
+
+uint32_t nrf_dfu_settings_ext_write(dfu_flash_callback_t callback) {
+    s_dfu_settings_ext.crc = settings_ext_crc(&s_dfu_settings_ext);
+
+    if (nrf_dfu_flash_erase((uint32_t const *)NRF_DFU_SETTINGS_EXT_ADDRESS, 1, NULL) != FS_SUCCESS) {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    m_checkpoint_next = 0;
+
+    if (nrf_dfu_flash_store((uint32_t const *)NRF_DFU_SETTINGS_EXT_ADDRESS,
+            (uint32_t const *)&s_dfu_settings_ext,
+            SETTINGS_EXT_WORDS,
+            callback) != FS_SUCCESS) {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+static void checkpoint_written(fs_evt_t const * const evt, fs_ret_t result) {
+    dfu_flash_callback_t callback = m_checkpoint_callback;
+
+    m_checkpoint_pending = false;
+    m_checkpoint_callback = NULL;
+
+    if (callback != NULL) {
+        callback(evt, result);
+    }
+}
+
+
+/**@brief Function for writing the extended settings to flash, keeping the last checkpoint.
+ *
+ * @param[in] keep_tally    Whether the counted boots are programmed again as well.
+ * @param[in] callback      Function called when the write is done. Can be NULL.
+ */
+static uint32_t settings_ext_rewrite(bool keep_tally, dfu_flash_callback_t callback) {
+    uint32_t const *p_tally = (uint32_t const *)BOOT_TALLY_ADDRESS;
+    uint32_t        tally_count = 0;
+    bool            checkpoint_found;
+    uint32_t        err_code;
+
+    // The last checkpoint is programmed again from m_checkpoint.
+    if (m_checkpoint_pending) {
+        return NRF_ERROR_BUSY;
+    }
+
+    while (keep_tally &&
+           (tally_count < NRF_DFU_BOOT_TALLY_MAX) &&
+           (p_tally[tally_count] != BOOT_TALLY_ERASED)) {
+        tally_count++;
+    }
+
+    checkpoint_found = nrf_dfu_settings_ext_checkpoint_get(&m_checkpoint);
+
+    // fstorage runs the operations in order, the callback goes with the last one.
+    err_code = nrf_dfu_settings_ext_write(((tally_count == 0) && !checkpoint_found) ? callback : NULL);
+    VERIFY_SUCCESS(err_code);
+
+    if ((tally_count > 0) &&
+        (nrf_dfu_flash_store(p_tally,
+            m_boot_tally_counted,
+            tally_count,
+            checkpoint_found ? NULL : callback) != FS_SUCCESS)) {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (checkpoint_found) {
+        m_checkpoint_pending = true;
+        m_checkpoint_callback = callback;
+
+        if (nrf_dfu_flash_store((uint32_t const *)CHECKPOINT_ADDRESS,
+                (uint32_t const *)&m_checkpoint,
+                CHECKPOINT_WORDS,
+                checkpoint_written) != FS_SUCCESS) {
+            m_checkpoint_pending = false;
+            m_checkpoint_callback = NULL;
+            return NRF_ERROR_INTERNAL;
+        }
+
+        m_checkpoint_next = 1;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t nrf_dfu_settings_ext_policy_write(dfu_flash_callback_t callback) {
+    return settings_ext_rewrite(true, callback);
+}
+
+
+uint32_t nrf_dfu_settings_ext_cache_write(dfu_flash_callback_t callback) {
+    return settings_ext_rewrite(false, callback);
+}
+
+
+bool nrf_dfu_settings_ext_boot_tally(uint32_t interval) {
+    uint32_t const *p_tally = (uint32_t const *)BOOT_TALLY_ADDRESS;
+
+    interval = MIN(interval, NRF_DFU_BOOT_TALLY_MAX);
+
+    for (uint32_t i = 0; i < interval; i++) {
+        if (p_tally[i] == BOOT_TALLY_ERASED) {
+            (void)nrf_dfu_flash_store(&p_tally[i], m_boot_tally_counted, 1, NULL);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static uint32_t checkpoint_check(nrf_dfu_checkpoint_t const *p_checkpoint) {
+    return ~(p_checkpoint->key ^ p_checkpoint->offset ^ p_checkpoint->crc);
+}
+
+
+uint32_t nrf_dfu_settings_ext_checkpoint_store(uint32_t key, uint32_t offset, uint32_t crc) {
+    nrf_dfu_checkpoint_t const *p_slots = (nrf_dfu_checkpoint_t const *)CHECKPOINT_ADDRESS;
+    uint32_t                    err_code;
+
+    if (key == CHECKPOINT_ERASED) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // m_checkpoint is the source of the write that is still queued.
+    if (m_checkpoint_pending) {
+        return NRF_ERROR_BUSY;
+    }
+
+    // Flash is only scanned once, a slot that is still being programmed looks free.
+    if (m_checkpoint_next > NRF_DFU_CHECKPOINT_MAX) {
+        for (m_checkpoint_next = 0; m_checkpoint_next < NRF_DFU_CHECKPOINT_MAX; m_checkpoint_next++) {
+            if (p_slots[m_checkpoint_next].key == CHECKPOINT_ERASED) {
+                break;
+            }
+        }
+    }
+
+    // All slots used, start over on a fresh page.
+    if (m_checkpoint_next == NRF_DFU_CHECKPOINT_MAX) {
+        err_code = nrf_dfu_settings_ext_write(NULL);
+        VERIFY_SUCCESS(err_code);
+    }
+
+    m_checkpoint.key = key;
+    m_checkpoint.offset = offset;
+    m_checkpoint.crc = crc;
+    m_checkpoint.check = checkpoint_check(&m_checkpoint);
+
+    m_checkpoint_pending = true;
+
+    if (nrf_dfu_flash_store((uint32_t const *)&p_slots[m_checkpoint_next],
+            (uint32_t const *)&m_checkpoint,
+            CHECKPOINT_WORDS,
+            checkpoint_written) != FS_SUCCESS) {
+        m_checkpoint_pending = false;
+        return NRF_ERROR_INTERNAL;
+    }
+
+    m_checkpoint_next++;
+
+    return NRF_SUCCESS;
+}
+
+
+bool nrf_dfu_settings_ext_checkpoint_get(nrf_dfu_checkpoint_t *p_checkpoint) {
+    nrf_dfu_checkpoint_t const *p_slots = (nrf_dfu_checkpoint_t const *)CHECKPOINT_ADDRESS;
+    bool                        found = false;
+
+    for (uint32_t i = 0; i < NRF_DFU_CHECKPOINT_MAX; i++) {
+        if (p_slots[i].key == CHECKPOINT_ERASED) {
+            break;
+        }
+
+        if (p_slots[i].check == checkpoint_check(&p_slots[i])) {
+            memcpy(p_checkpoint, &p_slots[i], sizeof(nrf_dfu_checkpoint_t));
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+
+bool nrf_dfu_settings_ext_timeout_is_valid(nrf_dfu_timeout_reason_t reason, uint32_t timeout_ms) {
+    if (reason >= NRF_DFU_TIMEOUT_REASON_COUNT) {
+        return false;
+    }
+
+    if ((timeout_ms == 0) && (reason == NRF_DFU_TIMEOUT_INVALID_APP)) {
+        return true;
+    }
+
+    return (timeout_ms >= NRF_DFU_TIMEOUT_MIN_MS) && (timeout_ms <= NRF_DFU_TIMEOUT_MAX_MS);
+}
+
+
+uint32_t nrf_dfu_settings_ext_timeout_get(nrf_dfu_timeout_reason_t reason) {
+    if (reason >= NRF_DFU_TIMEOUT_REASON_COUNT) {
+        return 0;
+    }
+
+    // A policy that slipped past validation must not lock the device in the bootloader.
+    if (!nrf_dfu_settings_ext_timeout_is_valid(reason, s_dfu_settings_ext.timeout_ms[reason])) {
+        return m_timeout_defaults[reason];
+    }
+
+    return s_dfu_settings_ext.timeout_ms[reason];
+}
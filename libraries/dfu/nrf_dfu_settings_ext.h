@@ -0,0 +1,211 @@
+#ifndef NRF_DFU_SETTINGS_EXT_H__
+#define NRF_DFU_SETTINGS_EXT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_dfu_types.h"
+#include "nrf_dfu_flash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Flash page holding the extended settings.
+ *
+ * @details The page is the last one of the bootloader flash region, right below the bootloader
+ *          settings page, or below the MBR parameters page where the SoftDevice has one. The
+ *          bootloader code must end before it: the page is reserved by m_dfu_settings_ext_buffer,
+ *          which ARM and IAR place at this address. GCC builds, of the bootloader and of
+ *          applications linking this module, must include nrf_dfu_settings_ext_gcc.ld in their
+ *          linker script, which places the .bootloaderSettingsExt section here and checks that
+ *          the FLASH region ends below it. The link fails without it, and
+ *          @ref nrf_dfu_settings_ext_init stops if the page was linked at another address.
+ */
+#ifndef NRF_DFU_SETTINGS_EXT_ADDRESS
+#if defined(NRF_MBR_PARAMS_PAGE_ADDRESS)
+#define NRF_DFU_SETTINGS_EXT_ADDRESS    (NRF_MBR_PARAMS_PAGE_ADDRESS - CODE_PAGE_SIZE)
+#else
+#define NRF_DFU_SETTINGS_EXT_ADDRESS    (BOOTLOADER_SETTINGS_ADDRESS - CODE_PAGE_SIZE)
+#endif
+#endif
+
+#define NRF_DFU_SETTINGS_EXT_VERSION    2                                               /**< Version of @ref nrf_dfu_settings_ext_t. */
+
+#define NRF_DFU_BOOT_TALLY_MAX          64                                              /**< Number of boots that can be counted between two writes of the extended settings. */
+
+#ifndef NRF_DFU_TIMEOUT_FIRST_BOOT_MS
+#define NRF_DFU_TIMEOUT_FIRST_BOOT_MS       2000                                        /**< Default time the bootloader waits after a first boot. */
+#endif
+
+#ifndef NRF_DFU_TIMEOUT_BUTTONLESS_MS
+#define NRF_DFU_TIMEOUT_BUTTONLESS_MS       60000                                       /**< Default time the bootloader waits after the application requested DFU. */
+#endif
+
+#ifndef NRF_DFU_TIMEOUT_INVALID_APP_MS
+#define NRF_DFU_TIMEOUT_INVALID_APP_MS      0                                           /**< Default time the bootloader advertises without a valid application, 0 to never give up. */
+#endif
+
+#ifndef NRF_DFU_TIMEOUT_POST_DISCONNECT_MS
+#define NRF_DFU_TIMEOUT_POST_DISCONNECT_MS  60000                                       /**< Default time the bootloader waits after the DFU Controller disconnected. */
+#endif
+
+#define NRF_DFU_CHECKPOINT_MAX          40                                              /**< Number of progress checkpoints that can be stored between two writes of the extended settings. */
+
+#define NRF_DFU_TIMEOUT_MIN_MS          500                                             /**< Shortest timeout accepted in a timeout policy. */
+#define NRF_DFU_TIMEOUT_MAX_MS          500000                                          /**< Longest timeout accepted in a timeout policy, bounded by the app_timer range. */
+
+
+  /** @brief Reasons for the bootloader to wait for a DFU Controller. */
+  typedef enum {
+    NRF_DFU_TIMEOUT_FIRST_BOOT,         /**< First boot after a power-on reset. */
+    NRF_DFU_TIMEOUT_BUTTONLESS,         /**< The application requested DFU mode, or a DFU operation is ongoing. */
+    NRF_DFU_TIMEOUT_INVALID_APP,        /**< There is no valid application. On expiry the chip goes to System OFF. */
+    NRF_DFU_TIMEOUT_POST_DISCONNECT,    /**< The DFU Controller disconnected. */
+    NRF_DFU_TIMEOUT_REASON_COUNT        /**< Number of timeout reasons. */
+  } nrf_dfu_timeout_reason_t;
+
+
+  /** @brief Settings kept next to the SDK bootloader settings.
+   *
+   * @details The SDK owns the layout of the bootloader settings page, so everything added by
+   *          this bootloader lives in its own page.
+   */
+  typedef struct {
+    uint32_t crc;                       /**< CRC32 of the rest of the structure. */
+    uint32_t settings_version;          /**< Version of the structure, @ref NRF_DFU_SETTINGS_EXT_VERSION. */
+    uint32_t app_generation;            /**< Incremented each time a new application passed full validation. */
+    uint32_t app_image_crc;             /**< Image CRC of bank 0 when the application was validated. */
+    uint32_t app_image_size;            /**< Image size of bank 0 when the application was validated. */
+    uint32_t app_header_crc;            /**< CRC32 of the start of the application when it was validated. */
+    uint32_t timeout_ms[NRF_DFU_TIMEOUT_REASON_COUNT];  /**< Timeout policy, indexed by @ref nrf_dfu_timeout_reason_t. 0 disables the timeout. */
+  } nrf_dfu_settings_ext_t;
+
+
+  /** @brief Progress of a data object transfer, stored at checkpoints. */
+  typedef struct {
+    uint32_t key;                       /**< Identifies the update the checkpoint belongs to, the CRC of its init command. */
+    uint32_t offset;                    /**< Offset of the firmware image data written so far. */
+    uint32_t crc;                       /**< CRC32 of the firmware image data written so far. */
+    uint32_t check;                     /**< Inverted XOR of the other fields, detects entries cut short by a reset. */
+  } nrf_dfu_checkpoint_t;
+
+
+  extern nrf_dfu_settings_ext_t s_dfu_settings_ext;
+
+
+  /** @brief Function for loading the extended settings from flash.
+   *
+   * @details Settings with a bad CRC or another version are replaced by defaults.
+   */
+  void nrf_dfu_settings_ext_init(void);
+
+
+  /** @brief Function for writing the extended settings to flash.
+   *
+   * @details Also clears the boot tally and the progress checkpoints.
+   *
+   * @param[in] callback  Function called when the write is done. Can be NULL.
+   *
+   * @return  NRF_SUCCESS if the write was started, otherwise an error code.
+   */
+  uint32_t nrf_dfu_settings_ext_write(dfu_flash_callback_t callback);
+
+
+  /** @brief Function for writing the extended settings to flash, keeping the boot tally and the
+   *         last progress checkpoint.
+   *
+   * @details Used when only the timeout policy changed. The page still has to be erased, the
+   *          counted boots and the last checkpoint are programmed again behind the settings.
+   *
+   * @param[in] callback  Function called when the write is done. Can be NULL.
+   *
+   * @retval  NRF_SUCCESS       If the write was started.
+   * @retval  NRF_ERROR_BUSY    If a checkpoint is still being stored.
+   * @retval  NRF_ERROR_INTERNAL  If the flash operation could not be queued.
+   */
+  uint32_t nrf_dfu_settings_ext_policy_write(dfu_flash_callback_t callback);
+
+
+  /** @brief Function for writing the extended settings to flash, clearing the boot tally but
+   *         keeping the last progress checkpoint.
+   *
+   * @details Used when the cached validation result changed. The counted boots restart from
+   *          zero, an update that is still in progress can resume from its last checkpoint.
+   *
+   * @param[in] callback  Function called when the write is done. Can be NULL.
+   *
+   * @retval  NRF_SUCCESS       If the write was started.
+   * @retval  NRF_ERROR_BUSY    If a checkpoint is still being stored.
+   * @retval  NRF_ERROR_INTERNAL  If the flash operation could not be queued.
+   */
+  uint32_t nrf_dfu_settings_ext_cache_write(dfu_flash_callback_t callback);
+
+
+  /** @brief Function for counting a boot.
+   *
+   * @details Each boot programs one word behind the extended settings, so counting needs
+   *          no page erase until the tally is cleared by @ref nrf_dfu_settings_ext_write.
+   *
+   * @param[in] interval  Number of boots to count, at most @ref NRF_DFU_BOOT_TALLY_MAX.
+   *
+   * @retval  true    If interval boots were counted since the last write.
+   * @retval  false   Otherwise.
+   */
+  bool nrf_dfu_settings_ext_boot_tally(uint32_t interval);
+
+
+  /** @brief Function for storing a progress checkpoint.
+   *
+   * @details Checkpoints are programmed one after the other behind the boot tally, so storing
+   *          one needs no page erase until all @ref NRF_DFU_CHECKPOINT_MAX entries are used.
+   *          Checkpoints are cleared by @ref nrf_dfu_settings_ext_write.
+   *
+   * @param[in] key       Identifies the update, the CRC of its init command.
+   * @param[in] offset    Offset of the firmware image data written so far.
+   * @param[in] crc       CRC32 of the firmware image data written so far.
+   *
+   * @retval  NRF_SUCCESS       If the write was started.
+   * @retval  NRF_ERROR_BUSY    If the previous checkpoint is still being stored, only one
+   *                            can be queued at a time.
+   * @retval  NRF_ERROR_INTERNAL  If the flash operation could not be queued.
+   */
+  uint32_t nrf_dfu_settings_ext_checkpoint_store(uint32_t key, uint32_t offset, uint32_t crc);
+
+
+  /** @brief Function for getting the last stored progress checkpoint.
+   *
+   * @param[out] p_checkpoint   Last checkpoint.
+   *
+   * @retval  true    If a checkpoint was found.
+   * @retval  false   If no checkpoint was stored since the extended settings were written.
+   */
+  bool nrf_dfu_settings_ext_checkpoint_get(nrf_dfu_checkpoint_t *p_checkpoint);
+
+
+  /** @brief Function for checking a timeout before it is stored in the timeout policy.
+   *
+   * @param[in] reason      Reason the timeout applies to.
+   * @param[in] timeout_ms  Timeout in milliseconds.
+   *
+   * @retval  true    If the timeout can be stored.
+   * @retval  false   If the reason is unknown or the timeout is out of range. Only
+   *                  @ref NRF_DFU_TIMEOUT_INVALID_APP can be disabled.
+   */
+  bool nrf_dfu_settings_ext_timeout_is_valid(nrf_dfu_timeout_reason_t reason, uint32_t timeout_ms);
+
+
+  /** @brief Function for getting the timeout for a reason from the timeout policy.
+   *
+   * @param[in] reason  Reason to wait for a DFU Controller.
+   *
+   * @return  Timeout in milliseconds, 0 if the bootloader should wait forever.
+   */
+  uint32_t nrf_dfu_settings_ext_timeout_get(nrf_dfu_timeout_reason_t reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_DFU_SETTINGS_EXT_H__
+
+/** @} */
@@ -39,6 +39,7 @@
  */
 
 #include "nrf_dfu_transport.h"
+#include "sdk_common.h"
 #include "nrf_log.h"
 #include "app_timer_appsh.h"
 
@@ -50,34 +51,95 @@
 NRF_SECTION_VARS_CREATE_SECTION(dfu_trans, const nrf_dfu_transport_t);
 //lint -restore
 
+STATIC_ASSERT(NRF_DFU_TRANSPORTS_MAX <= UINT8_MAX);
+
+/** @brief States of a registered DFU transport. */
+typedef enum
+{
+    NRF_DFU_TRANSPORT_STATE_UNINITIALIZED,      /**< The transport was not initialized yet. */
+    NRF_DFU_TRANSPORT_STATE_FAILED,             /**< The transport could not be initialized. */
+    NRF_DFU_TRANSPORT_STATE_READY,              /**< The transport waits for a DFU Controller. */
+    NRF_DFU_TRANSPORT_STATE_ACTIVE,             /**< The transport owns the DFU session. */
+    NRF_DFU_TRANSPORT_STATE_IDLE                /**< The transport was idled because another transport owns the DFU session. */
+} nrf_dfu_transport_state_t;
+
+#define SESSION_OWNER_NONE                  UINT8_MAX               /**< Value of @ref m_session_owner before a DFU session was started. */
+
+static nrf_dfu_transport_state_t m_states[NRF_DFU_TRANSPORTS_MAX];  /**< State of each registered transport, in section order. */
+static uint8_t                   m_session_owner = SESSION_OWNER_NONE;
+
+
+/**@brief Function for getting the number of registered transports that are tracked.
+ */
+static uint32_t transports_count(void)
+{
+    return MIN(DFU_TRANS_SECTION_VARS_COUNT, NRF_DFU_TRANSPORTS_MAX);
+}
+
+
+/**@brief Function for finding the index of a registered transport.
+ *
+ * @param[in] p_transport   Registration of the transport.
+ *
+ * @return  Index of the transport in the section, or @ref SESSION_OWNER_NONE if it is not registered.
+ */
+static uint8_t transport_index(nrf_dfu_transport_t const * p_transport)
+{
+    for (uint32_t i = 0; i < transports_count(); i++)
+    {
+        if (DFU_TRANS_SECTION_VARS_GET(i) == p_transport)
+        {
+            return (uint8_t)i;
+        }
+    }
+
+    return SESSION_OWNER_NONE;
+}
+
+
 uint32_t nrf_dfu_transports_init(const app_timer_id_t application_start_timer)
 {
-    uint32_t const num_transports = DFU_TRANS_SECTION_VARS_COUNT;
-    uint32_t ret_val = NRF_SUCCESS;
+    uint32_t const num_transports = transports_count();
+    uint32_t ret_val = NRF_ERROR_NOT_FOUND;
+    uint32_t err_code;
+    bool     any_ready = false;
 
     NRF_LOG_INFO("In nrf_dfu_transports_init\r\n");
 
     NRF_LOG_INFO("num transports: %d\r\n", num_transports);
 
+    // The section is only sized at link time, so this cannot be a static assertion.
+    if (DFU_TRANS_SECTION_VARS_COUNT > NRF_DFU_TRANSPORTS_MAX)
+    {
+        NRF_LOG_ERROR("More than %d transports registered\r\n", NRF_DFU_TRANSPORTS_MAX);
+        return NRF_ERROR_NO_MEM;
+    }
+
     for (uint32_t i = 0; i < num_transports; i++)
     {
         nrf_dfu_transport_t * const trans = DFU_TRANS_SECTION_VARS_GET(i);
-        ret_val = trans->init_func(application_start_timer);
-        if (ret_val != NRF_SUCCESS)
+        err_code = trans->init_func(application_start_timer);
+        if (err_code != NRF_SUCCESS)
         {
-            break;
+            NRF_LOG_ERROR("Transport %d failed to initialize: 0x%08x\r\n", i, err_code);
+            m_states[i] = NRF_DFU_TRANSPORT_STATE_FAILED;
+            ret_val = err_code;
+            continue;
         }
+
+        m_states[i] = NRF_DFU_TRANSPORT_STATE_READY;
+        any_ready = true;
     }
 
     NRF_LOG_INFO("After nrf_dfu_transports_init\r\n");
 
-    return ret_val;
+    return any_ready ? NRF_SUCCESS : ret_val;
 }
 
 
 uint32_t nrf_dfu_transports_close(void)
 {
-    uint32_t const num_transports = DFU_TRANS_SECTION_VARS_COUNT;
+    uint32_t const num_transports = transports_count();
     uint32_t ret_val = NRF_SUCCESS;
 
     NRF_LOG_INFO("In nrf_dfu_transports_close\r\n");
@@ -87,6 +149,13 @@ uint32_t nrf_dfu_transports_close(void)
     for (uint32_t i = 0; i < num_transports; i++)
     {
         nrf_dfu_transport_t * const trans = DFU_TRANS_SECTION_VARS_GET(i);
+
+        // Transports that never came up have nothing to close.
+        if (m_states[i] == NRF_DFU_TRANSPORT_STATE_FAILED)
+        {
+            continue;
+        }
+
         ret_val = trans->close_func();
         if (ret_val != NRF_SUCCESS)
         {
@@ -98,3 +167,54 @@ uint32_t nrf_dfu_transports_close(void)
 
     return ret_val;
 }
+
+
+uint32_t nrf_dfu_transports_session_acquire(nrf_dfu_transport_t const * p_transport)
+{
+    uint8_t const index = transport_index(p_transport);
+
+    if (index == SESSION_OWNER_NONE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_session_owner == index)
+    {
+        return NRF_SUCCESS;
+    }
+
+    if (m_session_owner != SESSION_OWNER_NONE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    NRF_LOG_INFO("Transport %d owns the DFU session\r\n", index);
+
+    m_session_owner = index;
+    m_states[index] = NRF_DFU_TRANSPORT_STATE_ACTIVE;
+
+    for (uint32_t i = 0; i < transports_count(); i++)
+    {
+        nrf_dfu_transport_t * const trans = DFU_TRANS_SECTION_VARS_GET(i);
+
+        if ((i == index) || (m_states[i] != NRF_DFU_TRANSPORT_STATE_READY))
+        {
+            continue;
+        }
+
+        m_states[i] = NRF_DFU_TRANSPORT_STATE_IDLE;
+        if (trans->idle_func != NULL)
+        {
+            trans->idle_func();
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+bool nrf_dfu_transports_session_check(nrf_dfu_transport_t const * p_transport)
+{
+    return (m_session_owner == SESSION_OWNER_NONE) ||
+           (m_session_owner == transport_index(p_transport));
+}
@@ -53,6 +53,7 @@
 #define NRF_DFU_TRANSPORT_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "section_vars.h"
 #include "app_timer.h"
 
@@ -82,6 +83,15 @@ typedef uint32_t (*nrf_dfu_init_fn_t)(app_timer_id_t);
 typedef uint32_t (*nrf_dfu_disconnect_fn_t)(void);
 
 
+/** @brief  Function type for idling a DFU transport.
+ *
+ * @details This function is called when another DFU transport started a DFU session. The
+ *          transport must stop accepting new peers and power down what it can. It stays idle
+ *          until the device is reset.
+ */
+typedef void (*nrf_dfu_idle_fn_t)(void);
+
+
 /** @brief DFU transport registration.
  *
  * @details     Every DFU transport must provide a registration of the initialization function.
@@ -90,14 +100,24 @@ typedef struct
 {
     nrf_dfu_init_fn_t       init_func;          /**< Registration of the init function to run to initialize a DFU transport. */
     nrf_dfu_disconnect_fn_t close_func;         /**< Registration of the close function to close down a DFU transport. */
+    nrf_dfu_idle_fn_t       idle_func;          /**< Registration of the idle function, called when another DFU transport owns the session. Can be NULL. */
 } nrf_dfu_transport_t;
 
 
+#ifndef NRF_DFU_TRANSPORTS_MAX
+#define NRF_DFU_TRANSPORTS_MAX      4           /**< Maximum number of registered DFU transports. */
+#endif
+
+
 /** @brief Function for initializing all the registered DFU transports.
  *
- * @retval  NRF_SUCCESS     If all DFU transport were initialized successfully.
- *                          Any other error code indicates that at least one DFU
- *                          transport could not be initialized.
+ * @details Every transport is initialized, even if another one failed. A failed
+ *          transport is left out of the DFU session arbitration.
+ *
+ * @retval  NRF_SUCCESS         If at least one DFU transport was initialized successfully.
+ * @retval  NRF_ERROR_NO_MEM    If more than @ref NRF_DFU_TRANSPORTS_MAX transports are registered,
+ *                              none of them is initialized then.
+ * @return  Otherwise the error of the last DFU transport that could not be initialized.
  */
 uint32_t nrf_dfu_transports_init(app_timer_id_t);
 
@@ -110,6 +130,29 @@ uint32_t nrf_dfu_transports_init(app_timer_id_t);
 uint32_t nrf_dfu_transports_close(void);
 
 
+/** @brief Function for starting or joining the DFU session on behalf of a DFU transport.
+ *
+ * @details Transports call this function when they receive a Create Object request. The first
+ *          transport to call it owns the session until reset, all other transports are idled.
+ *
+ * @param[in] p_transport   Registration of the calling DFU transport.
+ *
+ * @retval  NRF_SUCCESS         If the transport owns the DFU session.
+ * @retval  NRF_ERROR_BUSY      If another transport owns the DFU session.
+ */
+uint32_t nrf_dfu_transports_session_acquire(nrf_dfu_transport_t const * p_transport);
+
+
+/** @brief Function for checking if a DFU transport may forward requests to the request handler.
+ *
+ * @param[in] p_transport   Registration of the calling DFU transport.
+ *
+ * @retval  true    If no session was started yet or the transport owns it.
+ * @retval  false   If another transport owns the DFU session.
+ */
+bool nrf_dfu_transports_session_check(nrf_dfu_transport_t const * p_transport);
+
+
 /** @brief  Macro for registering a DFU transport by using section variables.
  *
  * @details     This macro places a variable in a section named "dfu_trans", which
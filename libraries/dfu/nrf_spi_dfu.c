@@ -0,0 +1,311 @@
+#include "nrf_spi_dfu.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "nrf_dfu_serial.h"
+#include "nrf_dfu_transport.h"
+#include "nrf_spis.h"
+#include "nrf_gpio.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+#include "boards.h"
+#include "nrf_log.h"
+
+#ifndef NRF_SPI_DFU_SCK_PIN
+#define NRF_SPI_DFU_SCK_PIN     SER_CON_SPIS_SCK_PIN
+#endif
+#ifndef NRF_SPI_DFU_MOSI_PIN
+#define NRF_SPI_DFU_MOSI_PIN    SER_CON_SPIS_MOSI_PIN
+#endif
+#ifndef NRF_SPI_DFU_MISO_PIN
+#define NRF_SPI_DFU_MISO_PIN    SER_CON_SPIS_MISO_PIN
+#endif
+#ifndef NRF_SPI_DFU_CSN_PIN
+#define NRF_SPI_DFU_CSN_PIN     SER_CON_SPIS_CSN_PIN
+#endif
+#ifndef NRF_SPI_DFU_RDY_PIN
+#define NRF_SPI_DFU_RDY_PIN     SER_CON_SPIS_RDY_PIN
+#endif
+#ifndef NRF_SPI_DFU_REQ_PIN
+#define NRF_SPI_DFU_REQ_PIN     SER_CON_SPIS_REQ_PIN
+#endif
+
+#define SPIS_INSTANCE           NRF_SPIS1
+#define SPIS_IRQ                SPI1_TWI1_IRQn
+#define SPIS_IRQ_HANDLER        SPI1_TWI1_IRQHandler
+
+#define LEN_FIELD_LEN           2                                   /**< Length of the length prefix of requests and responses. */
+#define RX_BUF_SIZE             (LEN_FIELD_LEN + NRF_SPI_DFU_MTU)
+#define DEF_CHARACTER           0x00                                /**< Clocked out after the responses, reads as a terminating length of 0. */
+#define ORC_CHARACTER           0xFF                                /**< Clocked out when the transaction is longer than the transmit buffer. */
+
+STATIC_ASSERT(RX_BUF_SIZE <= UINT8_MAX);
+STATIC_ASSERT(NRF_SPI_DFU_TX_BUF_SIZE <= UINT8_MAX);
+STATIC_ASSERT((LEN_FIELD_LEN + NRF_DFU_SERIAL_RSP_MAX_LEN) <= NRF_SPI_DFU_TX_BUF_SIZE);
+
+static app_timer_id_t   application_start_timer = NULL;
+
+static nrf_dfu_serial_t m_serial;                                   /**< Request parser of this transport. */
+
+static uint8_t          m_rx_bufs[2][RX_BUF_SIZE];                  /**< Receive buffers, one is armed while the other one is handled. */
+static uint8_t          m_rx_lens[2];                               /**< Number of bytes received in each buffer. */
+static volatile bool    m_rx_full[2];                               /**< Whether a buffer waits to be handled. */
+static uint8_t          m_rx_fill;                                  /**< Index of the buffer armed next, or currently armed. */
+static uint8_t          m_rx_handle;                                /**< Index of the buffer handled next. */
+
+static uint8_t          m_tx_dma[NRF_SPI_DFU_TX_BUF_SIZE];          /**< Responses handed to the SPIS. */
+static uint8_t          m_tx_dma_len;
+static uint8_t          m_tx_sent;                                  /**< Number of bytes clocked out in the last transaction. */
+static uint8_t          m_tx_pending[NRF_SPI_DFU_TX_BUF_SIZE];      /**< Responses not yet handed to the SPIS. */
+static uint8_t          m_tx_pending_len;
+
+static volatile bool    m_held;                                     /**< Whether the CPU holds the SPIS semaphore because both receive buffers are full. */
+static bool             m_active;                                   /**< Whether the SPIS is enabled. */
+
+//lint -save -e545 -esym(526, spi_dfu_trans) -esym(528, spi_dfu_trans)
+DFU_TRANSPORT_REGISTER(nrf_dfu_transport_t const spi_dfu_trans) =
+{
+    .init_func = spi_dfu_transport_init,
+    .close_func = spi_dfu_transport_close,
+    .idle_func = spi_dfu_transport_idle
+};
+//lint -restore
+
+
+static void pin_set(uint32_t pin, bool asserted) {
+    if (asserted != (NRF_SPI_DFU_PINS_ACTIVE_LOW != 0)) {
+        nrf_gpio_pin_set(pin);
+    }
+    else {
+        nrf_gpio_pin_clear(pin);
+    }
+}
+
+
+/**@brief Function for handing the next receive buffer and the waiting responses to the SPIS.
+ *
+ * @details Called with the SPIS semaphore held by the CPU, from the SPIS interrupt or with it masked.
+ *          If both receive buffers are full the semaphore is kept and RDY stays deasserted, which
+ *          holds off the SPI master until a buffer was handled.
+ */
+static void buffers_set(void) {
+    // Drop what the master clocked out, keep the rest for the next transaction.
+    if (m_tx_sent >= m_tx_dma_len) {
+        m_tx_dma_len = 0;
+    }
+    else if (m_tx_sent > 0) {
+        m_tx_dma_len -= m_tx_sent;
+        memmove(m_tx_dma, &m_tx_dma[m_tx_sent], m_tx_dma_len);
+    }
+    m_tx_sent = 0;
+
+    if ((m_tx_pending_len > 0) && ((m_tx_dma_len + m_tx_pending_len) <= NRF_SPI_DFU_TX_BUF_SIZE)) {
+        memcpy(&m_tx_dma[m_tx_dma_len], m_tx_pending, m_tx_pending_len);
+        m_tx_dma_len += m_tx_pending_len;
+        m_tx_pending_len = 0;
+    }
+
+    pin_set(NRF_SPI_DFU_REQ_PIN, (m_tx_dma_len > 0));
+
+    if (m_rx_full[m_rx_fill]) {
+        m_held = true;
+        return;
+    }
+
+    m_held = false;
+
+    nrf_spis_rx_buffer_set(SPIS_INSTANCE, m_rx_bufs[m_rx_fill], RX_BUF_SIZE);
+    nrf_spis_tx_buffer_set(SPIS_INSTANCE, m_tx_dma, m_tx_dma_len);
+    nrf_spis_task_trigger(SPIS_INSTANCE, NRF_SPIS_TASK_RELEASE);
+
+    pin_set(NRF_SPI_DFU_RDY_PIN, true);
+}
+
+
+/**@brief Function for getting the SPIS semaphore back to update the buffers.
+ *
+ * @details Called from the scheduler.
+ */
+static void buffers_update(void) {
+    CRITICAL_REGION_ENTER();
+    if (m_held) {
+        buffers_set();
+    }
+    else {
+        // ACQUIRED follows once the current transaction, if any, is over.
+        nrf_spis_task_trigger(SPIS_INSTANCE, NRF_SPIS_TASK_ACQUIRE);
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for queueing a length-prefixed response.
+ *
+ * @param[in] p_data    Response.
+ * @param[in] len       Length of the response.
+ */
+static void response_send(uint8_t const *p_data, uint32_t len) {
+    bool queued = false;
+
+    CRITICAL_REGION_ENTER();
+    if ((m_tx_pending_len + LEN_FIELD_LEN + len) <= NRF_SPI_DFU_TX_BUF_SIZE) {
+        m_tx_pending_len += uint16_encode(len, &m_tx_pending[m_tx_pending_len]);
+        memcpy(&m_tx_pending[m_tx_pending_len], p_data, len);
+        m_tx_pending_len += len;
+        queued = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (!queued) {
+        NRF_LOG_ERROR("SPI TX buffer full, dropping response\r\n");
+        return;
+    }
+
+    buffers_update();
+}
+
+
+/**@brief Scheduler event handler handling the received requests.
+ */
+static void rx_handler(void *p_event_data, uint16_t event_size) {
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    while (m_rx_full[m_rx_handle]) {
+        uint8_t const *p_buf = m_rx_bufs[m_rx_handle];
+        uint16_t       len = uint16_decode(p_buf);
+
+        // A DFU Controller is talking to us, hold off the application start.
+        if (application_start_timer != NULL) {
+            (void)app_timer_stop(application_start_timer);
+        }
+
+        if ((m_rx_lens[m_rx_handle] >= LEN_FIELD_LEN) && (len <= (m_rx_lens[m_rx_handle] - LEN_FIELD_LEN))) {
+            nrf_dfu_serial_on_packet(&m_serial, &p_buf[LEN_FIELD_LEN], len);
+        }
+        else {
+            NRF_LOG_ERROR("Truncated SPI request: %d\r\n", len);
+        }
+
+        m_rx_full[m_rx_handle] = false;
+        m_rx_handle ^= 1;
+
+        buffers_update();
+    }
+}
+
+
+void SPIS_IRQ_HANDLER(void) {
+    if (nrf_spis_event_check(SPIS_INSTANCE, NRF_SPIS_EVENT_END)) {
+        nrf_spis_event_clear(SPIS_INSTANCE, NRF_SPIS_EVENT_END);
+
+        pin_set(NRF_SPI_DFU_RDY_PIN, false);
+
+        m_tx_sent = MIN(nrf_spis_tx_amount_get(SPIS_INSTANCE), m_tx_dma_len);
+        m_rx_lens[m_rx_fill] = nrf_spis_rx_amount_get(SPIS_INSTANCE);
+
+        // Transactions that only clock out responses carry a length of 0.
+        // A request that cannot be queued for handling is dropped and its buffer armed again,
+        // otherwise both buffers end up full with nobody to empty them and RDY stays deasserted.
+        // The DFU Controller gets no response and retries.
+        if ((m_rx_lens[m_rx_fill] > LEN_FIELD_LEN) && (uint16_decode(m_rx_bufs[m_rx_fill]) != 0) &&
+            (app_sched_event_put(NULL, 0, rx_handler) == NRF_SUCCESS)) {
+            m_rx_full[m_rx_fill] = true;
+            m_rx_fill ^= 1;
+        }
+    }
+
+    // Acquired through the END_ACQUIRE short, or on request of buffers_update.
+    if (nrf_spis_event_check(SPIS_INSTANCE, NRF_SPIS_EVENT_ACQUIRED)) {
+        nrf_spis_event_clear(SPIS_INSTANCE, NRF_SPIS_EVENT_ACQUIRED);
+        buffers_set();
+    }
+}
+
+
+/**@brief Function for stopping the SPIS and deasserting the handshake pins.
+ */
+static void spis_stop(void) {
+    if (!m_active) {
+        return;
+    }
+
+    m_active = false;
+
+    NVIC_DisableIRQ(SPIS_IRQ);
+    nrf_spis_int_disable(SPIS_INSTANCE, NRF_SPIS_INT_END_MASK | NRF_SPIS_INT_ACQUIRED_MASK);
+    nrf_spis_disable(SPIS_INSTANCE);
+
+    pin_set(NRF_SPI_DFU_RDY_PIN, false);
+    pin_set(NRF_SPI_DFU_REQ_PIN, false);
+}
+
+
+uint32_t spi_dfu_transport_init(app_timer_id_t application_start_timer_) {
+    application_start_timer = application_start_timer_;
+
+    nrf_dfu_serial_init(&m_serial, &spi_dfu_trans, response_send, NRF_SPI_DFU_MTU);
+
+    m_rx_full[0] = false;
+    m_rx_full[1] = false;
+    m_rx_fill = 0;
+    m_rx_handle = 0;
+    m_tx_dma_len = 0;
+    m_tx_sent = 0;
+    m_tx_pending_len = 0;
+    m_held = false;
+
+    pin_set(NRF_SPI_DFU_RDY_PIN, false);
+    pin_set(NRF_SPI_DFU_REQ_PIN, false);
+    nrf_gpio_cfg_output(NRF_SPI_DFU_RDY_PIN);
+    nrf_gpio_cfg_output(NRF_SPI_DFU_REQ_PIN);
+
+    nrf_gpio_cfg_input(NRF_SPI_DFU_SCK_PIN, NRF_GPIO_PIN_NOPULL);
+    nrf_gpio_cfg_input(NRF_SPI_DFU_MOSI_PIN, NRF_GPIO_PIN_NOPULL);
+    nrf_gpio_cfg_input(NRF_SPI_DFU_MISO_PIN, NRF_GPIO_PIN_NOPULL);
+    nrf_gpio_cfg_input(NRF_SPI_DFU_CSN_PIN, NRF_GPIO_PIN_PULLUP);
+
+    nrf_spis_pins_set(SPIS_INSTANCE,
+        NRF_SPI_DFU_SCK_PIN,
+        NRF_SPI_DFU_MOSI_PIN,
+        NRF_SPI_DFU_MISO_PIN,
+        NRF_SPI_DFU_CSN_PIN);
+    nrf_spis_configure(SPIS_INSTANCE, NRF_SPIS_MODE_0, NRF_SPIS_BIT_ORDER_MSB_FIRST);
+    nrf_spis_def_set(SPIS_INSTANCE, DEF_CHARACTER);
+    nrf_spis_orc_set(SPIS_INSTANCE, ORC_CHARACTER);
+
+    // The CPU gets the semaphore back after every transaction to arm the other buffer.
+    nrf_spis_shorts_enable(SPIS_INSTANCE, NRF_SPIS_SHORT_END_ACQUIRE);
+
+    nrf_spis_event_clear(SPIS_INSTANCE, NRF_SPIS_EVENT_END);
+    nrf_spis_event_clear(SPIS_INSTANCE, NRF_SPIS_EVENT_ACQUIRED);
+    nrf_spis_int_enable(SPIS_INSTANCE, NRF_SPIS_INT_END_MASK | NRF_SPIS_INT_ACQUIRED_MASK);
+
+    NVIC_ClearPendingIRQ(SPIS_IRQ);
+    NVIC_SetPriority(SPIS_IRQ, APP_IRQ_PRIORITY_LOW);
+    NVIC_EnableIRQ(SPIS_IRQ);
+
+    nrf_spis_enable(SPIS_INSTANCE);
+    m_active = true;
+
+    // Arm the first buffer once the semaphore is granted.
+    nrf_spis_task_trigger(SPIS_INSTANCE, NRF_SPIS_TASK_ACQUIRE);
+
+    NRF_LOG_INFO("SPI DFU transport ready\r\n");
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t spi_dfu_transport_close(void) {
+    spis_stop();
+
+    return NRF_SUCCESS;
+}
+
+
+void spi_dfu_transport_idle(void) {
+    NRF_LOG_INFO("Another transport owns the DFU session, stopping SPIS\r\n");
+
+    spis_stop();
+}
@@ -0,0 +1,57 @@
+#ifndef NRF_SPI_DFU_H__
+#define NRF_SPI_DFU_H__
+
+#include <stdint.h>
+#include "app_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NRF_SPI_DFU_MTU
+#define NRF_SPI_DFU_MTU                 253                         /**< Length (in bytes) of the longest request, limited by the 8-bit SPIS transfer count. */
+#endif
+
+#ifndef NRF_SPI_DFU_TX_BUF_SIZE
+#define NRF_SPI_DFU_TX_BUF_SIZE         64                          /**< Size (in bytes) of the response buffer. */
+#endif
+
+#ifndef NRF_SPI_DFU_PINS_ACTIVE_LOW
+#define NRF_SPI_DFU_PINS_ACTIVE_LOW     1                           /**< Whether the RDY and REQ pins are asserted low, as in the serialization SPI transport. */
+#endif
+
+
+    /**@brief      Function for initializing the SPI slave DFU transport.
+     *
+     * @details    Every SPI transaction from the SPI master carries one request, prefixed with
+     *             its length (16-bit little endian). The requests use the opcodes of the BLE
+     *             control point, see nrf_dfu_serial.h.
+     *
+     *             The RDY pin is asserted while a receive buffer is armed. The master must wait
+     *             for it before starting a transaction. The REQ pin is asserted while responses
+     *             are waiting. They are clocked out during the next transaction as a sequence of
+     *             length-prefixed responses, terminated by a length of 0.
+     *
+     * @retval     NRF_SUCCESS If the SPIS was set up. Otherwise, an error code is returned.
+     */
+    uint32_t spi_dfu_transport_init(app_timer_id_t);
+
+
+    /**@brief      Function for closing down the SPI slave DFU transport.
+     *
+     * @retval     NRF_SUCCESS If the SPIS was stopped.
+     */
+    uint32_t spi_dfu_transport_close(void);
+
+
+    /**@brief      Function for idling the SPI slave DFU transport while another transport owns the DFU session.
+     */
+    void spi_dfu_transport_idle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_SPI_DFU_H__
+
+/** @} */
@@ -0,0 +1,416 @@
+#include "nrf_uart_dfu.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "nrf_dfu_serial.h"
+#include "nrf_dfu_transport.h"
+#include "nrf_uart.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+#include "boards.h"
+#include "nrf_delay.h"
+#include "nrf_log.h"
+
+// UART0_IRQHandler is defined below, the UART driver and the UART log backend define it as well.
+#if (defined(UART_ENABLED) && UART_ENABLED) || (defined(UART0_ENABLED) && UART0_ENABLED)
+#error "The UART DFU transport owns UART0, disable nrf_drv_uart (UART_ENABLED)."
+#endif
+#if defined(NRF_LOG_BACKEND_SERIAL_USES_UART) && NRF_LOG_BACKEND_SERIAL_USES_UART
+#error "The UART DFU transport owns UART0, disable the UART log backend (NRF_LOG_BACKEND_SERIAL_USES_UART)."
+#endif
+
+#define SLIP_BYTE_END           0xC0        /**< Indicates end of packet. */
+#define SLIP_BYTE_ESC           0xDB        /**< Indicates byte stuffing. */
+#define SLIP_BYTE_ESC_END       0xDC        /**< ESC ESC_END means END data byte. */
+#define SLIP_BYTE_ESC_ESC       0xDD        /**< ESC ESC_ESC means ESC data byte. */
+
+#define RX_BUF_MASK             (NRF_UART_DFU_RX_BUF_SIZE - 1)
+#define TX_BUF_MASK             (NRF_UART_DFU_TX_BUF_SIZE - 1)
+#define TX_RSP_MAX_LEN          (2 * NRF_DFU_SERIAL_RSP_MAX_LEN + 1)    /**< Length of the longest SLIP-encoded response, every byte escaped. */
+#define TX_DRAIN_TIMEOUT_US     10000                                   /**< Longest time the transport waits for the transmit ring buffer to drain on close. */
+
+#define RX_BREAK_LEN            2           /**< Length of the byte sequence marking lost bytes in the receive ring buffer. */
+
+STATIC_ASSERT(IS_POWER_OF_TWO(NRF_UART_DFU_RX_BUF_SIZE));
+STATIC_ASSERT(IS_POWER_OF_TWO(NRF_UART_DFU_TX_BUF_SIZE));
+STATIC_ASSERT(TX_RSP_MAX_LEN < NRF_UART_DFU_TX_BUF_SIZE);
+
+/**@brief States of the SLIP decoder. */
+typedef enum {
+    SLIP_STATE_DECODING,        /**< Receiving frame bytes. */
+    SLIP_STATE_ESC_RECEIVED,    /**< The last byte was an escape byte. */
+    SLIP_STATE_CLEARING         /**< The frame is broken, waiting for the next END byte. */
+} slip_state_t;
+
+static app_timer_id_t   application_start_timer = NULL;
+
+static nrf_dfu_serial_t m_serial;                                           /**< Request parser of this transport. */
+
+static uint8_t          m_rx_buf[NRF_UART_DFU_RX_BUF_SIZE];                 /**< Bytes received in the UART interrupt, not yet decoded. */
+static volatile uint16_t m_rx_head;                                         /**< Written by the UART interrupt. */
+static volatile uint16_t m_rx_tail;                                         /**< Written by the scheduler. */
+static volatile bool    m_rx_scheduled;                                     /**< Whether the receive ring buffer is queued for decoding. */
+static volatile bool    m_rx_stalled;                                       /**< Whether decoding waits for room in the transmit ring buffer. */
+static volatile bool    m_rx_break;                                         /**< Whether bytes were lost and the frame they belong to must be discarded. */
+static volatile uint32_t m_rx_overruns;                                     /**< Number of bytes lost in the UART interrupt. */
+static uint32_t         m_rx_dropped;                                       /**< Number of bytes dropped by the SLIP decoder. */
+
+static uint32_t         m_frame[CEIL_DIV(NRF_UART_DFU_MTU, sizeof(uint32_t))]; /**< Decoded frame, word-aligned for the request handler. */
+static uint16_t         m_frame_len;
+static slip_state_t     m_slip_state;
+
+static uint8_t          m_tx_buf[NRF_UART_DFU_TX_BUF_SIZE];                 /**< SLIP-encoded bytes waiting to be sent. */
+static volatile uint16_t m_tx_head;                                         /**< Written by the scheduler. */
+static volatile uint16_t m_tx_tail;                                         /**< Written by the UART interrupt. */
+static volatile bool    m_tx_busy;                                          /**< Whether a byte is being sent. */
+
+static bool             m_active;                                           /**< Whether the UART is enabled. */
+
+//lint -save -e545 -esym(526, uart_dfu_trans) -esym(528, uart_dfu_trans)
+DFU_TRANSPORT_REGISTER(nrf_dfu_transport_t const uart_dfu_trans) =
+{
+    .init_func = uart_dfu_transport_init,
+    .close_func = uart_dfu_transport_close,
+    .idle_func = uart_dfu_transport_idle
+};
+//lint -restore
+
+
+static void rx_handler(void *p_event_data, uint16_t event_size);
+
+
+/**@brief Function for queueing the receive ring buffer for decoding.
+ *
+ * @details Called from the UART interrupt. If the scheduler queue is full, the next received or
+ *          sent byte tries again.
+ */
+static void rx_schedule(void) {
+    if (m_rx_scheduled || m_rx_stalled || (m_rx_head == m_rx_tail)) {
+        return;
+    }
+
+    m_rx_scheduled = true;
+    if (app_sched_event_put(NULL, 0, rx_handler) != NRF_SUCCESS) {
+        m_rx_scheduled = false;
+    }
+}
+
+
+static uint32_t tx_free(void) {
+    return NRF_UART_DFU_TX_BUF_SIZE - 1 - ((m_tx_head - m_tx_tail) & TX_BUF_MASK);
+}
+
+
+/**@brief Function for sending the next byte of the transmit ring buffer.
+ *
+ * @details Called from the UART interrupt, or with the interrupt masked.
+ */
+static void tx_next(void) {
+    // Decoding waited for a response to fit.
+    if (m_rx_stalled && (tx_free() >= TX_RSP_MAX_LEN)) {
+        m_rx_stalled = false;
+        rx_schedule();
+    }
+
+    if (m_tx_tail == m_tx_head) {
+        m_tx_busy = false;
+        return;
+    }
+
+    m_tx_busy = true;
+    nrf_uart_txd_set(NRF_UART0, m_tx_buf[m_tx_tail]);
+    m_tx_tail = (m_tx_tail + 1) & TX_BUF_MASK;
+}
+
+
+static void tx_put(uint8_t byte) {
+    m_tx_buf[m_tx_head] = byte;
+    m_tx_head = (m_tx_head + 1) & TX_BUF_MASK;
+}
+
+
+/**@brief Function for SLIP-encoding a response and starting its transmission.
+ *
+ * @param[in] p_data    Response.
+ * @param[in] len       Length of the response.
+ */
+static void response_send(uint8_t const *p_data, uint32_t len) {
+    // Worst case every byte is escaped.
+    if (tx_free() < (2 * len + 1)) {
+        NRF_LOG_ERROR("UART TX buffer full, dropping response\r\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        switch (p_data[i]) {
+            case SLIP_BYTE_END:
+                tx_put(SLIP_BYTE_ESC);
+                tx_put(SLIP_BYTE_ESC_END);
+                break;
+
+            case SLIP_BYTE_ESC:
+                tx_put(SLIP_BYTE_ESC);
+                tx_put(SLIP_BYTE_ESC_ESC);
+                break;
+
+            default:
+                tx_put(p_data[i]);
+                break;
+        }
+    }
+    tx_put(SLIP_BYTE_END);
+
+    CRITICAL_REGION_ENTER();
+    if (!m_tx_busy) {
+        tx_next();
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for handling a decoded frame.
+ */
+static void on_frame(void) {
+    if (m_frame_len == 0) {
+        return;
+    }
+
+    // A DFU Controller is talking to us, hold off the application start.
+    if (application_start_timer != NULL) {
+        (void)app_timer_stop(application_start_timer);
+    }
+
+    nrf_dfu_serial_on_packet(&m_serial, (uint8_t const *)m_frame, m_frame_len);
+}
+
+
+/**@brief Function for feeding a received byte to the SLIP decoder.
+ *
+ * @param[in] byte  Received byte.
+ */
+static void slip_decode(uint8_t byte) {
+    uint8_t *p_frame = (uint8_t *)m_frame;
+
+    if (byte == SLIP_BYTE_END) {
+        if (m_slip_state != SLIP_STATE_CLEARING) {
+            on_frame();
+        }
+        m_frame_len = 0;
+        m_slip_state = SLIP_STATE_DECODING;
+        return;
+    }
+
+    switch (m_slip_state) {
+        case SLIP_STATE_CLEARING:
+            m_rx_dropped++;
+            return;
+
+        case SLIP_STATE_ESC_RECEIVED:
+            if (byte == SLIP_BYTE_ESC_END) {
+                byte = SLIP_BYTE_END;
+            }
+            else if (byte == SLIP_BYTE_ESC_ESC) {
+                byte = SLIP_BYTE_ESC;
+            }
+            else {
+                m_rx_dropped += m_frame_len + 1;
+                m_slip_state = SLIP_STATE_CLEARING;
+                return;
+            }
+            m_slip_state = SLIP_STATE_DECODING;
+            break;
+
+        default:
+            if (byte == SLIP_BYTE_ESC) {
+                m_slip_state = SLIP_STATE_ESC_RECEIVED;
+                return;
+            }
+            break;
+    }
+
+    if (m_frame_len >= NRF_UART_DFU_MTU) {
+        m_rx_dropped += m_frame_len + 1;
+        m_slip_state = SLIP_STATE_CLEARING;
+        return;
+    }
+
+    p_frame[m_frame_len++] = byte;
+}
+
+
+/**@brief Scheduler event handler decoding the receive ring buffer.
+ */
+static void rx_handler(void *p_event_data, uint16_t event_size) {
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    // Bytes received from here on schedule another run.
+    m_rx_scheduled = false;
+
+    while (m_rx_tail != m_rx_head) {
+        uint8_t byte = m_rx_buf[m_rx_tail];
+
+        // A frame can be answered, wait until the response fits. The transmit interrupt
+        // schedules decoding again.
+        if ((byte == SLIP_BYTE_END) && (tx_free() < TX_RSP_MAX_LEN)) {
+            CRITICAL_REGION_ENTER();
+            m_rx_stalled = m_tx_busy;
+            CRITICAL_REGION_EXIT();
+
+            if (m_rx_stalled) {
+                return;
+            }
+        }
+
+        m_rx_tail = (m_rx_tail + 1) & RX_BUF_MASK;
+
+        slip_decode(byte);
+    }
+}
+
+
+/**@brief Function for adding a received byte to the receive ring buffer.
+ *
+ * @details Called from the UART interrupt. Lost bytes are marked with an escape byte followed
+ *          by an invalid byte, which makes the SLIP decoder discard the frame they belong to.
+ *
+ * @param[in] byte  Received byte.
+ */
+static void rx_put(uint8_t byte) {
+    uint16_t room = (m_rx_tail - m_rx_head - 1) & RX_BUF_MASK;
+
+    if (m_rx_break) {
+        if (room < (RX_BREAK_LEN + 1)) {
+            m_rx_overruns++;
+            return;
+        }
+
+        m_rx_buf[m_rx_head] = SLIP_BYTE_ESC;
+        m_rx_head = (m_rx_head + 1) & RX_BUF_MASK;
+        m_rx_buf[m_rx_head] = 0x00;
+        m_rx_head = (m_rx_head + 1) & RX_BUF_MASK;
+        m_rx_break = false;
+    }
+    else if (room == 0) {
+        m_rx_overruns++;
+        m_rx_break = true;
+        return;
+    }
+
+    m_rx_buf[m_rx_head] = byte;
+    m_rx_head = (m_rx_head + 1) & RX_BUF_MASK;
+}
+
+
+void UART0_IRQHandler(void) {
+    if (nrf_uart_event_check(NRF_UART0, NRF_UART_EVENT_ERROR)) {
+        nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_ERROR);
+        (void)nrf_uart_errorsrc_get_and_clear(NRF_UART0);
+
+        // The byte in error is lost, the frame it belongs to is discarded.
+        m_rx_overruns++;
+        m_rx_break = true;
+    }
+
+    while (nrf_uart_event_check(NRF_UART0, NRF_UART_EVENT_RXDRDY)) {
+        nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_RXDRDY);
+        rx_put(nrf_uart_rxd_get(NRF_UART0));
+    }
+
+    rx_schedule();
+
+    if (nrf_uart_event_check(NRF_UART0, NRF_UART_EVENT_TXDRDY)) {
+        nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_TXDRDY);
+        tx_next();
+    }
+}
+
+
+/**@brief Function for stopping the UART and releasing its pins.
+ */
+static void uart_stop(void) {
+    if (!m_active) {
+        return;
+    }
+
+    m_active = false;
+
+    NVIC_DisableIRQ(UART0_IRQn);
+    nrf_uart_int_disable(NRF_UART0, NRF_UART_INT_MASK_RXDRDY | NRF_UART_INT_MASK_TXDRDY | NRF_UART_INT_MASK_ERROR);
+    nrf_uart_task_trigger(NRF_UART0, NRF_UART_TASK_STOPRX);
+    nrf_uart_task_trigger(NRF_UART0, NRF_UART_TASK_STOPTX);
+    nrf_uart_disable(NRF_UART0);
+}
+
+
+uint32_t uart_dfu_transport_init(app_timer_id_t application_start_timer_) {
+    application_start_timer = application_start_timer_;
+
+    nrf_dfu_serial_init(&m_serial, &uart_dfu_trans, response_send, NRF_UART_DFU_MTU);
+
+    m_rx_head = 0;
+    m_rx_tail = 0;
+    m_rx_scheduled = false;
+    m_rx_stalled = false;
+    m_rx_break = false;
+    m_rx_overruns = 0;
+    m_rx_dropped = 0;
+    m_frame_len = 0;
+    m_slip_state = SLIP_STATE_DECODING;
+    m_tx_head = 0;
+    m_tx_tail = 0;
+    m_tx_busy = false;
+
+    nrf_uart_baudrate_set(NRF_UART0, NRF_UART_DFU_BAUDRATE);
+    nrf_uart_txrx_pins_set(NRF_UART0, TX_PIN_NUMBER, RX_PIN_NUMBER);
+#if HWFC
+    nrf_uart_hwfc_pins_set(NRF_UART0, RTS_PIN_NUMBER, CTS_PIN_NUMBER);
+    nrf_uart_configure(NRF_UART0, NRF_UART_PARITY_EXCLUDED, NRF_UART_HWFC_ENABLED);
+#else
+    nrf_uart_configure(NRF_UART0, NRF_UART_PARITY_EXCLUDED, NRF_UART_HWFC_DISABLED);
+#endif
+
+    nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_RXDRDY);
+    nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_TXDRDY);
+    nrf_uart_event_clear(NRF_UART0, NRF_UART_EVENT_ERROR);
+    nrf_uart_int_enable(NRF_UART0, NRF_UART_INT_MASK_RXDRDY | NRF_UART_INT_MASK_TXDRDY | NRF_UART_INT_MASK_ERROR);
+
+    NVIC_ClearPendingIRQ(UART0_IRQn);
+    NVIC_SetPriority(UART0_IRQn, APP_IRQ_PRIORITY_LOW);
+    NVIC_EnableIRQ(UART0_IRQn);
+
+    nrf_uart_enable(NRF_UART0);
+    nrf_uart_task_trigger(NRF_UART0, NRF_UART_TASK_STARTRX);
+    nrf_uart_task_trigger(NRF_UART0, NRF_UART_TASK_STARTTX);
+
+    m_active = true;
+
+    NRF_LOG_INFO("UART DFU transport ready\r\n");
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t uart_dfu_transport_close(void) {
+    // Let the last responses go out, at 1 Mbaud a full transmit ring buffer takes about a
+    // millisecond. A stuck UART, for instance CTS never asserted, must not hang the reset.
+    for (uint32_t i = 0; m_active && m_tx_busy && (i < TX_DRAIN_TIMEOUT_US); i++) {
+        nrf_delay_us(1);
+    }
+
+    uart_stop();
+
+    return NRF_SUCCESS;
+}
+
+
+void uart_dfu_transport_idle(void) {
+    NRF_LOG_INFO("Another transport owns the DFU session, stopping UART\r\n");
+
+    uart_stop();
+}
+
+
+uint32_t uart_dfu_rx_dropped_get(void) {
+    return m_rx_overruns + m_rx_dropped;
+}
@@ -0,0 +1,67 @@
+#ifndef NRF_UART_DFU_H__
+#define NRF_UART_DFU_H__
+
+#include <stdint.h>
+#include "app_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NRF_UART_DFU_BAUDRATE
+#define NRF_UART_DFU_BAUDRATE           NRF_UART_BAUDRATE_1000000   /**< Baud rate of the DFU UART. */
+#endif
+
+#ifndef NRF_UART_DFU_RX_BUF_SIZE
+#define NRF_UART_DFU_RX_BUF_SIZE        512                         /**< Size (in bytes) of the receive ring buffer, must be a power of two. */
+#endif
+
+#ifndef NRF_UART_DFU_TX_BUF_SIZE
+#define NRF_UART_DFU_TX_BUF_SIZE        128                         /**< Size (in bytes) of the transmit ring buffer, must be a power of two. */
+#endif
+
+#ifndef NRF_UART_DFU_MTU
+#define NRF_UART_DFU_MTU                257                         /**< Length (in bytes) of the longest decoded SLIP frame: opcode and 256 bytes of object data. */
+#endif
+
+
+    /**@brief      Function for initializing the UART DFU transport.
+     *
+     * @details    Receives SLIP-framed requests on RX_PIN_NUMBER and sends SLIP-framed responses on
+     *             TX_PIN_NUMBER. Uses the opcodes of the BLE control point, see nrf_dfu_serial.h.
+     *             The transport drives UART0 directly and defines UART0_IRQHandler, so it cannot be
+     *             linked together with nrf_drv_uart or the UART backend of NRF_LOG.
+     *
+     * @retval     NRF_SUCCESS If the UART was set up. Otherwise, an error code is returned.
+     */
+    uint32_t uart_dfu_transport_init(app_timer_id_t);
+
+
+    /**@brief      Function for closing down the UART DFU transport.
+     *
+     * @retval     NRF_SUCCESS If the UART was stopped.
+     */
+    uint32_t uart_dfu_transport_close(void);
+
+
+    /**@brief      Function for idling the UART DFU transport while another transport owns the DFU session.
+     */
+    void uart_dfu_transport_idle(void);
+
+
+    /**@brief      Function for getting the number of bytes dropped by the UART DFU transport.
+     *
+     * @details    Counts bytes lost to receive buffer overruns, UART errors and frames longer than
+     *             @ref NRF_UART_DFU_MTU.
+     *
+     * @return     Number of dropped bytes since initialization.
+     */
+    uint32_t uart_dfu_rx_dropped_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_UART_DFU_H__
+
+/** @} */
@@ -0,0 +1,399 @@
+#include "dfu_controller.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "nrf_ble_dfu.h"
+#include "nrf_dfu_req_handler.h"
+#include "nrf_dfu_crc32.h"
+#include "fake_softdevice.h"
+#include "test_util.h"
+
+#define TIMEOUT_US                  (600ULL * 1000000)      /**< Simulated time an update may take. */
+#define ATT_WRITE_HEADER_LEN        3
+
+static dfu_controller_config_t  m_config;
+static dfu_controller_result_t  m_result;
+static uint64_t                 m_deadline_us;
+
+static uint16_t                 m_ctrl_pt_handle;
+static uint16_t                 m_pkt_handle;
+
+static uint16_t                 m_prn;                      /**< Packet Receipt Notification target in use. */
+static uint16_t                 m_pkts_since_prn;
+static uint32_t                 m_prns_expected;            /**< Packet Receipt Notifications that are still to come. */
+static uint8_t const           *mp_stream;                  /**< Data the Packet Receipt Notifications are checked against. */
+static uint32_t                 m_stream_offset;            /**< Offset of the data sent so far. */
+static uint32_t                 m_prn_offset;               /**< Offset of the last Packet Receipt Notification. */
+static bool                     m_dropped;                  /**< The link was dropped once already. */
+
+static uint8_t                  m_rsp[FAKE_SD_MAX_ATT_MTU];
+static uint16_t                 m_rsp_len;
+static bool                     m_rsp_valid;
+
+
+static uint32_t crc32(uint8_t const *p_data, uint32_t len) {
+    return nrf_dfu_crc32_update(0, p_data, len);
+}
+
+
+/**@brief Function for sorting the notifications into responses and Packet Receipt Notifications. */
+static void notifs_process(void) {
+    uint8_t  data[FAKE_SD_MAX_ATT_MTU];
+    uint16_t handle;
+    uint16_t len;
+    uint32_t offset;
+
+    while (fake_sd_notif_get(&handle, data, &len)) {
+        TEST_CHECK_EQUAL(m_ctrl_pt_handle, handle);
+        TEST_CHECK(len >= 3);
+        TEST_CHECK_EQUAL(BLE_DFU_OP_CODE_RESPONSE, data[0]);
+
+        // No Calculate Checksum request is sent while Packet Receipt Notifications are due.
+        if ((m_prns_expected > 0) && (data[1] == BLE_DFU_OP_CODE_CALCULATE_CRC)) {
+            TEST_CHECK_EQUAL(11, len);
+            TEST_CHECK_EQUAL(NRF_DFU_RES_CODE_SUCCESS, data[2]);
+
+            // Waiting for each one, it covers all data sent. Otherwise it may lag behind.
+            offset = uint32_decode(&data[3]);
+            if (m_config.prns_ahead == 0) {
+                TEST_CHECK_EQUAL(m_stream_offset, offset);
+            }
+            TEST_CHECK((offset >= m_prn_offset) && (offset <= m_stream_offset));
+            TEST_CHECK_EQUAL(crc32(mp_stream, offset), uint32_decode(&data[7]));
+            m_prn_offset = offset;
+
+            m_prns_expected--;
+            m_result.prns++;
+            continue;
+        }
+
+        TEST_CHECK(!m_rsp_valid);
+        memcpy(m_rsp, data, len);
+        m_rsp_len = len;
+        m_rsp_valid = true;
+    }
+}
+
+
+static void step(void) {
+    TEST_CHECK(fake_sd_time_us() < m_deadline_us);
+
+    fake_sd_step();
+    notifs_process();
+}
+
+
+static bool is_prns_done(void) {
+    return (m_prns_expected == 0) || !fake_sd_is_connected();
+}
+
+
+static bool is_prn_window_open(void) {
+    return (m_prns_expected <= m_config.prns_ahead) || !fake_sd_is_connected();
+}
+
+
+static bool is_rsp_ready(void) {
+    return m_rsp_valid;
+}
+
+
+static bool is_disconnected(void) {
+    return !fake_sd_is_connected();
+}
+
+
+static void run_until(bool (*p_cond)(void)) {
+    notifs_process();
+    while (!p_cond()) {
+        step();
+    }
+}
+
+
+/**@brief Function for writing to a characteristic, waits while the write queue is full. */
+static void att_write(uint16_t handle, uint8_t op, uint8_t const *p_data, uint16_t len) {
+    while (!fake_sd_write(handle, op, p_data, len)) {
+        step();
+    }
+}
+
+
+/**@brief Function for sending a Control Point request and waiting for its response.
+ *
+ * @return  Result of the request.
+ */
+static uint8_t request(uint8_t const *p_req, uint16_t len) {
+    // A Calculate Checksum response could not be told apart from a Packet Receipt Notification.
+    if ((m_config.prns_ahead == 0) || (p_req[0] == BLE_DFU_OP_CODE_CALCULATE_CRC)) {
+        run_until(is_prns_done);
+        TEST_CHECK_EQUAL(0, m_prns_expected);
+    }
+
+    m_rsp_valid = false;
+    att_write(m_ctrl_pt_handle, BLE_GATTS_OP_WRITE_REQ, p_req, len);
+    run_until(is_rsp_ready);
+    m_rsp_valid = false;
+
+    TEST_CHECK_EQUAL(p_req[0], m_rsp[1]);
+    return m_rsp[2];
+}
+
+
+static void request_success(uint8_t const *p_req, uint16_t len) {
+    TEST_CHECK_EQUAL(NRF_DFU_RES_CODE_SUCCESS, request(p_req, len));
+}
+
+
+static void object_create(uint8_t obj_type, uint32_t size) {
+    uint8_t req[6] = { BLE_DFU_OP_CODE_CREATE_OBJECT, obj_type };
+
+    (void)uint32_encode(size, &req[2]);
+    request_success(req, sizeof(req));
+    m_pkts_since_prn = 0;
+}
+
+
+static void object_select(uint8_t obj_type, uint32_t *p_max_size, uint32_t *p_offset, uint32_t *p_crc) {
+    uint8_t const req[] = { BLE_DFU_OP_CODE_SELECT_OBJECT, obj_type };
+
+    request_success(req, sizeof(req));
+    TEST_CHECK_EQUAL(15, m_rsp_len);
+    *p_max_size = uint32_decode(&m_rsp[3]);
+    *p_offset = uint32_decode(&m_rsp[7]);
+    *p_crc = uint32_decode(&m_rsp[11]);
+}
+
+
+/**@brief Function for checking the offset and CRC of the current object against the data sent. */
+static void object_crc_check(void) {
+    uint8_t const req[] = { BLE_DFU_OP_CODE_CALCULATE_CRC };
+
+    request_success(req, sizeof(req));
+    TEST_CHECK_EQUAL(11, m_rsp_len);
+    TEST_CHECK_EQUAL(m_stream_offset, uint32_decode(&m_rsp[3]));
+    TEST_CHECK_EQUAL(crc32(mp_stream, m_stream_offset), uint32_decode(&m_rsp[7]));
+}
+
+
+static uint8_t object_execute(void) {
+    uint8_t const req[] = { BLE_DFU_OP_CODE_EXECUTE_OBJECT };
+
+    return request(req, sizeof(req));
+}
+
+
+/**@brief Function for streaming object data in packets of the ATT MTU.
+ *
+ * @retval true     If all data was sent.
+ * @retval false    If the link was dropped as configured.
+ */
+static bool object_stream(uint32_t len) {
+    uint32_t end = m_stream_offset + len;
+
+    while (m_stream_offset < end) {
+        uint16_t pkt_len = (uint16_t)MIN(end - m_stream_offset, (uint32_t)(fake_sd_att_mtu_get() - ATT_WRITE_HEADER_LEN));
+
+        // Wait for the Packet Receipt Notification of the last window before the next one.
+        run_until(is_prn_window_open);
+        if (!fake_sd_is_connected()) {
+            return false;
+        }
+
+        if ((m_config.disconnect_at != 0) && !m_dropped && (m_stream_offset >= m_config.disconnect_at)) {
+            m_dropped = true;
+            fake_sd_disconnect();
+            return false;
+        }
+
+        att_write(m_pkt_handle, BLE_GATTS_OP_WRITE_CMD, &mp_stream[m_stream_offset], pkt_len);
+        m_stream_offset += pkt_len;
+        m_result.pkts++;
+
+        if ((m_prn != 0) && (++m_pkts_since_prn == m_prn)) {
+            m_pkts_since_prn = 0;
+            m_prns_expected++;
+        }
+    }
+
+    return true;
+}
+
+
+static void connect(void) {
+    uint32_t conn_events;
+    fake_sd_stats_t stats;
+
+    while (!fake_sd_is_advertising()) {
+        step();
+    }
+    TEST_CHECK(fake_sd_connect());
+
+    m_ctrl_pt_handle = fake_sd_handle_get(BLE_DFU_CTRL_PT_UUID);
+    m_pkt_handle = fake_sd_handle_get(BLE_DFU_PKT_CHAR_UUID);
+    TEST_CHECK(m_ctrl_pt_handle != BLE_GATT_HANDLE_INVALID);
+    TEST_CHECK(m_pkt_handle != BLE_GATT_HANDLE_INVALID);
+
+    fake_sd_cccd_set(m_ctrl_pt_handle, true);
+    m_prns_expected = 0;
+    m_pkts_since_prn = 0;
+    m_rsp_valid = false;
+
+    // Service discovery takes a few connection events, the MTU exchange is done by then.
+    fake_sd_stats_get(&stats);
+    conn_events = stats.conn_events;
+    while (stats.conn_events < (conn_events + 2)) {
+        step();
+        fake_sd_stats_get(&stats);
+    }
+}
+
+
+static void prn_set(void) {
+    uint8_t req[3] = { BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF };
+
+    (void)uint16_encode(m_config.prn, &req[1]);
+    m_prn = m_config.prn;
+
+    if (!m_config.extended) {
+        request_success(req, sizeof(req));
+        return;
+    }
+
+    // The target is clamped to what the flash can absorb.
+    req[0] = BLE_DFU_OP_CODE_SET_RECEIPT_NOTIF_EXT;
+    request_success(req, sizeof(req));
+    TEST_CHECK_EQUAL(7, m_rsp_len);
+    m_prn = uint16_decode(&m_rsp[3]);
+    TEST_CHECK(m_prn <= uint16_decode(&m_rsp[5]));
+    TEST_CHECK((m_config.prn == 0) || (m_prn <= m_config.prn));
+}
+
+
+/**@brief Function for sending the init command, or executing it again if it was received before. */
+static void command_send(uint8_t const *p_init, uint16_t init_len) {
+    uint32_t max_size;
+    uint32_t offset;
+    uint32_t crc;
+
+    run_until(is_prns_done);
+    mp_stream = p_init;
+    m_prn_offset = 0;
+    object_select(NRF_DFU_OBJ_TYPE_COMMAND, &max_size, &offset, &crc);
+    TEST_CHECK(init_len <= max_size);
+
+    if ((offset != init_len) || (crc != crc32(p_init, init_len))) {
+        object_create(NRF_DFU_OBJ_TYPE_COMMAND, init_len);
+        m_stream_offset = 0;
+        TEST_CHECK(object_stream(init_len));
+        object_crc_check();
+    }
+
+    TEST_CHECK_EQUAL(NRF_DFU_RES_CODE_SUCCESS, object_execute());
+}
+
+
+/**@brief Function for sending the data objects from where the DFU Target is.
+ *
+ * @retval true     If the update is complete.
+ * @retval false    If the link was dropped.
+ */
+static bool data_send(uint8_t const *p_fw, uint32_t fw_len) {
+    uint32_t max_size;
+    uint32_t offset;
+    uint32_t crc;
+    uint32_t size;
+
+    run_until(is_prns_done);
+    mp_stream = p_fw;
+    m_prn_offset = 0;
+    object_select(NRF_DFU_OBJ_TYPE_DATA, &max_size, &offset, &crc);
+    TEST_CHECK(offset <= fw_len);
+    TEST_CHECK_EQUAL(crc32(p_fw, offset), crc);
+
+    // A complete object may not have been executed yet, an executed one is refused.
+    if ((offset != 0) && ((offset % max_size) == 0)) {
+        uint8_t res_code = object_execute();
+
+        TEST_CHECK((res_code == NRF_DFU_RES_CODE_SUCCESS) || (res_code == NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED));
+    }
+
+    // A partial object is created again.
+    m_stream_offset = offset - (offset % max_size);
+    if (m_stream_offset == fw_len) {
+        return true;
+    }
+
+    size = MIN(max_size, fw_len - m_stream_offset);
+    object_create(NRF_DFU_OBJ_TYPE_DATA, size);
+
+    for (;;) {
+        uint32_t next_size;
+
+        if (!object_stream(size)) {
+            return false;
+        }
+
+        next_size = MIN(max_size, fw_len - m_stream_offset);
+
+        if (!m_config.extended) {
+            object_crc_check();
+            TEST_CHECK_EQUAL(NRF_DFU_RES_CODE_SUCCESS, object_execute());
+            if (next_size == 0) {
+                return true;
+            }
+            object_create(NRF_DFU_OBJ_TYPE_DATA, next_size);
+        }
+        else {
+            uint8_t req[10] = { BLE_DFU_OP_CODE_EXECUTE_CREATE_OBJECT };
+
+            (void)uint32_encode(crc32(p_fw, m_stream_offset), &req[1]);
+            req[5] = NRF_DFU_OBJ_TYPE_DATA;
+            (void)uint32_encode(next_size, &req[6]);
+            request_success(req, sizeof(req));
+            TEST_CHECK_EQUAL(11, m_rsp_len);
+            TEST_CHECK_EQUAL(m_stream_offset, uint32_decode(&m_rsp[3]));
+            m_pkts_since_prn = 0;
+            if (next_size == 0) {
+                return true;
+            }
+        }
+
+        size = next_size;
+    }
+}
+
+
+void dfu_controller_update(dfu_controller_config_t const *p_config,
+                           uint8_t const                 *p_init,
+                           uint16_t                       init_len,
+                           uint8_t const                 *p_fw,
+                           uint32_t                       fw_len,
+                           dfu_controller_result_t       *p_result) {
+    uint64_t start_us;
+
+    m_config = *p_config;
+    memset(&m_result, 0, sizeof(m_result));
+    m_dropped = false;
+    m_deadline_us = fake_sd_time_us() + TIMEOUT_US;
+
+    connect();
+    start_us = fake_sd_time_us();
+
+    for (;;) {
+        prn_set();
+        command_send(p_init, init_len);
+        if (data_send(p_fw, fw_len)) {
+            run_until(is_prns_done);
+            TEST_CHECK_EQUAL(0, m_prns_expected);
+            break;
+        }
+
+        run_until(is_disconnected);
+        connect();
+        m_result.reconnects++;
+    }
+
+    m_result.duration_us = fake_sd_time_us() - start_us;
+    *p_result = m_result;
+}
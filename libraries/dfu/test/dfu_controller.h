@@ -0,0 +1,51 @@
+#ifndef DFU_CONTROLLER_H__
+#define DFU_CONTROLLER_H__
+
+/**@brief Scripted DFU Controller on top of the fake SoftDevice.
+ *
+ * @details Runs a complete update the way nRF Connect does: it selects, creates, streams,
+ *          checks and executes the init command and then each data object, and resumes from
+ *          what Select Object reports after a reconnect. It checks the offset and CRC of every
+ *          Packet Receipt Notification and fails the test on any unexpected response. By default
+ *          it waits for each Packet Receipt Notification before sending the next window, it can
+ *          also keep streaming like DFU Controllers that only use them for pacing.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Behaviour of the DFU Controller. */
+typedef struct
+{
+    uint16_t prn;                   /**< Packet Receipt Notification target, 0 to disable them. */
+    bool     extended;              /**< Use the extended Set PRN and Execute and Create Object opcodes. */
+    uint32_t disconnect_at;         /**< Firmware offset past which the link drops once and the update resumes, 0 to never. */
+    uint8_t  prns_ahead;            /**< Packet Receipt Notifications that may be outstanding while streaming and sending requests other than Calculate Checksum, 0 to wait for each. */
+} dfu_controller_config_t;
+
+/**@brief Outcome of an update. */
+typedef struct
+{
+    uint64_t duration_us;           /**< Simulated time from the first connection to the last response. */
+    uint32_t pkts;                  /**< Number of packets written to the DFU Packet characteristic. */
+    uint32_t prns;                  /**< Number of Packet Receipt Notifications received. */
+    uint32_t reconnects;            /**< Number of times the DFU Controller reconnected. */
+} dfu_controller_result_t;
+
+/**@brief Function for running an update, fails the test if it does not complete.
+ *
+ * @param[in]  p_config     Behaviour of the DFU Controller.
+ * @param[in]  p_init       Init command.
+ * @param[in]  init_len     Length of the init command.
+ * @param[in]  p_fw         Firmware image.
+ * @param[in]  fw_len       Length of the firmware image.
+ * @param[out] p_result     Outcome of the update.
+ */
+void dfu_controller_update(dfu_controller_config_t const *p_config,
+                           uint8_t const                 *p_init,
+                           uint16_t                       init_len,
+                           uint8_t const                 *p_fw,
+                           uint32_t                       fw_len,
+                           dfu_controller_result_t       *p_result);
+
+#endif // DFU_CONTROLLER_H__
@@ -0,0 +1,259 @@
+#include "fake_req_handler.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "nrf_dfu_req_handler.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_dfu_settings_ext.h"
+#include "nrf_dfu_crc32.h"
+#include "fake_softdevice.h"
+#include "test_util.h"
+
+#define FLASH_OP_MAX                64                      /**< Number of flash operations whose offset is remembered, at least the fake SoftDevice queue. */
+#define SETTINGS_WRITE_WORDS        (CODE_PAGE_SIZE / 4)    /**< Words programmed when the settings page is written. */
+
+uint8_t            g_test_app[FAKE_REQ_IMAGE_MAX_SIZE];    /**< Installed application, see stubs/nrf_dfu_types.h. */
+nrf_dfu_settings_t s_dfu_settings;
+
+static uint8_t  m_cmd[FAKE_REQ_COMMAND_MAX_SIZE];
+static uint32_t m_cmd_len;
+static uint32_t m_cmd_size;                                 /**< Size of the command object that was created. */
+static bool     m_cmd_executed;
+
+static uint8_t  m_image[FAKE_REQ_IMAGE_MAX_SIZE];
+static uint32_t m_image_size;                               /**< Size of the image from the executed init command. */
+static uint32_t m_offset;                                   /**< Offset of the data received so far. */
+static uint32_t m_crc;                                      /**< CRC32 of the data received so far. */
+static uint32_t m_obj_end;                                  /**< Offset at which the current data object ends. */
+static uint32_t m_executed_offset;                          /**< Offset at which the last executed data object ends. */
+static uint32_t m_executed_crc;
+
+static nrf_dfu_obj_type_t m_cur_type;                       /**< Type of the object last created or selected. */
+
+static uint32_t m_op_offsets[FLASH_OP_MAX];                 /**< Data offset programmed once each flash operation is done. */
+static uint32_t m_op_count;
+static uint32_t m_checkpoints;
+
+
+/**@brief Function for getting the offset up to which the data is programmed. */
+static uint32_t flashed_len_get(void) {
+    uint32_t done = fake_sd_flash_ops_done_get();
+
+    TEST_CHECK((m_op_count - done) < FLASH_OP_MAX);
+    return (done == 0) ? 0 : m_op_offsets[(done - 1) % FLASH_OP_MAX];
+}
+
+
+static void flash_op_add(uint32_t pages, uint32_t words, uint32_t offset) {
+    m_op_offsets[m_op_count % FLASH_OP_MAX] = offset;
+    m_op_count++;
+    fake_sd_flash_op_add(pages, words);
+}
+
+
+/**@brief Function for writing the settings page, which executing an object does. */
+static void settings_write(void) {
+    flash_op_add(1, SETTINGS_WRITE_WORDS, (m_op_count == 0) ? 0 : m_op_offsets[(m_op_count - 1) % FLASH_OP_MAX]);
+}
+
+
+static nrf_dfu_res_code_t on_create(nrf_dfu_req_t const *p_req) {
+    if (p_req->obj_type == NRF_DFU_OBJ_TYPE_COMMAND) {
+        if (p_req->object_size > FAKE_REQ_COMMAND_MAX_SIZE) {
+            return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+        }
+
+        m_cur_type = NRF_DFU_OBJ_TYPE_COMMAND;
+        m_cmd_size = p_req->object_size;
+        m_cmd_len = 0;
+        m_cmd_executed = false;
+        return NRF_DFU_RES_CODE_SUCCESS;
+    }
+
+    if (p_req->obj_type != NRF_DFU_OBJ_TYPE_DATA) {
+        return NRF_DFU_RES_CODE_UNSUPPORTED_TYPE;
+    }
+
+    if (!m_cmd_executed) {
+        return NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+    }
+
+    if ((p_req->object_size == 0) || (p_req->object_size > FAKE_REQ_DATA_MAX_SIZE) ||
+        ((m_executed_offset + p_req->object_size) > m_image_size)) {
+        return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+    }
+
+    // Creating an object again drops what was received of it.
+    m_cur_type = NRF_DFU_OBJ_TYPE_DATA;
+    m_offset = m_executed_offset;
+    m_crc = m_executed_crc;
+    m_obj_end = m_executed_offset + p_req->object_size;
+
+    // The installed application is overwritten.
+    s_dfu_settings.bank_0.bank_code = NRF_DFU_BANK_INVALID;
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+static nrf_dfu_res_code_t on_write(nrf_dfu_req_t const *p_req, nrf_dfu_res_t *p_res) {
+    uint32_t pages;
+    uint32_t words;
+
+    if (m_cur_type == NRF_DFU_OBJ_TYPE_COMMAND) {
+        if ((m_cmd_len + p_req->req_len) > m_cmd_size) {
+            return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+        }
+
+        memcpy(&m_cmd[m_cmd_len], p_req->p_req, p_req->req_len);
+        m_cmd_len += p_req->req_len;
+        p_res->offset = m_cmd_len;
+        p_res->crc = nrf_dfu_crc32_update(0, m_cmd, m_cmd_len);
+        return NRF_DFU_RES_CODE_SUCCESS;
+    }
+
+    if ((m_cur_type != NRF_DFU_OBJ_TYPE_DATA) || ((m_offset + p_req->req_len) > m_obj_end)) {
+        return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+    }
+
+    // Pages the write starts are erased first. CEIL_DIV() is not defined for 0.
+    pages = ((m_offset + p_req->req_len + CODE_PAGE_SIZE - 1) / CODE_PAGE_SIZE) -
+            ((m_offset + CODE_PAGE_SIZE - 1) / CODE_PAGE_SIZE);
+    words = CEIL_DIV(p_req->req_len, 4);
+
+    memcpy(&m_image[m_offset], p_req->p_req, p_req->req_len);
+    m_crc = nrf_dfu_crc32_update(m_crc, p_req->p_req, p_req->req_len);
+    m_offset += p_req->req_len;
+    flash_op_add(pages, words, m_offset);
+
+    p_res->offset = m_offset;
+    p_res->crc = m_crc;
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+static nrf_dfu_res_code_t on_execute(void) {
+    uint32_t cmd_crc;
+
+    if (m_cur_type == NRF_DFU_OBJ_TYPE_COMMAND) {
+        if ((m_cmd_size < sizeof(uint32_t)) || (m_cmd_len != m_cmd_size)) {
+            return NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+        }
+
+        if (uint32_decode(m_cmd) > FAKE_REQ_IMAGE_MAX_SIZE) {
+            return NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+        }
+
+        // The same init command again continues the update, like after a reset.
+        cmd_crc = nrf_dfu_crc32_update(0, m_cmd, m_cmd_len);
+        if (cmd_crc != s_dfu_settings.progress.command_crc) {
+            s_dfu_settings.progress.command_crc = cmd_crc;
+            m_image_size = uint32_decode(m_cmd);
+            m_offset = 0;
+            m_crc = 0;
+            m_obj_end = 0;
+            m_executed_offset = 0;
+            m_executed_crc = 0;
+        }
+
+        m_cmd_executed = true;
+        settings_write();
+        return NRF_DFU_RES_CODE_SUCCESS;
+    }
+
+    if ((m_cur_type != NRF_DFU_OBJ_TYPE_DATA) || (m_offset != m_obj_end) || (m_obj_end == m_executed_offset)) {
+        return NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+    }
+
+    m_executed_offset = m_offset;
+    m_executed_crc = m_crc;
+    settings_write();
+    return NRF_DFU_RES_CODE_SUCCESS;
+}
+
+
+nrf_dfu_res_code_t nrf_dfu_req_handler_on_req(void *p_context, nrf_dfu_req_t *p_req, nrf_dfu_res_t *p_res) {
+    UNUSED_PARAMETER(p_context);
+
+    switch (p_req->req_type) {
+        case NRF_DFU_OBJECT_OP_CREATE:
+            return on_create(p_req);
+
+        case NRF_DFU_OBJECT_OP_WRITE:
+            return on_write(p_req, p_res);
+
+        case NRF_DFU_OBJECT_OP_EXECUTE:
+            return on_execute();
+
+        case NRF_DFU_OBJECT_OP_SELECT:
+            m_cur_type = (nrf_dfu_obj_type_t)p_req->obj_type;
+            // Fall through.
+
+        case NRF_DFU_OBJECT_OP_CRC:
+            if (m_cur_type == NRF_DFU_OBJ_TYPE_COMMAND) {
+                p_res->max_size = FAKE_REQ_COMMAND_MAX_SIZE;
+                p_res->offset = m_cmd_len;
+                p_res->crc = nrf_dfu_crc32_update(0, m_cmd, m_cmd_len);
+                return NRF_DFU_RES_CODE_SUCCESS;
+            }
+            if (m_cur_type == NRF_DFU_OBJ_TYPE_DATA) {
+                p_res->max_size = FAKE_REQ_DATA_MAX_SIZE;
+                p_res->offset = m_offset;
+                p_res->crc = m_crc;
+                return NRF_DFU_RES_CODE_SUCCESS;
+            }
+            return NRF_DFU_RES_CODE_UNSUPPORTED_TYPE;
+
+        default:
+            return NRF_DFU_RES_CODE_OP_CODE_NOT_SUPPORTED;
+    }
+}
+
+
+uint32_t nrf_dfu_settings_ext_checkpoint_store(uint32_t key, uint32_t offset, uint32_t crc) {
+    // A checkpoint must never get ahead of the data in flash.
+    TEST_CHECK_EQUAL(s_dfu_settings.progress.command_crc, key);
+    TEST_CHECK(offset <= flashed_len_get());
+    TEST_CHECK_EQUAL(nrf_dfu_crc32_update(0, m_image, offset), crc);
+
+    m_checkpoints++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t nrf_dfu_settings_ext_timeout_get(nrf_dfu_timeout_reason_t reason) {
+    UNUSED_PARAMETER(reason);
+    return NRF_DFU_TIMEOUT_POST_DISCONNECT_MS;
+}
+
+
+void fake_req_handler_reset(void) {
+    memset(&s_dfu_settings, 0, sizeof(s_dfu_settings));
+    m_cmd_len = 0;
+    m_cmd_size = 0;
+    m_cmd_executed = false;
+    m_image_size = 0;
+    m_offset = 0;
+    m_crc = 0;
+    m_obj_end = 0;
+    m_executed_offset = 0;
+    m_executed_crc = 0;
+    m_cur_type = NRF_DFU_OBJ_TYPE_INVALID;
+    m_op_count = 0;
+    m_checkpoints = 0;
+}
+
+
+uint8_t const *fake_req_handler_image_get(uint32_t *p_len) {
+    *p_len = m_executed_offset;
+    return m_image;
+}
+
+
+bool fake_req_handler_is_complete(void) {
+    return m_cmd_executed && (m_image_size != 0) && (m_executed_offset == m_image_size);
+}
+
+
+uint32_t fake_req_handler_checkpoints_get(void) {
+    return m_checkpoints;
+}
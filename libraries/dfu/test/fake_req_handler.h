@@ -0,0 +1,39 @@
+#ifndef FAKE_REQ_HANDLER_H__
+#define FAKE_REQ_HANDLER_H__
+
+/**@brief Host stand-in for the SDK 12 request handler and the bootloader settings.
+ *
+ * @details Keeps the firmware image in RAM. The init command is the 32-bit little endian size of
+ *          the image, the rest of it is not looked at. Executing a data object makes its data
+ *          part of the image, creating one again rolls back to the end of the last executed
+ *          object. Each write queues a flash operation on the fake SoftDevice that takes as long
+ *          as erasing the pages it starts and programming its words, and the data only counts
+ *          as programmed once that operation is done.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_dfu_types.h"
+
+#define FAKE_REQ_COMMAND_MAX_SIZE       256                 /**< Largest init command, as INIT_COMMAND_MAX_SIZE of SDK 12. */
+#define FAKE_REQ_DATA_MAX_SIZE          (4 * CODE_PAGE_SIZE) /**< Largest data object, as DATA_OBJECT_MAX_SIZE of SDK 12. */
+#define FAKE_REQ_IMAGE_MAX_SIZE         (64 * 1024)         /**< Largest firmware image. */
+
+/**@brief Function for resetting the request handler, no update is in progress afterwards. */
+void fake_req_handler_reset(void);
+
+/**@brief Function for getting the firmware image received so far.
+ *
+ * @param[out] p_len    Length of the executed data.
+ *
+ * @return  Image data.
+ */
+uint8_t const *fake_req_handler_image_get(uint32_t *p_len);
+
+/**@brief Function for checking if every data object of the image was executed. */
+bool fake_req_handler_is_complete(void);
+
+/**@brief Function for getting the number of progress checkpoints that were stored. */
+uint32_t fake_req_handler_checkpoints_get(void);
+
+#endif // FAKE_REQ_HANDLER_H__
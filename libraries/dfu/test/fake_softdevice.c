@@ -0,0 +1,889 @@
+#include "fake_softdevice.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "fstorage.h"
+#include "ble_conn_params.h"
+#include "softdevice_handler_appsh.h"
+#include "nrf_dfu_mbr.h"
+#include "test_util.h"
+
+#define CONN_HANDLE                 0                                   /**< Handle of the only connection. */
+#define MAX_CHARS                   8                                   /**< Number of characteristics the GATT table holds. */
+#define MAX_TX_BUFFERS              16                                  /**< Largest number of TX buffers that can be configured. */
+#define FLASH_QUEUE_LEN             64                                  /**< Number of flash operations that can be queued. */
+#define DEVICE_NAME_MAX_LEN         31
+#define UNIT_1_25_MS_US             1250                                /**< Length of a connection interval unit in microseconds. */
+#define HCI_LOCAL_HOST_TERMINATED   0x16
+#define HCI_REMOTE_USER_TERMINATED  0x13
+
+fake_sd_config_t const g_fake_sd_default_config =
+{
+    .conn_interval      = 12,
+    .rx_pkts_per_event  = 4,
+    .tx_pkts_per_event  = 4,
+    .tx_buffers         = 7,
+    .peer_mtu           = FAKE_SD_MAX_ATT_MTU,
+    .flash_erase_us     = 21000,
+    .flash_word_us      = 41,
+};
+
+/**@brief Characteristic in the GATT table. */
+typedef struct
+{
+    uint16_t uuid;
+    uint16_t value_handle;
+    uint16_t cccd_handle;                                               /**< BLE_GATT_HANDLE_INVALID if the characteristic cannot notify. */
+    uint16_t cccd_value;
+    bool     wr_auth;
+} fake_char_t;
+
+/**@brief Write of the DFU Controller, or a notification to it. */
+typedef struct
+{
+    uint16_t handle;
+    uint8_t  op;
+    uint16_t len;
+    uint8_t  data[FAKE_SD_MAX_ATT_MTU];
+} fake_pdu_t;
+
+static fake_sd_config_t     m_config;
+static fake_sd_stats_t      m_stats;
+static uint64_t             m_now_us;
+
+static ble_evt_handler_t    m_evt_handler;
+static union
+{
+    ble_evt_t evt;
+    uint8_t   raw[sizeof(ble_evt_t) + FAKE_SD_MAX_ATT_MTU];             /**< Room for the value of a write event. */
+} m_evt_buf;
+
+static fake_char_t          m_chars[MAX_CHARS];
+static uint8_t              m_char_count;
+static uint16_t             m_next_handle;
+static uint8_t              m_uuid_types;
+
+static ble_gap_addr_t       m_addr;
+static uint8_t              m_device_name[DEVICE_NAME_MAX_LEN];
+static uint16_t             m_device_name_len;
+
+static bool                 m_advertising;
+static bool                 m_adv_directed;
+static uint64_t             m_adv_timeout_us;                           /**< End of directed advertising. */
+
+static bool                 m_connected;
+static uint16_t             m_conn_interval;
+static uint64_t             m_next_conn_evt_us;
+static uint16_t             m_att_mtu;
+static bool                 m_disconnect_pending;
+static uint8_t              m_disconnect_reason;
+static bool                 m_conn_params_pending;
+static ble_gap_conn_params_t m_conn_params;
+static uint16_t             m_mtu_req;                                  /**< Client RX MTU of a pending MTU exchange, 0 if none. */
+static bool                 m_att_req_pending;                          /**< A write request waits for its authorization. */
+
+static fake_pdu_t           m_writes[FAKE_SD_WRITE_QUEUE_LEN];
+static uint8_t              m_writes_head;
+static uint8_t              m_writes_count;
+
+static fake_pdu_t           m_tx[MAX_TX_BUFFERS];
+static uint8_t              m_tx_head;
+static uint8_t              m_tx_count;
+
+static fake_pdu_t           m_inbox[FAKE_SD_NOTIF_INBOX_LEN];
+static uint8_t              m_inbox_head;
+static uint8_t              m_inbox_count;
+
+static uint64_t             m_flash_ends[FLASH_QUEUE_LEN];              /**< End times of the queued flash operations, oldest first. */
+static uint8_t              m_flash_head;
+static uint8_t              m_flash_count;
+static uint64_t             m_flash_last_end;
+static uint32_t             m_flash_done;
+
+static app_timer_t         *mp_timers;                                  /**< Created timers. */
+
+
+static void evt_send(uint16_t evt_id) {
+    m_evt_buf.evt.header.evt_id = evt_id;
+    m_evt_buf.evt.header.evt_len = sizeof(m_evt_buf.evt);
+
+    if (m_evt_handler != NULL) {
+        m_evt_handler(&m_evt_buf.evt);
+    }
+}
+
+
+static fake_char_t *char_find(uint16_t handle) {
+    for (uint8_t i = 0; i < m_char_count; i++) {
+        if ((m_chars[i].value_handle == handle) || (m_chars[i].cccd_handle == handle)) {
+            return &m_chars[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+static uint64_t conn_interval_us(void) {
+    return (uint64_t)m_conn_interval * UNIT_1_25_MS_US;
+}
+
+
+static void disconnect_now(uint8_t reason) {
+    m_connected = false;
+    m_disconnect_pending = false;
+    m_conn_params_pending = false;
+    m_mtu_req = 0;
+    m_att_req_pending = false;
+    m_writes_count = 0;
+    m_tx_count = 0;
+
+    memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+    m_evt_buf.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+    m_evt_buf.evt.evt.gap_evt.params.disconnected.reason = reason;
+    evt_send(BLE_GAP_EVT_DISCONNECTED);
+}
+
+
+/**@brief Function for delivering one write of the DFU Controller to the application. */
+static void write_deliver(fake_pdu_t const *p_write) {
+    fake_char_t const *p_char = char_find(p_write->handle);
+
+    TEST_CHECK(p_char != NULL);
+    TEST_CHECK(p_write->len <= (m_att_mtu - 3));
+
+    m_stats.writes++;
+    memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+    m_evt_buf.evt.evt.gatts_evt.conn_handle = CONN_HANDLE;
+
+    if (p_char->wr_auth && (p_write->op == BLE_GATTS_OP_WRITE_REQ)) {
+        ble_gatts_evt_write_t *p_evt_write = &m_evt_buf.evt.evt.gatts_evt.params.authorize_request.request.write;
+
+        m_att_req_pending = true;
+        m_evt_buf.evt.evt.gatts_evt.params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        p_evt_write->handle = p_write->handle;
+        p_evt_write->op = p_write->op;
+        p_evt_write->len = p_write->len;
+        memcpy(p_evt_write->data, p_write->data, p_write->len);
+        evt_send(BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST);
+    }
+    else {
+        ble_gatts_evt_write_t *p_evt_write = &m_evt_buf.evt.evt.gatts_evt.params.write;
+
+        p_evt_write->handle = p_write->handle;
+        p_evt_write->op = p_write->op;
+        p_evt_write->len = p_write->len;
+        memcpy(p_evt_write->data, p_write->data, p_write->len);
+        evt_send(BLE_GATTS_EVT_WRITE);
+    }
+}
+
+
+/**@brief Function for running one connection event.
+ *
+ * @details Pending procedures complete first, then the DFU Controller sends its writes and the
+ *          notifications in the TX buffers go out.
+ */
+static void conn_event(void) {
+    uint8_t sent = 0;
+
+    m_stats.conn_events++;
+    m_next_conn_evt_us += conn_interval_us();
+
+    if (m_disconnect_pending) {
+        disconnect_now(m_disconnect_reason);
+        return;
+    }
+
+    if (m_conn_params_pending) {
+        m_conn_params_pending = false;
+        m_conn_interval = m_conn_params.min_conn_interval;
+        m_next_conn_evt_us = m_now_us + conn_interval_us();
+        m_stats.conn_param_updates++;
+
+        memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+        m_evt_buf.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+        m_evt_buf.evt.evt.gap_evt.params.conn_param_update.conn_params = m_conn_params;
+        m_evt_buf.evt.evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval = m_conn_interval;
+        evt_send(BLE_GAP_EVT_CONN_PARAM_UPDATE);
+    }
+
+    if (m_mtu_req != 0) {
+        m_att_mtu = MAX(MIN(m_mtu_req, m_config.peer_mtu), GATT_MTU_SIZE_DEFAULT);
+        m_mtu_req = 0;
+
+        memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+        m_evt_buf.evt.evt.gattc_evt.conn_handle = CONN_HANDLE;
+        m_evt_buf.evt.evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu = m_config.peer_mtu;
+        evt_send(BLE_GATTC_EVT_EXCHANGE_MTU_RSP);
+    }
+
+    for (uint8_t i = 0; (i < m_config.rx_pkts_per_event) && (m_writes_count > 0); i++) {
+        fake_pdu_t *p_write = &m_writes[m_writes_head];
+
+        // ATT allows one outstanding request, the writes behind it wait as well.
+        if ((p_write->op == BLE_GATTS_OP_WRITE_REQ) && m_att_req_pending) {
+            break;
+        }
+
+        m_writes_head = (m_writes_head + 1) % FAKE_SD_WRITE_QUEUE_LEN;
+        m_writes_count--;
+        write_deliver(p_write);
+
+        if (!m_connected || m_disconnect_pending) {
+            return;
+        }
+    }
+
+    while ((sent < m_config.tx_pkts_per_event) && (m_tx_count > 0)) {
+        TEST_CHECK(m_inbox_count < FAKE_SD_NOTIF_INBOX_LEN);
+
+        m_inbox[(m_inbox_head + m_inbox_count) % FAKE_SD_NOTIF_INBOX_LEN] = m_tx[m_tx_head];
+        m_inbox_count++;
+        m_tx_head = (m_tx_head + 1) % MAX_TX_BUFFERS;
+        m_tx_count--;
+        m_stats.notifs++;
+        sent++;
+    }
+
+    if (sent > 0) {
+        memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+        m_evt_buf.evt.evt.common_evt.conn_handle = CONN_HANDLE;
+        m_evt_buf.evt.evt.common_evt.params.tx_complete.count = sent;
+        evt_send(BLE_EVT_TX_COMPLETE);
+    }
+}
+
+
+void fake_sd_reset(fake_sd_config_t const *p_config) {
+    TEST_CHECK(p_config->tx_buffers <= MAX_TX_BUFFERS);
+    TEST_CHECK(p_config->peer_mtu <= FAKE_SD_MAX_ATT_MTU);
+
+    m_config = *p_config;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_now_us = 0;
+    m_evt_handler = NULL;
+    m_char_count = 0;
+    m_next_handle = 1;
+    m_uuid_types = 0;
+    m_advertising = false;
+    m_connected = false;
+    m_disconnect_pending = false;
+    m_conn_params_pending = false;
+    m_mtu_req = 0;
+    m_att_req_pending = false;
+    m_att_mtu = GATT_MTU_SIZE_DEFAULT;
+    m_writes_count = 0;
+    m_tx_count = 0;
+    m_inbox_count = 0;
+    m_flash_count = 0;
+    m_flash_last_end = 0;
+    m_flash_done = 0;
+    mp_timers = NULL;
+}
+
+
+void fake_sd_step(void) {
+    uint64_t next = UINT64_MAX;
+
+    if (m_connected) {
+        next = m_next_conn_evt_us;
+    }
+    if (m_advertising && m_adv_directed) {
+        next = MIN(next, m_adv_timeout_us);
+    }
+    if (m_flash_count > 0) {
+        next = MIN(next, m_flash_ends[m_flash_head]);
+    }
+    for (app_timer_t *p_timer = mp_timers; p_timer != NULL; p_timer = p_timer->p_next) {
+        if (p_timer->active) {
+            next = MIN(next, p_timer->expiry_us);
+        }
+    }
+
+    // Nothing left that could happen, the test waits for something that never comes.
+    TEST_CHECK(next != UINT64_MAX);
+    m_now_us = MAX(m_now_us, next);
+
+    while ((m_flash_count > 0) && (m_flash_ends[m_flash_head] <= m_now_us)) {
+        m_flash_head = (m_flash_head + 1) % FLASH_QUEUE_LEN;
+        m_flash_count--;
+        m_flash_done++;
+    }
+
+    for (app_timer_t *p_timer = mp_timers; p_timer != NULL; p_timer = p_timer->p_next) {
+        if (p_timer->active && (p_timer->expiry_us <= m_now_us)) {
+            if (p_timer->mode == APP_TIMER_MODE_REPEATED) {
+                p_timer->expiry_us += p_timer->period_us;
+            }
+            else {
+                p_timer->active = false;
+            }
+            p_timer->handler(p_timer->p_context);
+        }
+    }
+
+    if (m_advertising && m_adv_directed && (m_adv_timeout_us <= m_now_us)) {
+        m_advertising = false;
+
+        memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+        m_evt_buf.evt.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+        m_evt_buf.evt.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_ADVERTISING;
+        evt_send(BLE_GAP_EVT_TIMEOUT);
+    }
+
+    if (m_connected && (m_next_conn_evt_us <= m_now_us)) {
+        conn_event();
+    }
+}
+
+
+uint64_t fake_sd_time_us(void) {
+    return m_now_us;
+}
+
+
+bool fake_sd_connect(void) {
+    if (!m_advertising || m_connected) {
+        return false;
+    }
+
+    m_advertising = false;
+    m_connected = true;
+    m_conn_interval = m_config.conn_interval;
+    m_next_conn_evt_us = m_now_us + conn_interval_us();
+    m_att_mtu = GATT_MTU_SIZE_DEFAULT;
+
+    for (uint8_t i = 0; i < m_char_count; i++) {
+        m_chars[i].cccd_value = 0;
+    }
+
+    memset(&m_evt_buf, 0, sizeof(m_evt_buf));
+    m_evt_buf.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+    m_evt_buf.evt.evt.gap_evt.params.connected.peer_addr.addr[0] = 0xC0;
+    m_evt_buf.evt.evt.gap_evt.params.connected.conn_params.min_conn_interval = m_conn_interval;
+    m_evt_buf.evt.evt.gap_evt.params.connected.conn_params.max_conn_interval = m_conn_interval;
+    evt_send(BLE_GAP_EVT_CONNECTED);
+    return true;
+}
+
+
+void fake_sd_disconnect(void) {
+    if (m_connected) {
+        m_disconnect_pending = true;
+        m_disconnect_reason = HCI_REMOTE_USER_TERMINATED;
+    }
+}
+
+
+bool fake_sd_is_connected(void) {
+    return m_connected;
+}
+
+
+bool fake_sd_is_advertising(void) {
+    return m_advertising;
+}
+
+
+uint16_t fake_sd_att_mtu_get(void) {
+    return m_att_mtu;
+}
+
+
+uint16_t fake_sd_handle_get(uint16_t uuid) {
+    for (uint8_t i = 0; i < m_char_count; i++) {
+        if (m_chars[i].uuid == uuid) {
+            return m_chars[i].value_handle;
+        }
+    }
+
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+
+void fake_sd_cccd_set(uint16_t value_handle, bool notify) {
+    fake_char_t *p_char = char_find(value_handle);
+
+    TEST_CHECK((p_char != NULL) && (p_char->cccd_handle != BLE_GATT_HANDLE_INVALID));
+    p_char->cccd_value = notify ? 1 : 0;
+}
+
+
+bool fake_sd_write(uint16_t handle, uint8_t op, uint8_t const *p_data, uint16_t len) {
+    fake_pdu_t *p_write;
+
+    TEST_CHECK(m_connected);
+    TEST_CHECK(len <= (m_att_mtu - 3));
+
+    if (m_writes_count >= FAKE_SD_WRITE_QUEUE_LEN) {
+        return false;
+    }
+
+    p_write = &m_writes[(m_writes_head + m_writes_count) % FAKE_SD_WRITE_QUEUE_LEN];
+    p_write->handle = handle;
+    p_write->op = op;
+    p_write->len = len;
+    memcpy(p_write->data, p_data, len);
+    m_writes_count++;
+    return true;
+}
+
+
+bool fake_sd_notif_get(uint16_t *p_handle, uint8_t *p_data, uint16_t *p_len) {
+    fake_pdu_t const *p_notif;
+
+    if (m_inbox_count == 0) {
+        return false;
+    }
+
+    p_notif = &m_inbox[m_inbox_head];
+    *p_handle = p_notif->handle;
+    *p_len = p_notif->len;
+    memcpy(p_data, p_notif->data, p_notif->len);
+
+    m_inbox_head = (m_inbox_head + 1) % FAKE_SD_NOTIF_INBOX_LEN;
+    m_inbox_count--;
+    return true;
+}
+
+
+void fake_sd_flash_op_add(uint32_t pages, uint32_t words) {
+    TEST_CHECK(m_flash_count < FLASH_QUEUE_LEN);
+
+    m_flash_last_end = MAX(m_flash_last_end, m_now_us) +
+                       (uint64_t)pages * m_config.flash_erase_us + (uint64_t)words * m_config.flash_word_us;
+    m_flash_ends[(m_flash_head + m_flash_count) % FLASH_QUEUE_LEN] = m_flash_last_end;
+    m_flash_count++;
+}
+
+
+uint32_t fake_sd_flash_ops_done_get(void) {
+    return m_flash_done;
+}
+
+
+void fake_sd_stats_get(fake_sd_stats_t *p_stats) {
+    *p_stats = m_stats;
+}
+
+
+/* SoftDevice handler and MBR. */
+
+void softdevice_handler_init(nrf_clock_lf_cfg_t const *p_clock_lf_cfg, bool use_scheduler) {
+    UNUSED_PARAMETER(p_clock_lf_cfg);
+    UNUSED_PARAMETER(use_scheduler);
+}
+
+
+uint32_t softdevice_enable_get_default_config(uint8_t central_links_count,
+                                              uint8_t periph_links_count,
+                                              ble_enable_params_t *p_ble_enable_params) {
+    memset(p_ble_enable_params, 0, sizeof(*p_ble_enable_params));
+    p_ble_enable_params->central_conn_count = central_links_count;
+    p_ble_enable_params->periph_conn_count = periph_links_count;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_enable(ble_enable_params_t *p_ble_enable_params) {
+#if (NRF_SD_BLE_API_VERSION >= 3)
+    TEST_CHECK(p_ble_enable_params->gatt_enable_params.att_mtu <= FAKE_SD_MAX_ATT_MTU);
+#else
+    UNUSED_PARAMETER(p_ble_enable_params);
+#endif
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler) {
+    m_evt_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_softdevice_vector_table_base_set(uint32_t address) {
+    UNUSED_PARAMETER(address);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t nrf_dfu_mbr_init_sd(void) {
+    return NRF_SUCCESS;
+}
+
+
+/* BLE common and GAP. */
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type) {
+    UNUSED_PARAMETER(p_vs_uuid);
+
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + m_uuid_types++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, ble_user_mem_block_t const *p_block) {
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(p_block);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t *p_addr) {
+    *p_addr = m_addr;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_address_set(uint8_t addr_cycle_mode, ble_gap_addr_t const *p_addr) {
+    UNUSED_PARAMETER(addr_cycle_mode);
+
+    m_addr = *p_addr;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_addr_get(ble_gap_addr_t *p_addr) {
+    *p_addr = m_addr;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_addr_set(ble_gap_addr_t const *p_addr) {
+    m_addr = *p_addr;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const *p_write_perm,
+                                    uint8_t const *p_dev_name,
+                                    uint16_t len) {
+    UNUSED_PARAMETER(p_write_perm);
+
+    if (len > sizeof(m_device_name)) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(m_device_name, p_dev_name, len);
+    m_device_name_len = len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_get(uint8_t *p_dev_name, uint16_t *p_len) {
+    memcpy(p_dev_name, m_device_name, MIN(*p_len, m_device_name_len));
+    *p_len = m_device_name_len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const *p_conn_params) {
+    UNUSED_PARAMETER(p_conn_params);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const *p_data, uint8_t dlen, uint8_t const *p_sr_data, uint8_t srdlen) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(p_sr_data);
+
+    return ((dlen > 31) || (srdlen > 31)) ? NRF_ERROR_INVALID_PARAM : NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const *p_adv_params) {
+    if (m_advertising || m_connected) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_advertising = true;
+    m_adv_directed = (p_adv_params->type == BLE_GAP_ADV_TYPE_ADV_DIRECT_IND);
+    m_adv_timeout_us = m_now_us + FAKE_SD_DIRECTED_ADV_US;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_stop(void) {
+    if (!m_advertising) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_advertising = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params) {
+    if (!m_connected || (conn_handle != CONN_HANDLE)) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // The DFU Controller accepts the shortest interval that was asked for.
+    m_conn_params = *p_conn_params;
+    m_conn_params_pending = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code) {
+    UNUSED_PARAMETER(hci_status_code);
+
+    if (!m_connected || (conn_handle != CONN_HANDLE)) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_disconnect_pending = true;
+    m_disconnect_reason = HCI_LOCAL_HOST_TERMINATED;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle,
+                                     uint8_t sec_status,
+                                     void const *p_sec_params,
+                                     void const *p_sec_keyset) {
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(sec_status);
+    UNUSED_PARAMETER(p_sec_params);
+    UNUSED_PARAMETER(p_sec_keyset);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_sec_info_reply(uint16_t conn_handle,
+                                   void const *p_enc_info,
+                                   void const *p_id_info,
+                                   void const *p_sign_info) {
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(p_enc_info);
+    UNUSED_PARAMETER(p_id_info);
+    UNUSED_PARAMETER(p_sign_info);
+    return NRF_SUCCESS;
+}
+
+
+/* GATT server and client. */
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle) {
+    UNUSED_PARAMETER(type);
+    UNUSED_PARAMETER(p_uuid);
+
+    *p_handle = m_next_handle++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle,
+                                         ble_gatts_char_md_t const *p_char_md,
+                                         ble_gatts_attr_t const *p_attr_char_value,
+                                         ble_gatts_char_handles_t *p_handles) {
+    fake_char_t *p_char;
+
+    UNUSED_PARAMETER(service_handle);
+    TEST_CHECK(m_char_count < MAX_CHARS);
+
+    p_char = &m_chars[m_char_count++];
+    memset(p_char, 0, sizeof(*p_char));
+    memset(p_handles, 0, sizeof(*p_handles));
+
+    // Declaration, value and, for characteristics that can notify, the CCCD.
+    m_next_handle++;
+    p_char->uuid = p_attr_char_value->p_uuid->uuid;
+    p_char->value_handle = m_next_handle++;
+    p_char->wr_auth = p_attr_char_value->p_attr_md->wr_auth;
+    if (p_char_md->char_props.notify) {
+        p_char->cccd_handle = m_next_handle++;
+    }
+
+    p_handles->value_handle = p_char->value_handle;
+    p_handles->cccd_handle = p_char->cccd_handle;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value) {
+    fake_char_t const *p_char = char_find(handle);
+
+    UNUSED_PARAMETER(conn_handle);
+
+    // Only the CCCDs have a value worth reading.
+    if ((p_char == NULL) || (p_char->cccd_handle != handle)) {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (p_value->len < BLE_CCCD_VALUE_LEN) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_value->len = BLE_CCCD_VALUE_LEN;
+    (void)uint16_encode(p_char->cccd_value, p_value->p_value);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params) {
+    fake_char_t const *p_char = char_find(p_hvx_params->handle);
+    fake_pdu_t *p_notif;
+
+    if (!m_connected || (conn_handle != CONN_HANDLE) || (p_char == NULL) ||
+        (p_hvx_params->type != BLE_GATT_HVX_NOTIFICATION) || ((p_char->cccd_value & 1) == 0)) {
+        m_stats.hvx_errors++;
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (*p_hvx_params->p_len > (m_att_mtu - 3)) {
+        m_stats.hvx_errors++;
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_tx_count >= m_config.tx_buffers) {
+        m_stats.hvx_no_tx_packets++;
+        return BLE_ERROR_NO_TX_PACKETS;
+    }
+
+    p_notif = &m_tx[(m_tx_head + m_tx_count) % MAX_TX_BUFFERS];
+    p_notif->handle = p_hvx_params->handle;
+    p_notif->op = 0;
+    p_notif->len = *p_hvx_params->p_len;
+    memcpy(p_notif->data, p_hvx_params->p_data, p_notif->len);
+    m_tx_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle,
+                                         ble_gatts_rw_authorize_reply_params_t const *p_rw_authorize_reply_params) {
+    if (!m_connected || (conn_handle != CONN_HANDLE)) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_rw_authorize_reply_params->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) {
+        if (!m_att_req_pending) {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        m_att_req_pending = false;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const *p_sys_attr_data, uint16_t len, uint32_t flags) {
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(p_sys_attr_data);
+    UNUSED_PARAMETER(len);
+    UNUSED_PARAMETER(flags);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_exchange_mtu_reply(uint16_t conn_handle, uint16_t server_rx_mtu) {
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(server_rx_mtu);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gattc_exchange_mtu_request(uint16_t conn_handle, uint16_t client_rx_mtu) {
+    if (!m_connected || (conn_handle != CONN_HANDLE)) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_mtu_req = client_rx_mtu;
+    return NRF_SUCCESS;
+}
+
+
+/* Connection parameters module. */
+
+uint32_t ble_conn_params_init(ble_conn_params_init_t const *p_init) {
+    UNUSED_PARAMETER(p_init);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_conn_params_stop(void) {
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_conn_params_change_conn_params(ble_gap_conn_params_t *p_new_params) {
+    return sd_ble_gap_conn_param_update(CONN_HANDLE, p_new_params);
+}
+
+
+void ble_conn_params_on_ble_evt(ble_evt_t *p_ble_evt) {
+    UNUSED_PARAMETER(p_ble_evt);
+}
+
+
+/* app_timer on the simulated clock. */
+
+uint32_t app_timer_create(app_timer_id_t const *p_timer_id,
+                          app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler) {
+    app_timer_t *p_timer = *p_timer_id;
+    app_timer_t *p_created = mp_timers;
+
+    while ((p_created != NULL) && (p_created != p_timer)) {
+        p_created = p_created->p_next;
+    }
+
+    if (p_created == NULL) {
+        p_timer->p_next = mp_timers;
+        mp_timers = p_timer;
+    }
+
+    p_timer->handler = timeout_handler;
+    p_timer->mode = mode;
+    p_timer->active = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context) {
+    uint64_t timeout_us = ((uint64_t)MAX(timeout_ticks, 1) * 1000000 + APP_TIMER_CLOCK_FREQ - 1) / APP_TIMER_CLOCK_FREQ;
+
+    if ((timer_id == NULL) || (timer_id->handler == NULL)) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    timer_id->active = true;
+    timer_id->expiry_us = m_now_us + timeout_us;
+    timer_id->period_us = timeout_us;
+    timer_id->p_context = p_context;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id) {
+    if (timer_id == NULL) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    timer_id->active = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(uint32_t *p_ticks) {
+    *p_ticks = (uint32_t)((m_now_us * APP_TIMER_CLOCK_FREQ) / 1000000) & 0x00FFFFFF;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t *p_ticks_diff) {
+    *p_ticks_diff = (ticks_to - ticks_from) & 0x00FFFFFF;
+    return NRF_SUCCESS;
+}
+
+
+/* fstorage. */
+
+fs_ret_t fs_queued_op_count_get(uint32_t *p_op_count) {
+    *p_op_count = m_flash_count;
+    return FS_SUCCESS;
+}
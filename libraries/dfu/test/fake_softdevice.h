@@ -0,0 +1,130 @@
+#ifndef FAKE_SOFTDEVICE_H__
+#define FAKE_SOFTDEVICE_H__
+
+/**@brief Host stand-in for the S130 SoftDevice, app_timer and fstorage.
+ *
+ * @details Runs on a simulated clock. Each step advances the clock to the next connection event,
+ *          timer timeout or finished flash operation and processes it. The DFU Controller side is
+ *          driven through the fake_sd_* functions.
+ *
+ *          Per connection event, the DFU Controller sends up to rx_pkts_per_event queued writes,
+ *          then up to tx_pkts_per_event notifications go out and free their SoftDevice TX
+ *          buffers, which is reported with one BLE_EVT_TX_COMPLETE. A write that needs
+ *          authorization holds back the writes behind it until it is authorized, as ATT only
+ *          allows one outstanding request. Flash operations run one after the other, each for
+ *          the time it takes to erase and program what was passed to @ref fake_sd_flash_op_add.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+#define FAKE_SD_WRITE_QUEUE_LEN         32                  /**< Number of writes the DFU Controller can queue. */
+#define FAKE_SD_NOTIF_INBOX_LEN         64                  /**< Number of received notifications the DFU Controller can hold. */
+#define FAKE_SD_MAX_ATT_MTU             247                 /**< Largest ATT MTU the stand-in supports. */
+#define FAKE_SD_DIRECTED_ADV_US         1280000             /**< Duration of high duty cycle directed advertising. */
+
+/**@brief Parameters of the simulated link and flash. */
+typedef struct
+{
+    uint16_t conn_interval;         /**< Connection interval the DFU Controller connects with, in 1.25 ms units. */
+    uint8_t  rx_pkts_per_event;     /**< Number of writes the DFU Controller sends per connection event. */
+    uint8_t  tx_pkts_per_event;     /**< Number of notifications sent per connection event. */
+    uint8_t  tx_buffers;            /**< Number of notifications the SoftDevice can hold before sd_ble_gatts_hvx() fails. */
+    uint16_t peer_mtu;              /**< ATT MTU supported by the DFU Controller. */
+    uint32_t flash_erase_us;        /**< Time to erase a flash page. */
+    uint32_t flash_word_us;         /**< Time to program a flash word. */
+} fake_sd_config_t;
+
+/**@brief Counters of the simulated link. */
+typedef struct
+{
+    uint32_t conn_events;           /**< Number of connection events. */
+    uint32_t writes;                /**< Number of writes delivered to the application. */
+    uint32_t notifs;                /**< Number of notifications delivered to the DFU Controller. */
+    uint32_t hvx_no_tx_packets;     /**< Number of sd_ble_gatts_hvx() calls refused for lack of a TX buffer. */
+    uint32_t hvx_errors;            /**< Number of sd_ble_gatts_hvx() calls refused for any other reason. */
+    uint32_t conn_param_updates;    /**< Number of connection parameter updates. */
+} fake_sd_stats_t;
+
+/**@brief Default parameters, a phone on a 15 ms connection interval and nRF51 flash timings. */
+extern fake_sd_config_t const g_fake_sd_default_config;
+
+/**@brief Function for resetting the stand-in, the clock starts at 0. */
+void fake_sd_reset(fake_sd_config_t const *p_config);
+
+/**@brief Function for advancing the simulated clock to the next event and processing it.
+ *
+ * @details Fails the test if there is nothing left that could happen.
+ */
+void fake_sd_step(void);
+
+/**@brief Function for getting the simulated time in microseconds. */
+uint64_t fake_sd_time_us(void);
+
+/**@brief Function for connecting the DFU Controller.
+ *
+ * @retval true     If the device was advertising and is now connected.
+ * @retval false    If the device was not advertising.
+ */
+bool fake_sd_connect(void);
+
+/**@brief Function for disconnecting the DFU Controller at the next connection event. */
+void fake_sd_disconnect(void);
+
+bool fake_sd_is_connected(void);
+
+bool fake_sd_is_advertising(void);
+
+/**@brief Function for getting the ATT MTU in use on the connection. */
+uint16_t fake_sd_att_mtu_get(void);
+
+/**@brief Function for getting the value handle of a characteristic.
+ *
+ * @param[in] uuid  16-bit UUID of the characteristic.
+ *
+ * @return  Value handle, or BLE_GATT_HANDLE_INVALID if there is no such characteristic.
+ */
+uint16_t fake_sd_handle_get(uint16_t uuid);
+
+/**@brief Function for writing the CCCD of a characteristic, takes effect at once. */
+void fake_sd_cccd_set(uint16_t value_handle, bool notify);
+
+/**@brief Function for queueing a write of the DFU Controller.
+ *
+ * @param[in] handle    Value handle of the characteristic.
+ * @param[in] op        BLE_GATTS_OP_WRITE_CMD or BLE_GATTS_OP_WRITE_REQ.
+ * @param[in] p_data    Value.
+ * @param[in] len       Length of the value, at most the ATT MTU less 3.
+ *
+ * @retval true     If the write was queued.
+ * @retval false    If the write queue is full.
+ */
+bool fake_sd_write(uint16_t handle, uint8_t op, uint8_t const *p_data, uint16_t len);
+
+/**@brief Function for taking the oldest notification received by the DFU Controller.
+ *
+ * @param[out] p_handle Value handle of the characteristic.
+ * @param[out] p_data   Buffer of FAKE_SD_MAX_ATT_MTU bytes for the notification.
+ * @param[out] p_len    Length of the notification.
+ *
+ * @retval true     If a notification was taken.
+ * @retval false    If no notification is waiting.
+ */
+bool fake_sd_notif_get(uint16_t *p_handle, uint8_t *p_data, uint16_t *p_len);
+
+/**@brief Function for queueing a flash operation.
+ *
+ * @details The operation starts once the operations before it are done.
+ *
+ * @param[in] pages Number of pages the operation erases.
+ * @param[in] words Number of words the operation programs.
+ */
+void fake_sd_flash_op_add(uint32_t pages, uint32_t words);
+
+/**@brief Function for getting the number of flash operations that are done. */
+uint32_t fake_sd_flash_ops_done_get(void);
+
+void fake_sd_stats_get(fake_sd_stats_t *p_stats);
+
+#endif // FAKE_SOFTDEVICE_H__
@@ -0,0 +1,8 @@
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+/* Host stand-in for app_error.h, the handlers are part of sdk_common.h. */
+
+#include "sdk_common.h"
+
+#endif // APP_ERROR_H__
@@ -0,0 +1,12 @@
+#ifndef APP_SCHEDULER_H__
+#define APP_SCHEDULER_H__
+
+/* Host stand-in for app_scheduler.h, the test defines app_sched_event_put(). */
+
+#include <stdint.h>
+
+typedef void (*app_sched_event_handler_t)(void *p_event_data, uint16_t event_size);
+
+uint32_t app_sched_event_put(void *p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+
+#endif // APP_SCHEDULER_H__
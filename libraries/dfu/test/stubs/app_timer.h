@@ -0,0 +1,45 @@
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+/* Host stand-in for app_timer.h. fake_softdevice.c runs the timers on the simulated clock, tests
+ * without it define the functions they use. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define APP_TIMER_CLOCK_FREQ            32768
+#define APP_TIMER_TICKS_COMPAT(MS, PRESCALER)                                               \
+            ((uint32_t)(((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ) / (((PRESCALER) + 1) * 1000)))
+
+typedef void (*app_timer_timeout_handler_t)(void *p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+typedef struct app_timer_t
+{
+    app_timer_timeout_handler_t handler;
+    app_timer_mode_t            mode;
+    bool                        active;
+    uint64_t                    expiry_us;              /**< Simulated time of the next timeout. */
+    uint64_t                    period_us;
+    void                       *p_context;
+    struct app_timer_t         *p_next;                 /**< Next created timer. */
+} app_timer_t;
+
+typedef app_timer_t * app_timer_id_t;
+
+#define APP_TIMER_DEF(timer_id)                                                             \
+    static app_timer_t timer_id##_data;                                                     \
+    static const app_timer_id_t timer_id = &timer_id##_data
+
+uint32_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context);
+uint32_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_cnt_get(uint32_t *p_ticks);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t *p_ticks_diff);
+
+#endif // APP_TIMER_H__
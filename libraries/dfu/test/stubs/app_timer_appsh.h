@@ -0,0 +1,8 @@
+#ifndef APP_TIMER_APPSH_H__
+#define APP_TIMER_APPSH_H__
+
+/* Host stand-in for app_timer_appsh.h, timeouts run directly. */
+
+#include "app_timer.h"
+
+#endif // APP_TIMER_APPSH_H__
@@ -0,0 +1,17 @@
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+/* Host stand-in for app_util_platform.h and the NVIC functions, the tests run single-threaded. */
+
+#define APP_IRQ_PRIORITY_LOW            3
+#define UART0_IRQn                      2
+
+#define CRITICAL_REGION_ENTER()         do {
+#define CRITICAL_REGION_EXIT()          } while (0)
+
+#define NVIC_EnableIRQ(irqn)            ((void)(irqn))
+#define NVIC_DisableIRQ(irqn)           ((void)(irqn))
+#define NVIC_ClearPendingIRQ(irqn)      ((void)(irqn))
+#define NVIC_SetPriority(irqn, prio)    ((void)(irqn), (void)(prio))
+
+#endif // APP_UTIL_PLATFORM_H__
@@ -0,0 +1,379 @@
+#ifndef BLE_H__
+#define BLE_H__
+
+/* Host stand-in for the S130 BLE API (ble.h, ble_gap.h, ble_gatts.h, ble_gattc.h and ble_types.h),
+ * limited to what the DFU transport uses. fake_softdevice.c implements the functions. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_common.h"
+
+#ifndef NRF_SD_BLE_API_VERSION
+#define NRF_SD_BLE_API_VERSION                              2
+#endif
+
+#define BLE_ERROR_NO_TX_PACKETS                             (NRF_ERROR_STK_BASE_NUM + 0x004)
+
+#define BLE_CONN_HANDLE_INVALID                             0xFFFF
+#define BLE_GATT_HANDLE_INVALID                             0x0000
+#define BLE_L2CAP_MTU_DEF                                   23
+#define GATT_MTU_SIZE_DEFAULT                               23
+#define BLE_UUID_TYPE_BLE                                   0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN                          0x02
+
+/* Events. */
+#define BLE_EVT_TX_COMPLETE                                 0x01
+#define BLE_EVT_USER_MEM_REQUEST                            0x02
+#define BLE_EVT_USER_MEM_RELEASE                            0x03
+#define BLE_GAP_EVT_CONNECTED                               0x10
+#define BLE_GAP_EVT_DISCONNECTED                            0x11
+#define BLE_GAP_EVT_CONN_PARAM_UPDATE                       0x12
+#define BLE_GAP_EVT_SEC_PARAMS_REQUEST                      0x13
+#define BLE_GAP_EVT_SEC_INFO_REQUEST                        0x14
+#define BLE_GAP_EVT_TIMEOUT                                 0x1B
+#define BLE_GATTC_EVT_EXCHANGE_MTU_RSP                      0x3A
+#define BLE_GATTS_EVT_WRITE                                 0x50
+#define BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST                  0x51
+#define BLE_GATTS_EVT_SYS_ATTR_MISSING                      0x52
+#define BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST                  0x55
+#define BLE_GATTS_EVT_TIMEOUT                               0x56
+
+/* GAP. */
+#define BLE_GAP_ADDR_CYCLE_MODE_NONE                        0x00
+#define BLE_GAP_ADV_TYPE_ADV_IND                            0x00
+#define BLE_GAP_ADV_TYPE_ADV_DIRECT_IND                     0x01
+#define BLE_GAP_ADV_FP_ANY                                  0x00
+#define BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED               0
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE         0x06
+#define BLE_GAP_AD_TYPE_FLAGS                               0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE   0x02
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME                    0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME                 0x09
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA          0xFF
+#define BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP                 0x85
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISING                     0x00
+
+/* GATT. */
+#define BLE_GATT_STATUS_SUCCESS                             0x0000
+#define BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED        0x0106
+#define BLE_GATT_STATUS_ATTERR_APP_BEGIN                    0x0180
+#define BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR        0x01FD
+#define BLE_GATT_HVX_NOTIFICATION                           0x01
+#define BLE_GATT_TIMEOUT_SRC_PROTOCOL                       0x00
+#define BLE_GATTS_SRVC_TYPE_PRIMARY                         0x01
+#define BLE_GATTS_VLOC_STACK                                0x01
+#define BLE_GATTS_AUTHORIZE_TYPE_INVALID                    0x00
+#define BLE_GATTS_AUTHORIZE_TYPE_READ                       0x01
+#define BLE_GATTS_AUTHORIZE_TYPE_WRITE                      0x02
+#define BLE_GATTS_OP_WRITE_REQ                              0x01
+#define BLE_GATTS_OP_WRITE_CMD                              0x02
+#define BLE_GATTS_OP_PREP_WRITE_REQ                         0x04
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL                  0x05
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_NOW                     0x06
+
+#define BLE_UUID_BLE_ASSIGN(instance, value)                                                \
+    do {                                                                                    \
+        (instance).type = BLE_UUID_TYPE_BLE;                                                \
+        (instance).uuid = (value);                                                          \
+    } while (0)
+
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr)                                                 \
+    do {                                                                                    \
+        (ptr)->sm = 1;                                                                      \
+        (ptr)->lv = 1;                                                                      \
+    } while (0)
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr)                                            \
+    do {                                                                                    \
+        (ptr)->sm = 0;                                                                      \
+        (ptr)->lv = 0;                                                                      \
+    } while (0)
+
+typedef struct
+{
+    uint16_t uuid;
+    uint8_t  type;
+} ble_uuid_t;
+
+typedef struct
+{
+    uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct
+{
+    uint8_t *p_mem;
+    uint16_t len;
+} ble_user_mem_block_t;
+
+typedef struct
+{
+    uint8_t addr_type;
+    uint8_t addr[6];
+} ble_gap_addr_t;
+
+typedef struct
+{
+    uint8_t sm : 4;
+    uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct
+{
+    uint8_t                type;
+    ble_gap_addr_t const  *p_peer_addr;
+    uint8_t                fp;
+    uint16_t               interval;
+    uint16_t               timeout;
+} ble_gap_adv_params_t;
+
+typedef struct
+{
+    uint8_t broadcast     : 1;
+    uint8_t read          : 1;
+    uint8_t write_wo_resp : 1;
+    uint8_t write         : 1;
+    uint8_t notify        : 1;
+    uint8_t indicate      : 1;
+    uint8_t auth_signed_wr: 1;
+} ble_gatt_char_props_t;
+
+typedef struct
+{
+    ble_gatt_char_props_t char_props;
+} ble_gatts_char_md_t;
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+    uint8_t                 vlen    : 1;
+    uint8_t                 vloc    : 2;
+    uint8_t                 rd_auth : 1;
+    uint8_t                 wr_auth : 1;
+} ble_gatts_attr_md_t;
+
+typedef struct
+{
+    ble_uuid_t const          *p_uuid;
+    ble_gatts_attr_md_t const *p_attr_md;
+    uint16_t                   init_len;
+    uint16_t                   init_offs;
+    uint16_t                   max_len;
+    uint8_t                   *p_value;
+} ble_gatts_attr_t;
+
+typedef struct
+{
+    uint16_t value_handle;
+    uint16_t user_desc_handle;
+    uint16_t cccd_handle;
+    uint16_t sccd_handle;
+} ble_gatts_char_handles_t;
+
+typedef struct
+{
+    uint16_t len;
+    uint16_t offset;
+    uint8_t *p_value;
+} ble_gatts_value_t;
+
+typedef struct
+{
+    uint16_t        handle;
+    uint8_t         type;
+    uint16_t        offset;
+    uint16_t       *p_len;
+    uint8_t const  *p_data;
+} ble_gatts_hvx_params_t;
+
+typedef struct
+{
+    uint16_t        gatt_status;
+    uint8_t         update : 1;
+    uint16_t        offset;
+    uint16_t        len;
+    uint8_t const  *p_data;
+} ble_gatts_authorize_params_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_authorize_params_t read;
+        ble_gatts_authorize_params_t write;
+    } params;
+} ble_gatts_rw_authorize_reply_params_t;
+
+typedef struct
+{
+    uint16_t att_mtu;
+} ble_gatt_enable_params_t;
+
+typedef struct
+{
+#if (NRF_SD_BLE_API_VERSION >= 3)
+    ble_gatt_enable_params_t gatt_enable_params;
+#endif
+    uint8_t                  central_conn_count;
+    uint8_t                  periph_conn_count;
+} ble_enable_params_t;
+
+/* Events. */
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        struct
+        {
+            uint8_t count;
+        } tx_complete;
+    } params;
+} ble_common_evt_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        struct
+        {
+            ble_gap_addr_t        peer_addr;
+            ble_gap_conn_params_t conn_params;
+        } connected;
+        struct
+        {
+            uint8_t reason;
+        } disconnected;
+        struct
+        {
+            ble_gap_conn_params_t conn_params;
+        } conn_param_update;
+        struct
+        {
+            uint8_t src;
+        } timeout;
+    } params;
+} ble_gap_evt_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t gatt_status;
+    uint16_t error_handle;
+    union
+    {
+        struct
+        {
+            uint16_t server_rx_mtu;
+        } exchange_mtu_rsp;
+    } params;
+} ble_gattc_evt_t;
+
+typedef struct
+{
+    uint16_t   handle;
+    ble_uuid_t uuid;
+    uint8_t    op;
+    uint8_t    auth_required;
+    uint16_t   offset;
+    uint16_t   len;
+    uint8_t    data[1];
+} ble_gatts_evt_write_t;
+
+typedef struct
+{
+    uint16_t   handle;
+    ble_uuid_t uuid;
+    uint16_t   offset;
+} ble_gatts_evt_read_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_evt_read_t  read;
+        ble_gatts_evt_write_t write;
+    } request;
+} ble_gatts_evt_rw_authorize_request_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gatts_evt_write_t                write;
+        ble_gatts_evt_rw_authorize_request_t authorize_request;
+        struct
+        {
+            uint8_t hint;
+        } sys_attr_missing;
+        struct
+        {
+            uint16_t client_rx_mtu;
+        } exchange_mtu_request;
+        struct
+        {
+            uint8_t src;
+        } timeout;
+    } params;
+} ble_gatts_evt_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_common_evt_t common_evt;
+        ble_gap_evt_t    gap_evt;
+        ble_gattc_evt_t  gattc_evt;
+        ble_gatts_evt_t  gatts_evt;
+    } evt;
+} ble_evt_t;
+
+/* SoftDevice functions. */
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type);
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, ble_user_mem_block_t const *p_block);
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t *p_addr);
+uint32_t sd_ble_gap_address_set(uint8_t addr_cycle_mode, ble_gap_addr_t const *p_addr);
+uint32_t sd_ble_gap_addr_get(ble_gap_addr_t *p_addr);
+uint32_t sd_ble_gap_addr_set(ble_gap_addr_t const *p_addr);
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const *p_write_perm, uint8_t const *p_dev_name, uint16_t len);
+uint32_t sd_ble_gap_device_name_get(uint8_t *p_dev_name, uint16_t *p_len);
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const *p_conn_params);
+uint32_t sd_ble_gap_adv_data_set(uint8_t const *p_data, uint8_t dlen, uint8_t const *p_sr_data, uint8_t srdlen);
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const *p_adv_params);
+uint32_t sd_ble_gap_adv_stop(void);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle, uint8_t sec_status, void const *p_sec_params, void const *p_sec_keyset);
+uint32_t sd_ble_gap_sec_info_reply(uint16_t conn_handle, void const *p_enc_info, void const *p_id_info, void const *p_sign_info);
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md, ble_gatts_attr_t const *p_attr_char_value, ble_gatts_char_handles_t *p_handles);
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value);
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params);
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const *p_rw_authorize_reply_params);
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const *p_sys_attr_data, uint16_t len, uint32_t flags);
+uint32_t sd_ble_gatts_exchange_mtu_reply(uint16_t conn_handle, uint16_t server_rx_mtu);
+uint32_t sd_ble_gattc_exchange_mtu_request(uint16_t conn_handle, uint16_t client_rx_mtu);
+
+#endif // BLE_H__
@@ -0,0 +1,30 @@
+#ifndef BLE_CONN_PARAMS_H__
+#define BLE_CONN_PARAMS_H__
+
+/* Host stand-in for ble_conn_params.h. fake_softdevice.c passes parameter changes straight to
+ * sd_ble_gap_conn_param_update(), the negotiation itself is not modelled. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+
+typedef void (*ble_srv_error_handler_t)(uint32_t nrf_error);
+
+typedef struct
+{
+    ble_gap_conn_params_t  *p_conn_params;
+    uint32_t                first_conn_params_update_delay;
+    uint32_t                next_conn_params_update_delay;
+    uint8_t                 max_conn_params_update_count;
+    uint16_t                start_on_notify_cccd_handle;
+    bool                    disconnect_on_fail;
+    ble_srv_error_handler_t error_handler;
+} ble_conn_params_init_t;
+
+uint32_t ble_conn_params_init(ble_conn_params_init_t const *p_init);
+uint32_t ble_conn_params_stop(void);
+uint32_t ble_conn_params_change_conn_params(ble_gap_conn_params_t *p_new_params);
+void ble_conn_params_on_ble_evt(ble_evt_t *p_ble_evt);
+
+#endif // BLE_CONN_PARAMS_H__
@@ -0,0 +1,8 @@
+#ifndef BLE_GATTS_H__
+#define BLE_GATTS_H__
+
+/* Host stand-in for ble_gatts.h, see ble.h. */
+
+#include "ble.h"
+
+#endif // BLE_GATTS_H__
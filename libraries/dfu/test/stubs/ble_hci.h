@@ -0,0 +1,8 @@
+#ifndef BLE_HCI_H__
+#define BLE_HCI_H__
+
+/* Host stand-in for ble_hci.h. */
+
+#define BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION   0x13
+
+#endif // BLE_HCI_H__
@@ -0,0 +1,17 @@
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+
+/* Host stand-in for ble_srv_common.h. */
+
+#include <stdbool.h>
+#include "ble.h"
+
+#define BLE_CCCD_VALUE_LEN              2
+#define BLE_GATT_HVX_NOTIFICATION_BIT   0x0001
+
+static inline bool ble_srv_is_notification_enabled(uint8_t const *p_encoded_data)
+{
+    return (uint16_decode(p_encoded_data) & BLE_GATT_HVX_NOTIFICATION_BIT) != 0;
+}
+
+#endif // BLE_SRV_COMMON_H__
@@ -0,0 +1,12 @@
+#ifndef BOARDS_H__
+#define BOARDS_H__
+
+/* Host stand-in for boards.h. */
+
+#define TX_PIN_NUMBER                   9
+#define RX_PIN_NUMBER                   11
+#define RTS_PIN_NUMBER                  8
+#define CTS_PIN_NUMBER                  10
+#define HWFC                            false
+
+#endif // BOARDS_H__
@@ -0,0 +1,8 @@
+#ifndef COMPILER_ABSTRACTION_H__
+#define COMPILER_ABSTRACTION_H__
+
+/* Host stand-in for compiler_abstraction.h. */
+
+#define __INLINE                        inline
+
+#endif // COMPILER_ABSTRACTION_H__
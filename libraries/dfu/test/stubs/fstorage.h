@@ -0,0 +1,22 @@
+#ifndef FSTORAGE_H__
+#define FSTORAGE_H__
+
+/* Host stand-in for fstorage.h, fake_softdevice.c models the flash operation queue. */
+
+#include <stdint.h>
+
+typedef enum
+{
+    FS_SUCCESS,
+    FS_ERR_NOT_INITIALIZED,
+    FS_ERR_QUEUE_FULL
+} fs_ret_t;
+
+typedef struct
+{
+    uint8_t id;
+} fs_evt_t;
+
+fs_ret_t fs_queued_op_count_get(uint32_t *p_op_count);
+
+#endif // FSTORAGE_H__
@@ -0,0 +1,9 @@
+#ifndef NRF_BOOTLOADER_INFO_H__
+#define NRF_BOOTLOADER_INFO_H__
+
+/* Host stand-in for nrf_bootloader_info.h, nRF51 bootloader layout. */
+
+#define BOOTLOADER_START_ADDR           0x0003AC00
+#define BOOTLOADER_SETTINGS_ADDRESS     0x0003FC00
+
+#endif // NRF_BOOTLOADER_INFO_H__
@@ -0,0 +1,10 @@
+#ifndef NRF_DFU_FLASH_H__
+#define NRF_DFU_FLASH_H__
+
+/* Host stand-in for nrf_dfu_flash.h. */
+
+#include "fstorage.h"
+
+typedef void (*dfu_flash_callback_t)(fs_evt_t const * const evt, fs_ret_t result);
+
+#endif // NRF_DFU_FLASH_H__
@@ -0,0 +1,10 @@
+#ifndef NRF_DFU_MBR_H__
+#define NRF_DFU_MBR_H__
+
+/* Host stand-in for nrf_dfu_mbr.h. */
+
+#include <stdint.h>
+
+uint32_t nrf_dfu_mbr_init_sd(void);
+
+#endif // NRF_DFU_MBR_H__
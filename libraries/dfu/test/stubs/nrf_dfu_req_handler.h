@@ -0,0 +1,73 @@
+#ifndef NRF_DFU_REQ_HANDLER_H__
+#define NRF_DFU_REQ_HANDLER_H__
+
+/* Host stand-in for nrf_dfu_req_handler.h, with the values of SDK 12. fake_req_handler.c
+ * models the request handler. */
+
+#include <stdint.h>
+#include "nrf_dfu_types.h"
+
+typedef enum
+{
+    NRF_DFU_OBJ_TYPE_INVALID,
+    NRF_DFU_OBJ_TYPE_COMMAND,
+    NRF_DFU_OBJ_TYPE_DATA
+} nrf_dfu_obj_type_t;
+
+typedef enum
+{
+    NRF_DFU_RES_CODE_INVALID                 = 0x00,
+    NRF_DFU_RES_CODE_SUCCESS                 = 0x01,
+    NRF_DFU_RES_CODE_OP_CODE_NOT_SUPPORTED   = 0x02,
+    NRF_DFU_RES_CODE_INVALID_PARAMETER       = 0x03,
+    NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES  = 0x04,
+    NRF_DFU_RES_CODE_INVALID_OBJECT          = 0x05,
+    NRF_DFU_RES_CODE_UNSUPPORTED_TYPE        = 0x07,
+    NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED = 0x08,
+    NRF_DFU_RES_CODE_OPERATION_FAILED        = 0x0A
+} nrf_dfu_res_code_t;
+
+typedef enum
+{
+    NRF_DFU_OBJECT_OP_NONE    = 0,
+    NRF_DFU_OBJECT_OP_CREATE  = 1,
+    NRF_DFU_OBJECT_OP_WRITE   = 2,
+    NRF_DFU_OBJECT_OP_EXECUTE = 3,
+    NRF_DFU_OBJECT_OP_CRC     = 4,
+    NRF_DFU_OBJECT_OP_SELECT  = 6
+} nrf_dfu_req_op_t;
+
+typedef struct
+{
+    nrf_dfu_req_op_t req_type;
+    union
+    {
+        struct
+        {
+            uint32_t obj_type;
+            uint32_t object_size;
+        };
+        struct
+        {
+            uint8_t *p_req;
+            uint32_t req_len;
+        };
+    };
+} nrf_dfu_req_t;
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t offset;
+            uint32_t crc;
+            uint32_t max_size;
+        };
+    };
+} nrf_dfu_res_t;
+
+nrf_dfu_res_code_t nrf_dfu_req_handler_on_req(void *p_context, nrf_dfu_req_t *p_req, nrf_dfu_res_t *p_res);
+
+#endif // NRF_DFU_REQ_HANDLER_H__
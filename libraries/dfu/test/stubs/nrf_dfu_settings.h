@@ -0,0 +1,10 @@
+#ifndef NRF_DFU_SETTINGS_H__
+#define NRF_DFU_SETTINGS_H__
+
+/* Host stand-in for nrf_dfu_settings.h, the settings are a variable of the test. */
+
+#include "nrf_dfu_types.h"
+
+extern nrf_dfu_settings_t s_dfu_settings;
+
+#endif // NRF_DFU_SETTINGS_H__
@@ -0,0 +1,38 @@
+#ifndef NRF_DFU_TYPES_H__
+#define NRF_DFU_TYPES_H__
+
+/* Host stand-in for the parts of nrf_dfu_types.h used by the tested modules. The installed
+ * application is an array provided by the test. */
+
+#include <stdint.h>
+#include "nrf_bootloader_info.h"
+
+#define CODE_PAGE_SIZE                  1024
+#define CODE_REGION_1_START             0x0001B000
+#define DFU_APP_DATA_RESERVED           (3 * CODE_PAGE_SIZE)
+#define NRF_DFU_BANK_INVALID            0x00
+#define NRF_DFU_BANK_VALID_APP          0x01
+
+extern uint8_t                          g_test_app[];
+#define MAIN_APPLICATION_START_ADDR     ((uintptr_t)g_test_app)
+
+typedef struct
+{
+    uint32_t image_size;
+    uint32_t image_crc;
+    uint32_t bank_code;
+} nrf_dfu_bank_t;
+
+typedef struct
+{
+    uint32_t command_crc;
+} dfu_progress_t;
+
+typedef struct
+{
+    uint32_t       bootloader_version;
+    nrf_dfu_bank_t bank_0;
+    dfu_progress_t progress;
+} nrf_dfu_settings_t;
+
+#endif // NRF_DFU_TYPES_H__
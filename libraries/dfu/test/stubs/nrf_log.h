@@ -0,0 +1,10 @@
+#ifndef NRF_LOG_H__
+#define NRF_LOG_H__
+
+/* Host stand-in for nrf_log.h, logging is compiled out. */
+
+#define NRF_LOG_INFO(...)               do { } while (0)
+#define NRF_LOG_DEBUG(...)              do { } while (0)
+#define NRF_LOG_ERROR(...)              do { } while (0)
+
+#endif // NRF_LOG_H__
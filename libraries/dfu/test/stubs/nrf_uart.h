@@ -0,0 +1,47 @@
+#ifndef NRF_UART_H__
+#define NRF_UART_H__
+
+/* Host stand-in for nrf_uart.h. Received bytes are pushed by the tests, sent bytes are recorded
+ * by test_uart_txd_set(), which the test defines. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NRF_UART0                       ((void *)0)
+
+#define NRF_UART_BAUDRATE_1000000       0x10000000UL
+#define NRF_UART_PARITY_EXCLUDED        0
+#define NRF_UART_HWFC_DISABLED          0
+#define NRF_UART_HWFC_ENABLED           1
+
+#define NRF_UART_INT_MASK_RXDRDY        (1UL << 2)
+#define NRF_UART_INT_MASK_TXDRDY        (1UL << 7)
+#define NRF_UART_INT_MASK_ERROR         (1UL << 9)
+
+#define NRF_UART_TASK_STARTRX           0
+#define NRF_UART_TASK_STOPRX            1
+#define NRF_UART_TASK_STARTTX           2
+#define NRF_UART_TASK_STOPTX            3
+
+#define NRF_UART_EVENT_RXDRDY           0
+#define NRF_UART_EVENT_TXDRDY           1
+#define NRF_UART_EVENT_ERROR            2
+
+void test_uart_txd_set(uint8_t byte);
+
+#define nrf_uart_baudrate_set(p_reg, baudrate)          ((void)(p_reg), (void)(baudrate))
+#define nrf_uart_txrx_pins_set(p_reg, tx, rx)           ((void)(p_reg), (void)(tx), (void)(rx))
+#define nrf_uart_hwfc_pins_set(p_reg, rts, cts)         ((void)(p_reg), (void)(rts), (void)(cts))
+#define nrf_uart_configure(p_reg, parity, hwfc)         ((void)(p_reg), (void)(parity), (void)(hwfc))
+#define nrf_uart_enable(p_reg)                          ((void)(p_reg))
+#define nrf_uart_disable(p_reg)                         ((void)(p_reg))
+#define nrf_uart_int_enable(p_reg, mask)                ((void)(p_reg), (void)(mask))
+#define nrf_uart_int_disable(p_reg, mask)               ((void)(p_reg), (void)(mask))
+#define nrf_uart_task_trigger(p_reg, task)              ((void)(p_reg), (void)(task))
+#define nrf_uart_event_clear(p_reg, event)              ((void)(p_reg), (void)(event))
+#define nrf_uart_event_check(p_reg, event)              ((void)(p_reg), (void)(event), false)
+#define nrf_uart_errorsrc_get_and_clear(p_reg)          ((void)(p_reg), 0UL)
+#define nrf_uart_rxd_get(p_reg)                         ((void)(p_reg), (uint8_t)0)
+#define nrf_uart_txd_set(p_reg, byte)                   ((void)(p_reg), test_uart_txd_set(byte))
+
+#endif // NRF_UART_H__
@@ -0,0 +1,86 @@
+#ifndef SDK_COMMON_H__
+#define SDK_COMMON_H__
+
+/* Host stand-in for the parts of sdk_common.h used by the tested modules. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NRF_SUCCESS                     0
+#define NRF_ERROR_INTERNAL              3
+#define NRF_ERROR_NO_MEM                4
+#define NRF_ERROR_NOT_FOUND             5
+#define NRF_ERROR_INVALID_PARAM         7
+#define NRF_ERROR_INVALID_STATE         8
+#define NRF_ERROR_NULL                  14
+#define NRF_ERROR_BUSY                  17
+#define NRF_ERROR_STK_BASE_NUM          0x3000
+
+#define STATIC_ASSERT(expr)             _Static_assert((expr), #expr)
+#define UNUSED_PARAMETER(x)             ((void)(x))
+#define UNUSED_VARIABLE(x)              ((void)(x))
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                       ((a) < (b) ? (b) : (a))
+#define CEIL_DIV(a, b)                  ((((a) - 1) / (b)) + 1)
+#define IS_POWER_OF_TWO(a)              (((a) != 0) && ((((a) - 1) & (a)) == 0))
+#define LSB_16(a)                       ((uint8_t)((a) & 0x00FF))
+#define MSB_16(a)                       ((uint8_t)(((a) & 0xFF00) >> 8))
+
+#define UNIT_0_625_MS                   625
+#define UNIT_1_25_MS                    1250
+#define MSEC_TO_UNITS(time, resolution) (((time) * 1000) / (resolution))
+
+#define APP_ERROR_HANDLER(err_code)                                                         \
+    do {                                                                                    \
+        printf("%s:%d: error 0x%x\n", __FILE__, __LINE__, (unsigned int)(err_code));      \
+        exit(1);                                                                            \
+    } while (0)
+
+#define APP_ERROR_CHECK(err_code)                                                           \
+    do {                                                                                    \
+        uint32_t err_code_ = (err_code);                                                    \
+        if (err_code_ != NRF_SUCCESS) {                                                     \
+            APP_ERROR_HANDLER(err_code_);                                                   \
+        }                                                                                   \
+    } while (0)
+
+#define VERIFY_SUCCESS(err_code)                                                            \
+    do {                                                                                    \
+        if ((err_code) != NRF_SUCCESS) {                                                    \
+            return (err_code);                                                              \
+        }                                                                                   \
+    } while (0)
+
+static inline uint32_t uint32_decode(const uint8_t *p_encoded_data)
+{
+    return ((uint32_t)p_encoded_data[0] << 0)  |
+           ((uint32_t)p_encoded_data[1] << 8)  |
+           ((uint32_t)p_encoded_data[2] << 16) |
+           ((uint32_t)p_encoded_data[3] << 24);
+}
+
+static inline uint16_t uint16_decode(const uint8_t *p_encoded_data)
+{
+    return (uint16_t)(p_encoded_data[0] | ((uint16_t)p_encoded_data[1] << 8));
+}
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t *p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t)(value >> 0);
+    p_encoded_data[1] = (uint8_t)(value >> 8);
+    p_encoded_data[2] = (uint8_t)(value >> 16);
+    p_encoded_data[3] = (uint8_t)(value >> 24);
+    return sizeof(uint32_t);
+}
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t *p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t)(value >> 0);
+    p_encoded_data[1] = (uint8_t)(value >> 8);
+    return sizeof(uint16_t);
+}
+
+#endif // SDK_COMMON_H__
@@ -0,0 +1,23 @@
+#ifndef SECTION_VARS_H__
+#define SECTION_VARS_H__
+
+/* Host stand-in for section_vars.h. The GNU linker defines __start_ and __stop_ symbols for
+ * sections named like C identifiers, which takes the place of the SDK linker script entries. The
+ * sections get a prefix, the assembler would otherwise confuse them with a variable of the same name. */
+
+#include <stddef.h>
+
+#define NRF_SECTION_VARS_CREATE_SECTION(section_name, data_type)                            \
+    extern data_type __start_sv_##section_name[];                                              \
+    extern data_type __stop_sv_##section_name[]
+
+#define NRF_SECTION_VARS_REGISTER_VAR(section_name, type_def)                               \
+    __attribute__((section("sv_" #section_name), used)) type_def
+
+#define NRF_SECTION_VARS_GET(i, type_name, section_name)                                    \
+    ((type_name *)&__start_sv_##section_name[(i)])
+
+#define NRF_SECTION_VARS_COUNT(type_name, section_name)                                     \
+    ((size_t)(__stop_sv_##section_name - __start_sv_##section_name))
+
+#endif // SECTION_VARS_H__
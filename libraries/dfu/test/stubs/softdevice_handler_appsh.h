@@ -0,0 +1,32 @@
+#ifndef SOFTDEVICE_HANDLER_APPSH_H__
+#define SOFTDEVICE_HANDLER_APPSH_H__
+
+/* Host stand-in for softdevice_handler_appsh.h and nrf_sdm.h. fake_softdevice.c delivers the
+ * BLE events directly instead of through the scheduler. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+typedef struct
+{
+    uint8_t source;
+    uint8_t rc_ctiv;
+    uint8_t rc_temp_ctiv;
+    uint8_t xtal_accuracy;
+} nrf_clock_lf_cfg_t;
+
+#define NRF_CLOCK_LFCLKSRC              { .source = 1, .rc_ctiv = 0, .rc_temp_ctiv = 0, .xtal_accuracy = 7 }
+
+typedef void (*ble_evt_handler_t)(ble_evt_t *p_ble_evt);
+
+#define SOFTDEVICE_HANDLER_APPSH_INIT(CLOCK_SOURCE, USE_SCHEDULER)                          \
+    softdevice_handler_init((CLOCK_SOURCE), (USE_SCHEDULER))
+
+void softdevice_handler_init(nrf_clock_lf_cfg_t const *p_clock_lf_cfg, bool use_scheduler);
+uint32_t softdevice_enable_get_default_config(uint8_t central_links_count, uint8_t periph_links_count, ble_enable_params_t *p_ble_enable_params);
+uint32_t softdevice_enable(ble_enable_params_t *p_ble_enable_params);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t sd_softdevice_vector_table_base_set(uint32_t address);
+
+#endif // SOFTDEVICE_HANDLER_APPSH_H__
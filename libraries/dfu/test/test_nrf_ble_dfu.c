@@ -0,0 +1,192 @@
+/* Drives the BLE transport over the fake SoftDevice with a scripted DFU Controller. The transport
+ * keeps its state in statics, so every test runs in its own process. */
+#include <string.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "nrf_ble_dfu.h"
+#include "nrf_dfu_transport.h"
+#include "fake_softdevice.h"
+#include "fake_req_handler.h"
+#include "dfu_controller.h"
+#include "test_util.h"
+
+#define FW_LEN          (40 * 1024 + 123)   /**< Not a multiple of the object size nor of the packet size. */
+
+APP_TIMER_DEF(m_app_start_timer);
+
+static uint8_t m_fw[FW_LEN];
+static uint8_t m_init[4];
+
+
+static void setup(fake_sd_config_t const *p_config) {
+    uint32_t i;
+    uint32_t seed = 0x2545F491;
+
+    for (i = 0; i < sizeof(m_fw); i++) {
+        seed = (seed * 1103515245) + 12345;
+        m_fw[i] = (uint8_t)(seed >> 16);
+    }
+    (void)uint32_encode(sizeof(m_fw), m_init);
+
+    fake_sd_reset(p_config);
+    fake_req_handler_reset();
+
+    TEST_CHECK_EQUAL(NRF_SUCCESS, app_timer_create(&m_app_start_timer, APP_TIMER_MODE_SINGLE_SHOT, NULL));
+    TEST_CHECK_EQUAL(NRF_SUCCESS, nrf_dfu_transports_init(m_app_start_timer));
+    TEST_CHECK(fake_sd_is_advertising());
+}
+
+
+/**@brief Function for running an update and checking the image and the transport counters. */
+static void update(dfu_controller_config_t const *p_config, dfu_controller_result_t *p_result) {
+    ble_dfu_stats_t stats;
+    uint8_t const  *p_image;
+    uint32_t        image_len;
+
+    dfu_controller_update(p_config, m_init, sizeof(m_init), m_fw, sizeof(m_fw), p_result);
+
+    TEST_CHECK(fake_req_handler_is_complete());
+    p_image = fake_req_handler_image_get(&image_len);
+    TEST_CHECK_EQUAL(sizeof(m_fw), image_len);
+    TEST_CHECK_MEMORY(m_fw, p_image, sizeof(m_fw));
+
+    ble_dfu_stats_get(&stats);
+    TEST_CHECK_EQUAL(0, stats.hvx_failures);
+    TEST_CHECK_EQUAL(p_result->prns, stats.prns_sent);
+    TEST_CHECK(stats.bytes_written >= sizeof(m_fw));
+}
+
+
+/**@brief Function for printing the throughput, the benchmark figure CI keeps track of. */
+static void benchmark_print(char const *p_name, dfu_controller_result_t const *p_result) {
+    printf("    %s: %u bytes in %llu ms, %llu B/s, %u packets, %u PRNs\n",
+           p_name,
+           (unsigned)sizeof(m_fw),
+           (unsigned long long)(p_result->duration_us / 1000),
+           (unsigned long long)((sizeof(m_fw) * 1000000ULL) / p_result->duration_us),
+           (unsigned)p_result->pkts,
+           (unsigned)p_result->prns);
+}
+
+
+static void test_update(void) {
+    dfu_controller_config_t const config = { .prn = 10 };
+    dfu_controller_result_t       result;
+
+    setup(&g_fake_sd_default_config);
+    update(&config, &result);
+
+    TEST_CHECK_EQUAL(0, result.reconnects);
+    TEST_CHECK(result.prns > 0);
+    TEST_CHECK(fake_req_handler_checkpoints_get() > 0);
+    benchmark_print("standard opcodes", &result);
+}
+
+
+static void test_update_extended(void) {
+    dfu_controller_config_t const config = { .prn = 10, .extended = true };
+    dfu_controller_result_t       result;
+
+    setup(&g_fake_sd_default_config);
+    update(&config, &result);
+
+    TEST_CHECK_EQUAL(0, result.reconnects);
+    benchmark_print("extended opcodes", &result);
+}
+
+
+static void test_update_slow_link(void) {
+    dfu_controller_config_t const config = { .prn = 10 };
+    dfu_controller_result_t       result;
+    fake_sd_config_t              sd_config = g_fake_sd_default_config;
+
+    fake_sd_stats_t               sd_stats;
+
+    // A phone that connects slowly and sends one packet per event, the transport asks for more.
+    sd_config.conn_interval = 48;
+    sd_config.rx_pkts_per_event = 1;
+    setup(&sd_config);
+    update(&config, &result);
+
+    fake_sd_stats_get(&sd_stats);
+    TEST_CHECK(sd_stats.conn_param_updates > 0);
+    benchmark_print("slow link", &result);
+}
+
+
+static void test_update_slow_flash(void) {
+    dfu_controller_config_t const config = { .prn = 0, .extended = true };
+    dfu_controller_result_t       result;
+    fake_sd_config_t              sd_config = g_fake_sd_default_config;
+
+    // Flash cannot keep up with the link, the transport has to hold the DFU Controller back.
+    sd_config.rx_pkts_per_event = 8;
+    sd_config.flash_erase_us *= 4;
+    sd_config.flash_word_us *= 4;
+    setup(&sd_config);
+    update(&config, &result);
+
+    benchmark_print("slow flash", &result);
+}
+
+
+static void test_saturated_tx(void) {
+    dfu_controller_config_t const config = { .prn = 1, .extended = true, .prns_ahead = 8 };
+    dfu_controller_result_t       result;
+    fake_sd_config_t              sd_config = g_fake_sd_default_config;
+    fake_sd_stats_t               sd_stats;
+
+    // One notification per event against four writes per event, each asking for one.
+    sd_config.tx_buffers = 1;
+    sd_config.tx_pkts_per_event = 1;
+    setup(&sd_config);
+    update(&config, &result);
+
+    // Every packet got its notification, none was refused by the SoftDevice.
+    fake_sd_stats_get(&sd_stats);
+    TEST_CHECK_EQUAL(result.pkts, result.prns);
+    TEST_CHECK(sd_stats.hvx_no_tx_packets > 0);
+    TEST_CHECK_EQUAL(0, sd_stats.hvx_errors);
+    benchmark_print("saturated TX", &result);
+}
+
+
+static void test_resume_after_disconnect(void) {
+    dfu_controller_config_t const config = { .prn = 10, .disconnect_at = 6000 };
+    dfu_controller_result_t       result;
+
+    setup(&g_fake_sd_default_config);
+    update(&config, &result);
+
+    TEST_CHECK_EQUAL(1, result.reconnects);
+    benchmark_print("resumed", &result);
+}
+
+
+static void test_close_disconnects(void) {
+    dfu_controller_config_t const config = { .prn = 10 };
+    dfu_controller_result_t       result;
+
+    setup(&g_fake_sd_default_config);
+    update(&config, &result);
+
+    TEST_CHECK(fake_sd_is_connected());
+    TEST_CHECK_EQUAL(NRF_SUCCESS, nrf_dfu_transports_close());
+    fake_sd_step();
+    TEST_CHECK(!fake_sd_is_connected());
+}
+
+
+int main(void) {
+    printf("nrf_ble_dfu\n");
+
+    TEST_RUN_FORKED(test_update);
+    TEST_RUN_FORKED(test_update_extended);
+    TEST_RUN_FORKED(test_update_slow_link);
+    TEST_RUN_FORKED(test_update_slow_flash);
+    TEST_RUN_FORKED(test_saturated_tx);
+    TEST_RUN_FORKED(test_resume_after_disconnect);
+    TEST_RUN_FORKED(test_close_disconnects);
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "nrf_dfu_crc32.h"
+
+#include "test_util.h"
+
+
+/**@brief Function for computing the reference CRC32, one bit at a time. */
+static uint32_t crc32_reference(uint8_t const *p_data, uint32_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= p_data[i];
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+
+static void test_known_vectors(void) {
+    static uint8_t const zeros[32] = {0};
+
+    TEST_CHECK_EQUAL(0x00000000, nrf_dfu_crc32_update(0, "", 0));
+    TEST_CHECK_EQUAL(0xE8B7BE43, nrf_dfu_crc32_update(0, "a", 1));
+    TEST_CHECK_EQUAL(0xCBF43926, nrf_dfu_crc32_update(0, "123456789", 9));
+    TEST_CHECK_EQUAL(0x414FA339, nrf_dfu_crc32_update(0, "The quick brown fox jumps over the lazy dog", 43));
+    TEST_CHECK_EQUAL(0x190A55AD, nrf_dfu_crc32_update(0, zeros, sizeof(zeros)));
+}
+
+
+static void test_matches_reference(void) {
+    static uint8_t data[1031];
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 131 + (i >> 3));
+    }
+
+    // Every length and start alignment takes the bytewise head and tail paths.
+    for (uint32_t offset = 0; offset < 8; offset++) {
+        for (uint32_t len = 0; len <= 64; len++) {
+            TEST_CHECK_EQUAL(crc32_reference(&data[offset], len),
+                             nrf_dfu_crc32_update(0, &data[offset], len));
+        }
+    }
+
+    TEST_CHECK_EQUAL(crc32_reference(data, sizeof(data)), nrf_dfu_crc32_update(0, data, sizeof(data)));
+}
+
+
+static void test_chunked_update(void) {
+    static uint8_t data[4096 + 3];
+    uint32_t whole;
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i ^ (i >> 8));
+    }
+
+    whole = nrf_dfu_crc32_update(0, data, sizeof(data));
+
+    // Packet sizes of the BLE transport, from the default MTU up to the largest.
+    static uint32_t const chunk_lens[] = {1, 3, 20, 61, 64, 244, 247, 4096};
+
+    for (uint32_t i = 0; i < sizeof(chunk_lens) / sizeof(chunk_lens[0]); i++) {
+        uint32_t crc = 0;
+
+        for (uint32_t offset = 0; offset < sizeof(data); offset += chunk_lens[i]) {
+            uint32_t len = sizeof(data) - offset;
+
+            if (len > chunk_lens[i]) {
+                len = chunk_lens[i];
+            }
+            crc = nrf_dfu_crc32_update(crc, &data[offset], len);
+        }
+
+        TEST_CHECK_EQUAL(whole, crc);
+    }
+}
+
+
+static void test_empty_update_keeps_crc(void) {
+    uint32_t crc = nrf_dfu_crc32_update(0, "123456789", 9);
+
+    TEST_CHECK_EQUAL(crc, nrf_dfu_crc32_update(crc, "", 0));
+}
+
+
+int main(void) {
+    printf("nrf_dfu_crc32 (NRF_DFU_CRC32_SLICE_BY_4=%d)\n", NRF_DFU_CRC32_SLICE_BY_4);
+
+    TEST_RUN(test_known_vectors);
+    TEST_RUN(test_matches_reference);
+    TEST_RUN(test_chunked_update);
+    TEST_RUN(test_empty_update_keeps_crc);
+
+    return 0;
+}
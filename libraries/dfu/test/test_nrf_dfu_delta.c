@@ -0,0 +1,350 @@
+#include "nrf_dfu_delta.h"
+
+#include "sdk_common.h"
+#include "nrf_dfu_settings.h"
+#include "test_util.h"
+
+#define APP_SIZE        8192
+#define OUT_MAX_LEN     8192
+
+uint8_t            g_test_app[APP_SIZE];    /**< Installed application, see stubs/nrf_dfu_types.h. */
+nrf_dfu_settings_t s_dfu_settings;
+
+static uint8_t  m_out[OUT_MAX_LEN];         /**< Reconstructed data received from the decoder. */
+static uint32_t m_out_len;
+static uint32_t m_out_chunk_max;            /**< Longest single call of the output function. */
+static uint32_t m_room;                     /**< Room reported to the decoder. */
+
+
+static void output(uint8_t const *p_data, uint32_t len) {
+    TEST_CHECK(len <= m_room);
+    TEST_CHECK((m_out_len + len) <= sizeof(m_out));
+
+    memcpy(&m_out[m_out_len], p_data, len);
+    m_out_len += len;
+    m_out_chunk_max = MAX(m_out_chunk_max, len);
+    m_room -= len;
+}
+
+
+static uint32_t room_get(void) {
+    return m_room;
+}
+
+
+static void setup(uint32_t max_len) {
+    for (uint32_t i = 0; i < sizeof(g_test_app); i++) {
+        g_test_app[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    s_dfu_settings.bank_0.bank_code = NRF_DFU_BANK_VALID_APP;
+    s_dfu_settings.bank_0.image_size = APP_SIZE;
+
+    nrf_dfu_delta_init(output, room_get);
+    TEST_CHECK_EQUAL(NRF_SUCCESS, nrf_dfu_delta_reset(max_len));
+
+    m_out_len = 0;
+    m_out_chunk_max = 0;
+    m_room = UINT32_MAX;
+}
+
+
+/**@brief Function for encoding a COPY or ADD command header. */
+static uint32_t cmd_encode(uint8_t op, uint32_t offset, uint32_t len, uint8_t *p_out) {
+    p_out[0] = op;
+    (void)uint32_encode(offset, &p_out[1]);
+    (void)uint32_encode(len, &p_out[5]);
+    return 9;
+}
+
+
+/**@brief Function for encoding an INSERT command header. */
+static uint32_t insert_encode(uint32_t len, uint8_t *p_out) {
+    p_out[0] = NRF_DFU_DELTA_OP_INSERT;
+    (void)uint32_encode(len, &p_out[1]);
+    return 5;
+}
+
+
+static void test_copy_in_page_chunks(void) {
+    uint8_t  patch[9];
+    uint32_t patch_len = cmd_encode(NRF_DFU_DELTA_OP_COPY, 100, 3000, patch);
+
+    setup(3000);
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(3000, m_out_len);
+    TEST_CHECK_MEMORY(&g_test_app[100], m_out, 3000);
+    TEST_CHECK(m_out_chunk_max <= CODE_PAGE_SIZE);
+}
+
+
+static void test_add_insert_copy(void) {
+    uint8_t  patch[64];
+    uint8_t  expected[16];
+    uint32_t patch_len = 0;
+
+    // ADD four bytes at 10, INSERT three, COPY five from the end of the application.
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_ADD, 10, 4, &patch[patch_len]);
+    for (uint32_t i = 0; i < 4; i++) {
+        patch[patch_len++] = (uint8_t)(0xF0 + i);
+    }
+    patch_len += insert_encode(3, &patch[patch_len]);
+    memcpy(&patch[patch_len], "xyz", 3);
+    patch_len += 3;
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, APP_SIZE - 5, 5, &patch[patch_len]);
+
+    setup(12);
+    for (uint32_t i = 0; i < 4; i++) {
+        expected[i] = (uint8_t)(g_test_app[10 + i] + 0xF0 + i);
+    }
+    memcpy(&expected[4], "xyz", 3);
+    memcpy(&expected[7], &g_test_app[APP_SIZE - 5], 5);
+
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(12, m_out_len);
+    TEST_CHECK_MEMORY(expected, m_out, 12);
+
+    // The same patch one byte at a time.
+    setup(12);
+    for (uint32_t i = 0; i < patch_len; i++) {
+        TEST_CHECK_EQUAL(1, nrf_dfu_delta_decode(&patch[i], 1));
+    }
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(12, m_out_len);
+    TEST_CHECK_MEMORY(expected, m_out, 12);
+}
+
+
+static void test_zero_length_commands(void) {
+    uint8_t  patch[32];
+    uint32_t patch_len = 0;
+
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, APP_SIZE, 0, &patch[patch_len]);
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_ADD, 0, 0, &patch[patch_len]);
+    patch_len += insert_encode(0, &patch[patch_len]);
+
+    setup(0);
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(0, m_out_len);
+}
+
+
+static void test_source_out_of_range(void) {
+    uint8_t  patch[9];
+    uint32_t patch_len;
+
+    // One byte past the end of the application.
+    setup(100);
+    patch_len = cmd_encode(NRF_DFU_DELTA_OP_COPY, APP_SIZE - 4, 5, patch);
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(0, m_out_len);
+
+    // An offset that wraps the length check.
+    setup(100);
+    patch_len = cmd_encode(NRF_DFU_DELTA_OP_ADD, 0xFFFFFFF0, 0x20, patch);
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(0, m_out_len);
+}
+
+
+static void test_exceeds_object(void) {
+    uint8_t  patch[32];
+    uint32_t patch_len = 0;
+
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, 0, 8, &patch[patch_len]);
+    patch_len += insert_encode(3, &patch[patch_len]);
+    memcpy(&patch[patch_len], "abc", 3);
+    patch_len += 3;
+
+    setup(10);
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(8, m_out_len);
+}
+
+
+static void test_invalid_bank(void) {
+    uint8_t  patch[18];
+    uint32_t patch_len = 0;
+
+    setup(100);
+    s_dfu_settings.bank_0.bank_code = NRF_DFU_BANK_INVALID;
+    TEST_CHECK_EQUAL(NRF_ERROR_INVALID_STATE, nrf_dfu_delta_reset(100));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+
+    // The application is invalidated while the patch is being applied.
+    setup(100);
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, 0, 4, &patch[patch_len]);
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, 4, 4, &patch[patch_len]);
+    TEST_CHECK_EQUAL(9, nrf_dfu_delta_decode(patch, 9));
+    TEST_CHECK_EQUAL(4, m_out_len);
+    s_dfu_settings.bank_0.bank_code = NRF_DFU_BANK_INVALID;
+    TEST_CHECK_EQUAL(9, nrf_dfu_delta_decode(&patch[9], 9));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(4, m_out_len);
+}
+
+
+static void test_unknown_command(void) {
+    static uint8_t const patch[] = {0x03, 0x00, 0x00, 0x00, 0x00};
+
+    setup(100);
+    TEST_CHECK_EQUAL(sizeof(patch), nrf_dfu_delta_decode(patch, sizeof(patch)));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(0, m_out_len);
+
+    // Nothing more is accepted until the next reset.
+    TEST_CHECK_EQUAL(1, nrf_dfu_delta_decode(patch, 1));
+    TEST_CHECK(nrf_dfu_delta_is_failed());
+}
+
+
+static void test_stall_on_copy(void) {
+    uint8_t  patch[9];
+    uint32_t patch_len = cmd_encode(NRF_DFU_DELTA_OP_COPY, 0, 2500, patch);
+
+    setup(2500);
+    m_room = 0;
+
+    // The header is taken, the copy waits for room.
+    TEST_CHECK_EQUAL(patch_len, nrf_dfu_delta_decode(patch, patch_len));
+    TEST_CHECK_EQUAL(0, m_out_len);
+
+    m_room = 700;
+    TEST_CHECK_EQUAL(0, nrf_dfu_delta_decode(NULL, 0));
+    TEST_CHECK_EQUAL(700, m_out_len);
+
+    m_room = UINT32_MAX;
+    TEST_CHECK_EQUAL(0, nrf_dfu_delta_decode(NULL, 0));
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(2500, m_out_len);
+    TEST_CHECK_MEMORY(g_test_app, m_out, 2500);
+    TEST_CHECK(m_out_chunk_max <= CODE_PAGE_SIZE);
+}
+
+
+static void test_stall_on_add_and_insert(void) {
+    uint8_t  patch[64];
+    uint32_t patch_len = 0;
+    uint32_t consumed;
+
+    patch_len += cmd_encode(NRF_DFU_DELTA_OP_ADD, 0, 4, &patch[patch_len]);
+    memset(&patch[patch_len], 1, 4);
+    patch_len += 4;
+    patch_len += insert_encode(4, &patch[patch_len]);
+    memcpy(&patch[patch_len], "abcd", 4);
+    patch_len += 4;
+
+    setup(8);
+    m_room = 2;
+    consumed = nrf_dfu_delta_decode(patch, patch_len);
+    TEST_CHECK_EQUAL(9 + 2, consumed);
+    TEST_CHECK_EQUAL(2, m_out_len);
+
+    m_room = 4;
+    consumed += nrf_dfu_delta_decode(&patch[consumed], patch_len - consumed);
+    TEST_CHECK_EQUAL(9 + 4 + 5 + 2, consumed);
+    TEST_CHECK_EQUAL(6, m_out_len);
+
+    m_room = UINT32_MAX;
+    consumed += nrf_dfu_delta_decode(&patch[consumed], patch_len - consumed);
+    TEST_CHECK_EQUAL(patch_len, consumed);
+    TEST_CHECK(!nrf_dfu_delta_is_failed());
+    TEST_CHECK_EQUAL(8, m_out_len);
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK_EQUAL((uint8_t)(g_test_app[i] + 1), m_out[i]);
+    }
+    TEST_CHECK_MEMORY("abcd", &m_out[4], 4);
+}
+
+
+static void test_random_patch_with_stalls(void) {
+    static uint8_t expected[OUT_MAX_LEN];
+    static uint8_t patch[2 * OUT_MAX_LEN];
+    uint32_t expected_len = 0;
+    uint32_t patch_len = 0;
+    uint32_t seed = 4711;
+    uint32_t pos = 0;
+    uint32_t pending = 0;
+
+    setup(0);
+
+    while (expected_len < (OUT_MAX_LEN - 2048)) {
+        uint32_t len;
+        uint32_t offset;
+
+        seed = seed * 1103515245 + 12345;
+        len = 1 + ((seed >> 16) % 2000);
+        offset = (seed >> 4) % (APP_SIZE - len);
+
+        switch ((seed >> 28) % 3) {
+            case 0:
+                patch_len += cmd_encode(NRF_DFU_DELTA_OP_COPY, offset, len, &patch[patch_len]);
+                memcpy(&expected[expected_len], &g_test_app[offset], len);
+                break;
+
+            case 1:
+                len = MIN(len, 60);
+                patch_len += cmd_encode(NRF_DFU_DELTA_OP_ADD, offset, len, &patch[patch_len]);
+                for (uint32_t i = 0; i < len; i++) {
+                    patch[patch_len++] = (uint8_t)i;
+                    expected[expected_len + i] = (uint8_t)(g_test_app[offset + i] + i);
+                }
+                break;
+
+            default:
+                len = MIN(len, 100);
+                patch_len += insert_encode(len, &patch[patch_len]);
+                for (uint32_t i = 0; i < len; i++) {
+                    patch[patch_len++] = (uint8_t)(seed >> (i % 24));
+                    expected[expected_len + i] = (uint8_t)(seed >> (i % 24));
+                }
+                break;
+        }
+        expected_len += len;
+    }
+
+    TEST_CHECK_EQUAL(NRF_SUCCESS, nrf_dfu_delta_reset(expected_len));
+
+    // Packets of the transport, with the output taking a random amount in between. Whatever the
+    // decoder leaves is passed again ahead of the next packet.
+    while ((pos < patch_len) || (pending > 0) || (m_out_len < expected_len)) {
+        uint32_t pkt_len;
+
+        seed = seed * 1103515245 + 12345;
+        pkt_len = MIN(patch_len - pos, 1 + ((seed >> 16) % 20));
+        pending += pkt_len;
+        pos += pkt_len;
+
+        m_room = ((seed >> 8) % 3 == 0) ? 0 : (seed >> 4) % 1500;
+
+        pending -= nrf_dfu_delta_decode(&patch[pos - pending], pending);
+        TEST_CHECK(!nrf_dfu_delta_is_failed());
+    }
+
+    TEST_CHECK_EQUAL(expected_len, m_out_len);
+    TEST_CHECK_MEMORY(expected, m_out, expected_len);
+    TEST_CHECK(m_out_chunk_max <= CODE_PAGE_SIZE);
+}
+
+
+int main(void) {
+    printf("nrf_dfu_delta\n");
+
+    TEST_RUN(test_copy_in_page_chunks);
+    TEST_RUN(test_add_insert_copy);
+    TEST_RUN(test_zero_length_commands);
+    TEST_RUN(test_source_out_of_range);
+    TEST_RUN(test_exceeds_object);
+    TEST_RUN(test_invalid_bank);
+    TEST_RUN(test_unknown_command);
+    TEST_RUN(test_stall_on_copy);
+    TEST_RUN(test_stall_on_add_and_insert);
+    TEST_RUN(test_random_patch_with_stalls);
+
+    return 0;
+}
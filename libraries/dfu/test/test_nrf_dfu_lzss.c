@@ -0,0 +1,277 @@
+#include "nrf_dfu_lzss.h"
+
+#include "sdk_common.h"
+#include "test_util.h"
+
+#define OUT_MAX_LEN     8192
+
+static uint8_t  m_out[OUT_MAX_LEN];     /**< Decompressed data received from the decoder. */
+static uint32_t m_out_len;
+static uint32_t m_room;                 /**< Room reported to the decoder. */
+
+
+static void output(uint8_t const *p_data, uint32_t len) {
+    TEST_CHECK(len <= m_room);
+    TEST_CHECK((m_out_len + len) <= sizeof(m_out));
+
+    memcpy(&m_out[m_out_len], p_data, len);
+    m_out_len += len;
+    m_room -= len;
+}
+
+
+static uint32_t room_get(void) {
+    return m_room;
+}
+
+
+static void setup(uint32_t max_len) {
+    nrf_dfu_lzss_init(output, room_get);
+    nrf_dfu_lzss_reset(max_len);
+    m_out_len = 0;
+    m_room = UINT32_MAX;
+}
+
+
+/**@brief Function for compressing data in the format of nrf_dfu_lzss.h, greedy longest match. */
+static uint32_t compress(uint8_t const *p_in, uint32_t len, uint8_t *p_out) {
+    uint32_t out_len = 0;
+    uint32_t flags_index = 0;
+    uint32_t token = 8;
+    uint32_t pos = 0;
+
+    while (pos < len) {
+        uint32_t best_len = 0;
+        uint32_t best_dist = 0;
+
+        if (token == 8) {
+            flags_index = out_len++;
+            p_out[flags_index] = 0;
+            token = 0;
+        }
+
+        for (uint32_t dist = 1; (dist <= NRF_DFU_LZSS_WINDOW_SIZE) && (dist <= pos); dist++) {
+            uint32_t match_len = 0;
+
+            while ((match_len < NRF_DFU_LZSS_MAX_MATCH) && ((pos + match_len) < len) &&
+                   (p_in[pos + match_len] == p_in[pos + match_len - dist])) {
+                match_len++;
+            }
+            if (match_len > best_len) {
+                best_len = match_len;
+                best_dist = dist;
+            }
+        }
+
+        if (best_len >= NRF_DFU_LZSS_MIN_MATCH) {
+            p_out[out_len++] = (uint8_t)(best_dist - 1);
+            p_out[out_len++] = (uint8_t)(best_len - NRF_DFU_LZSS_MIN_MATCH);
+            pos += best_len;
+        }
+        else {
+            p_out[flags_index] |= (uint8_t)(1 << token);
+            p_out[out_len++] = p_in[pos++];
+        }
+        token++;
+    }
+
+    return out_len;
+}
+
+
+static void test_literals_and_match(void) {
+    // Three literals, then a match of nine bytes three back.
+    static uint8_t const stream[] = {0x07, 'a', 'b', 'c', 0x02, 0x06};
+
+    setup(12);
+    TEST_CHECK_EQUAL(sizeof(stream), nrf_dfu_lzss_decode(stream, sizeof(stream)));
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(12, m_out_len);
+    TEST_CHECK_MEMORY("abcabcabcabc", m_out, 12);
+}
+
+
+static void test_longest_run(void) {
+    // One literal, then the longest match at distance one.
+    static uint8_t const stream[] = {0x01, 'x', 0x00, 0xFF};
+
+    setup(1 + NRF_DFU_LZSS_MAX_MATCH);
+    TEST_CHECK_EQUAL(sizeof(stream), nrf_dfu_lzss_decode(stream, sizeof(stream)));
+    TEST_CHECK_EQUAL(1 + NRF_DFU_LZSS_MAX_MATCH, m_out_len);
+    for (uint32_t i = 0; i < m_out_len; i++) {
+        TEST_CHECK_EQUAL('x', m_out[i]);
+    }
+}
+
+
+static void test_match_before_start_reads_zeros(void) {
+    static uint8_t const stream[] = {0x00, 0x00, 0x00};
+    static uint8_t const zeros[3] = {0};
+
+    setup(3);
+    m_out[0] = 0xAA;
+    (void)nrf_dfu_lzss_decode(stream, sizeof(stream));
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(3, m_out_len);
+    TEST_CHECK_MEMORY(zeros, m_out, 3);
+}
+
+
+static void test_tokens_split_across_packets(void) {
+    // The fifth token of the group is a literal again.
+    static uint8_t const stream[] = {0x17, 'a', 'b', 'c', 0x02, 0x06, '!'};
+
+    setup(13);
+    for (uint32_t i = 0; i < sizeof(stream); i++) {
+        TEST_CHECK_EQUAL(1, nrf_dfu_lzss_decode(&stream[i], 1));
+    }
+    TEST_CHECK_EQUAL(13, m_out_len);
+    TEST_CHECK_MEMORY("abcabcabcabc!", m_out, 13);
+}
+
+
+static void test_literal_exceeds_object(void) {
+    static uint8_t const stream[] = {0xFF, 'a', 'b', 'c', 'd'};
+
+    setup(3);
+    TEST_CHECK_EQUAL(sizeof(stream), nrf_dfu_lzss_decode(stream, sizeof(stream)));
+    TEST_CHECK(nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(3, m_out_len);
+
+    // Nothing more is output until the next reset.
+    TEST_CHECK_EQUAL(2, nrf_dfu_lzss_decode(stream, 2));
+    TEST_CHECK_EQUAL(3, m_out_len);
+
+    nrf_dfu_lzss_reset(4);
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(sizeof(stream), nrf_dfu_lzss_decode(stream, sizeof(stream)));
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(7, m_out_len);
+}
+
+
+static void test_match_exceeds_object(void) {
+    static uint8_t const stream[] = {0x07, 'a', 'b', 'c', 0x02, 0x06};
+
+    setup(11);
+    TEST_CHECK_EQUAL(sizeof(stream), nrf_dfu_lzss_decode(stream, sizeof(stream)));
+    TEST_CHECK(nrf_dfu_lzss_is_failed());
+    TEST_CHECK(m_out_len <= 11);
+}
+
+
+static void test_stall_on_literal(void) {
+    static uint8_t const stream[] = {0x07, 'a', 'b', 'c', 0x02, 0x06};
+    uint32_t consumed;
+
+    setup(12);
+    m_room = 2;
+
+    // The flag byte and two literals fit.
+    consumed = nrf_dfu_lzss_decode(stream, sizeof(stream));
+    TEST_CHECK_EQUAL(3, consumed);
+    TEST_CHECK_EQUAL(2, m_out_len);
+
+    // Still no room, nothing is consumed.
+    TEST_CHECK_EQUAL(0, nrf_dfu_lzss_decode(&stream[consumed], sizeof(stream) - consumed));
+
+    m_room = UINT32_MAX;
+    TEST_CHECK_EQUAL(sizeof(stream) - consumed, nrf_dfu_lzss_decode(&stream[consumed], sizeof(stream) - consumed));
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(12, m_out_len);
+    TEST_CHECK_MEMORY("abcabcabcabc", m_out, 12);
+}
+
+
+static void test_stall_on_match(void) {
+    static uint8_t const stream[] = {0x07, 'a', 'b', 'c', 0x02, 0x06};
+    uint32_t consumed;
+
+    setup(12);
+    m_room = 3 + 8;
+
+    // The match of nine bytes does not fit, its length byte is left unconsumed.
+    consumed = nrf_dfu_lzss_decode(stream, sizeof(stream));
+    TEST_CHECK_EQUAL(5, consumed);
+    TEST_CHECK_EQUAL(3, m_out_len);
+
+    m_room = 9;
+    TEST_CHECK_EQUAL(1, nrf_dfu_lzss_decode(&stream[consumed], sizeof(stream) - consumed));
+    TEST_CHECK_EQUAL(0, m_room);
+    TEST_CHECK_EQUAL(12, m_out_len);
+    TEST_CHECK_MEMORY("abcabcabcabc", m_out, 12);
+}
+
+
+static void test_round_trip_with_stalls(void) {
+    static uint8_t data[6000];
+    static uint8_t stream[2 * sizeof(data)];
+    uint32_t stream_len;
+    uint32_t seed = 12345;
+    uint32_t pos = 0;
+    uint32_t pending = 0;
+
+    // Phrases repeated from the window mixed with noise, like code.
+    for (uint32_t i = 0; i < sizeof(data); ) {
+        uint32_t chunk_len;
+        uint32_t dist;
+
+        seed = seed * 1103515245 + 12345;
+        chunk_len = MIN(sizeof(data) - i, 4 + ((seed >> 16) % 40));
+        dist = 1 + ((seed >> 8) % 256);
+
+        for (uint32_t j = 0; j < chunk_len; j++, i++) {
+            if (((seed >> 28) < 4) || (i < dist)) {
+                seed = seed * 1103515245 + 12345;
+                data[i] = (uint8_t)(seed >> 16);
+            }
+            else {
+                data[i] = data[i - dist];
+            }
+        }
+    }
+
+    stream_len = compress(data, sizeof(data), stream);
+    TEST_CHECK(stream_len < sizeof(data));
+
+    setup(sizeof(data));
+
+    // Packets of the transport, with the output taking a random amount in between. Whatever the
+    // decoder leaves is passed again ahead of the next packet.
+    while ((pos < stream_len) || (pending > 0)) {
+        uint32_t pkt_len;
+
+        seed = seed * 1103515245 + 12345;
+        pkt_len = MIN(stream_len - pos, 1 + ((seed >> 16) % 20));
+        pending += pkt_len;
+        pos += pkt_len;
+
+        m_room = (seed >> 8) % 3 == 0 ? 0 : (seed >> 4) % 300;
+        if (pos == stream_len) {
+            m_room = UINT32_MAX;
+        }
+
+        pending -= nrf_dfu_lzss_decode(&stream[pos - pending], pending);
+    }
+
+    TEST_CHECK(!nrf_dfu_lzss_is_failed());
+    TEST_CHECK_EQUAL(sizeof(data), m_out_len);
+    TEST_CHECK_MEMORY(data, m_out, sizeof(data));
+}
+
+
+int main(void) {
+    printf("nrf_dfu_lzss\n");
+
+    TEST_RUN(test_literals_and_match);
+    TEST_RUN(test_longest_run);
+    TEST_RUN(test_match_before_start_reads_zeros);
+    TEST_RUN(test_tokens_split_across_packets);
+    TEST_RUN(test_literal_exceeds_object);
+    TEST_RUN(test_match_exceeds_object);
+    TEST_RUN(test_stall_on_literal);
+    TEST_RUN(test_stall_on_match);
+    TEST_RUN(test_round_trip_with_stalls);
+
+    return 0;
+}
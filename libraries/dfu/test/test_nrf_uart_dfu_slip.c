@@ -0,0 +1,261 @@
+/* The SLIP decoder and the ring buffers are static, the transport is compiled into the test. */
+#include "nrf_uart_dfu.c"
+
+#include "test_util.h"
+
+#define FRAMES_MAX      8
+#define TXD_MAX_LEN     64
+
+static uint8_t  m_frames[FRAMES_MAX][NRF_UART_DFU_MTU];    /**< Frames passed to the request parser. */
+static uint32_t m_frame_lens[FRAMES_MAX];
+static uint32_t m_frame_count;
+
+static uint8_t  m_txd[TXD_MAX_LEN];                         /**< Bytes written to TXD. */
+static uint32_t m_txd_len;
+
+static uint32_t m_sched_count;                              /**< Number of scheduled decoding runs. */
+
+
+void nrf_dfu_serial_init(nrf_dfu_serial_t           *p_serial,
+                         nrf_dfu_transport_t const  *p_transport,
+                         nrf_dfu_serial_rsp_func_t   rsp_func,
+                         uint16_t                    mtu) {
+    p_serial->p_transport = p_transport;
+    p_serial->rsp_func = rsp_func;
+    p_serial->mtu = mtu;
+}
+
+
+void nrf_dfu_serial_on_packet(nrf_dfu_serial_t *p_serial, uint8_t const *p_data, uint32_t len) {
+    TEST_CHECK(p_serial == &m_serial);
+    TEST_CHECK(len <= p_serial->mtu);
+    TEST_CHECK(m_frame_count < FRAMES_MAX);
+
+    memcpy(m_frames[m_frame_count], p_data, len);
+    m_frame_lens[m_frame_count] = len;
+    m_frame_count++;
+}
+
+
+void test_uart_txd_set(uint8_t byte) {
+    TEST_CHECK(m_txd_len < sizeof(m_txd));
+
+    m_txd[m_txd_len++] = byte;
+}
+
+
+uint32_t app_sched_event_put(void *p_event_data, uint16_t event_size, app_sched_event_handler_t handler) {
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+    TEST_CHECK(handler == rx_handler);
+
+    m_sched_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id) {
+    UNUSED_PARAMETER(timer_id);
+    return NRF_SUCCESS;
+}
+
+
+static void setup(void) {
+    TEST_CHECK_EQUAL(NRF_SUCCESS, uart_dfu_transport_init(NULL));
+
+    m_frame_count = 0;
+    m_txd_len = 0;
+    m_sched_count = 0;
+}
+
+
+static void decode(uint8_t const *p_data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        slip_decode(p_data[i]);
+    }
+}
+
+
+/**@brief Function for receiving bytes through the UART interrupt path and decoding them. */
+static void receive(uint8_t const *p_data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        rx_put(p_data[i]);
+    }
+    rx_schedule();
+
+    rx_handler(NULL, 0);
+}
+
+
+static void test_plain_frame(void) {
+    static uint8_t const in[] = {0x09, 0x01, 0x02, SLIP_BYTE_END};
+    static uint8_t const expected[] = {0x09, 0x01, 0x02};
+
+    setup();
+    decode(in, sizeof(in));
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(sizeof(expected), m_frame_lens[0]);
+    TEST_CHECK_MEMORY(expected, m_frames[0], sizeof(expected));
+    TEST_CHECK_EQUAL(0, uart_dfu_rx_dropped_get());
+}
+
+
+static void test_escapes(void) {
+    static uint8_t const in[] =
+    {
+        SLIP_BYTE_ESC, SLIP_BYTE_ESC_END, 0x01, SLIP_BYTE_ESC, SLIP_BYTE_ESC_ESC,
+        SLIP_BYTE_ESC_END, SLIP_BYTE_ESC_ESC, SLIP_BYTE_END
+    };
+    static uint8_t const expected[] =
+    {
+        SLIP_BYTE_END, 0x01, SLIP_BYTE_ESC, SLIP_BYTE_ESC_END, SLIP_BYTE_ESC_ESC
+    };
+
+    setup();
+    decode(in, sizeof(in));
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(sizeof(expected), m_frame_lens[0]);
+    TEST_CHECK_MEMORY(expected, m_frames[0], sizeof(expected));
+}
+
+
+static void test_empty_frames_ignored(void) {
+    static uint8_t const in[] = {SLIP_BYTE_END, SLIP_BYTE_END, 0x09, SLIP_BYTE_END, SLIP_BYTE_END};
+
+    setup();
+    decode(in, sizeof(in));
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(1, m_frame_lens[0]);
+    TEST_CHECK_EQUAL(0x09, m_frames[0][0]);
+}
+
+
+static void test_bad_escape_drops_frame(void) {
+    static uint8_t const in[] =
+    {
+        0x01, 0x02, SLIP_BYTE_ESC, 0x03, 0x04, SLIP_BYTE_END,
+        0x05, SLIP_BYTE_END
+    };
+
+    setup();
+    decode(in, sizeof(in));
+
+    // The bytes before the bad escape and the byte after it, then one more until the END byte.
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(1, m_frame_lens[0]);
+    TEST_CHECK_EQUAL(0x05, m_frames[0][0]);
+    TEST_CHECK_EQUAL(4, uart_dfu_rx_dropped_get());
+}
+
+
+static void test_longest_frame(void) {
+    static uint8_t in[NRF_UART_DFU_MTU];
+
+    setup();
+    for (uint32_t i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i & 0x7F);
+    }
+    decode(in, sizeof(in));
+    slip_decode(SLIP_BYTE_END);
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(NRF_UART_DFU_MTU, m_frame_lens[0]);
+    TEST_CHECK_MEMORY(in, m_frames[0], sizeof(in));
+}
+
+
+static void test_oversized_frame_dropped(void) {
+    static uint8_t in[NRF_UART_DFU_MTU + 2];
+
+    setup();
+    memset(in, 0x11, sizeof(in));
+    decode(in, sizeof(in));
+    slip_decode(SLIP_BYTE_END);
+
+    TEST_CHECK_EQUAL(0, m_frame_count);
+    TEST_CHECK_EQUAL(sizeof(in), uart_dfu_rx_dropped_get());
+
+    // The decoder is back in sync after the END byte.
+    decode((uint8_t const[]){0x09, SLIP_BYTE_END}, 2);
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(1, m_frame_lens[0]);
+}
+
+
+static void test_lost_bytes_drop_frame(void) {
+    static uint8_t const first[] = {0x01, 0x02, SLIP_BYTE_END};
+    static uint8_t const second[] = {0x03, SLIP_BYTE_END};
+    uint8_t fill[NRF_UART_DFU_RX_BUF_SIZE];
+
+    setup();
+    memset(fill, 0x11, sizeof(fill));
+
+    // The ring buffer holds one byte less than its size, the last byte of the fill is lost.
+    for (uint32_t i = 0; i < sizeof(first); i++) {
+        rx_put(first[i]);
+    }
+    for (uint32_t i = 0; i < (NRF_UART_DFU_RX_BUF_SIZE - sizeof(first)); i++) {
+        rx_put(fill[i]);
+    }
+    TEST_CHECK_EQUAL(1, m_rx_overruns);
+    TEST_CHECK(m_rx_break);
+
+    rx_schedule();
+    TEST_CHECK_EQUAL(1, m_sched_count);
+    rx_handler(NULL, 0);
+
+    TEST_CHECK_EQUAL(1, m_frame_count);
+    TEST_CHECK_EQUAL(2, m_frame_lens[0]);
+
+    // The frame the lost byte belongs to is discarded at its END byte, the next one goes through.
+    receive((uint8_t const[]){SLIP_BYTE_END}, 1);
+    TEST_CHECK_EQUAL(1, m_frame_count);
+
+    receive(second, sizeof(second));
+    TEST_CHECK_EQUAL(2, m_frame_count);
+    TEST_CHECK_EQUAL(1, m_frame_lens[1]);
+    TEST_CHECK_EQUAL(0x03, m_frames[1][0]);
+
+    // One lost byte, the partial frame and the invalid byte of the break marker.
+    TEST_CHECK_EQUAL(1 + (NRF_UART_DFU_RX_BUF_SIZE - 1 - sizeof(first)) + 1, uart_dfu_rx_dropped_get());
+}
+
+
+static void test_response_encoding(void) {
+    static uint8_t const rsp[] = {0x60, SLIP_BYTE_END, SLIP_BYTE_ESC, 0x01};
+    static uint8_t const expected[] =
+    {
+        0x60, SLIP_BYTE_ESC, SLIP_BYTE_ESC_END, SLIP_BYTE_ESC, SLIP_BYTE_ESC_ESC, 0x01, SLIP_BYTE_END
+    };
+
+    setup();
+    response_send(rsp, sizeof(rsp));
+
+    // One byte per TXDRDY event.
+    while (m_tx_busy) {
+        tx_next();
+    }
+
+    TEST_CHECK_EQUAL(sizeof(expected), m_txd_len);
+    TEST_CHECK_MEMORY(expected, m_txd, sizeof(expected));
+}
+
+
+int main(void) {
+    printf("nrf_uart_dfu SLIP\n");
+
+    TEST_RUN(test_plain_frame);
+    TEST_RUN(test_escapes);
+    TEST_RUN(test_empty_frames_ignored);
+    TEST_RUN(test_bad_escape_drops_frame);
+    TEST_RUN(test_longest_frame);
+    TEST_RUN(test_oversized_frame_dropped);
+    TEST_RUN(test_lost_bytes_drop_frame);
+    TEST_RUN(test_response_encoding);
+
+    return 0;
+}
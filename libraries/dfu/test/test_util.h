@@ -0,0 +1,70 @@
+#ifndef TEST_UTIL_H__
+#define TEST_UTIL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**@brief Minimal assertion helpers for the host unit tests.
+ *
+ * @details A failed check prints its location and ends the test program with a non-zero exit
+ *          code, so make stops at the first broken test.
+ */
+
+#define TEST_CHECK(cond)                                                                    \
+    do {                                                                                    \
+        if (!(cond)) {                                                                      \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_CHECK_EQUAL(expected, actual)                                                  \
+    do {                                                                                    \
+        unsigned long long exp_ = (unsigned long long)(expected);                           \
+        unsigned long long act_ = (unsigned long long)(actual);                             \
+        if (exp_ != act_) {                                                                 \
+            printf("%s:%d: %s: expected 0x%llx, got 0x%llx\n", __FILE__, __LINE__,          \
+                   #actual, exp_, act_);                                                    \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_CHECK_MEMORY(p_expected, p_actual, len)                                        \
+    do {                                                                                    \
+        if (memcmp((p_expected), (p_actual), (len)) != 0) {                                 \
+            printf("%s:%d: %s differs from %s\n", __FILE__, __LINE__,                       \
+                   #p_actual, #p_expected);                                                 \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_RUN(test)                                                                      \
+    do {                                                                                    \
+        test();                                                                             \
+        printf("  %s: ok\n", #test);                                                        \
+    } while (0)
+
+/**@brief Runs a test in a child process, for modules whose static state cannot be reset. */
+#define TEST_RUN_FORKED(test)                                                               \
+    do {                                                                                    \
+        int   status_;                                                                      \
+        pid_t pid_;                                                                         \
+        fflush(stdout);                                                                     \
+        pid_ = fork();                                                                      \
+        if (pid_ == 0) {                                                                    \
+            test();                                                                         \
+            fflush(stdout);                                                                 \
+            _exit(0);                                                                       \
+        }                                                                                   \
+        if ((pid_ < 0) || (waitpid(pid_, &status_, 0) != pid_) ||                           \
+            !WIFEXITED(status_) || (WEXITSTATUS(status_) != 0)) {                           \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #test);                        \
+            exit(1);                                                                        \
+        }                                                                                   \
+        printf("  %s: ok\n", #test);                                                        \
+    } while (0)
+
+#endif // TEST_UTIL_H__
@@ -5,16 +5,25 @@
 #include "sdk_macros.h"
 #include "ble_srv_common.h"
 #include "nrf_dfu_settings.h"
+#include "app_util.h"
 #include "bootloader_secret.h"
 #include "app_timer.h"
 #include "sensor_timer.h"
 
 #if FAMILY == 52
 #include "nrf_fstorage.h"
+#else
+#include "nrf_dfu_settings_ext.h"
 #endif
 
 #define MAX_CTRL_POINT_RESP_PARAM_LEN 3
 
+// Queued writes are not supported, every command must fit into one write at the default ATT MTU.
+STATIC_ASSERT(BLE_DFU_SET_TIMEOUT_LEN <= (GATT_MTU_SIZE_DEFAULT - 3));
+#if FAMILY == 51
+STATIC_ASSERT((NRF_DFU_TIMEOUT_MAX_MS / BLE_DFU_TIMEOUT_UNIT_MS) <= UINT16_MAX);
+#endif
+
 #define REBOOT_TIMEOUT APP_TIMER_TICKS_COMPAT(500, APP_TIMER_PRESCALER)
 
 ble_dfu_t *p_m_dfu;
@@ -168,6 +177,7 @@ uint32_t ble_dfu_init(ble_dfu_t *p_dfu, const ble_dfu_init_t *p_dfu_init) {
     VERIFY_SUCCESS(err_code);
     
     nrf_dfu_settings_init();
+    nrf_dfu_settings_ext_init();
     #else
     nrf_dfu_settings_init(true);
     #endif
@@ -206,6 +216,36 @@ static void resp_send(ble_dfu_t *p_dfu, ble_dfu_buttonless_op_code_t op_code, bl
 
 
 
+#if FAMILY == 51
+/**@brief Function for storing a timeout in the bootloader timeout policy.
+ *
+ * @param[in]   reason      Timeout reason, see @ref nrf_dfu_timeout_reason_t.
+ * @param[in]   timeout_ms  Timeout in milliseconds.
+ *
+ * @return      Response code to send to the peer.
+ */
+static ble_dfu_rsp_code_t set_timeout(uint8_t reason, uint32_t timeout_ms) {
+    if (!nrf_dfu_settings_ext_timeout_is_valid((nrf_dfu_timeout_reason_t)reason, timeout_ms)) {
+        return DFU_RSP_INVALID_PARAMETER;
+    }
+
+    // Spare the flash page if nothing changes.
+    if (s_dfu_settings_ext.timeout_ms[reason] == timeout_ms) {
+        return DFU_RSP_SUCCESS;
+    }
+
+    NRF_LOG_INFO("setting bootloader timeout %d to %d ms\n", reason, timeout_ms);
+    s_dfu_settings_ext.timeout_ms[reason] = timeout_ms;
+
+    if (nrf_dfu_settings_ext_policy_write(NULL) != NRF_SUCCESS) {
+        return DFU_RSP_OPERATION_FAILED;
+    }
+
+    return DFU_RSP_SUCCESS;
+}
+#endif
+
+
 /**@brief Handle write events to the Location and Navigation Service Control Point characteristic.
  *
  * @param[in]   p_dfu         DFU Service structure.
@@ -240,6 +280,21 @@ static void on_ctrlpt_write(ble_dfu_t *p_dfu, ble_gatts_evt_write_t const *p_evt
 
     // Start executing the control point write action
 
+    if ((p_evt_write->len == BLE_DFU_SET_TIMEOUT_LEN)
+        && (memcmp(p_evt_write->data, bootloader_secret, BLE_DFU_SECRET_LEN) == 0)
+        && (p_evt_write->data[BLE_DFU_SECRET_LEN] == DFU_OP_SET_TIMEOUT)) {
+#if FAMILY == 51
+        rsp_code = set_timeout(p_evt_write->data[BLE_DFU_SECRET_LEN + 1],
+            uint16_decode(&p_evt_write->data[BLE_DFU_SECRET_LEN + 2]) * (uint32_t)BLE_DFU_TIMEOUT_UNIT_MS);
+#else
+        // The timeout policy lives in the extended settings of the nRF51 bootloader.
+        rsp_code = DFU_RSP_OP_CODE_NOT_SUPPORTED;
+#endif
+
+        resp_send(p_dfu, DFU_OP_SET_TIMEOUT, rsp_code);
+        return;
+    }
+
     rsp_code = DFU_RSP_OP_CODE_NOT_SUPPORTED;
     uint8_t first = p_evt_write->data[0];
 
@@ -13,6 +13,10 @@ extern "C" {
 
 #define BLE_DFU_ENTER_BOOTLOADER 0x01
 
+#define BLE_DFU_SECRET_LEN      16                          /**< Length of the bootloader secret that starts every control point write. */
+#define BLE_DFU_SET_TIMEOUT_LEN (BLE_DFU_SECRET_LEN + 4)    /**< Length of a set timeout write, see @ref DFU_OP_SET_TIMEOUT. Fits into one write at the default ATT MTU. */
+#define BLE_DFU_TIMEOUT_UNIT_MS 100                         /**< Unit of the timeout in a set timeout write. */
+
     typedef enum {
         BLE_DFU_EVT_ENTERING_BOOTLOADER,   /**< Event indicating that the bootloader will be entered after return of this event.*/
         BLE_DFU_EVT_INDICATION_ENABLED,    /**< Indication that the control point is enabled.*/
@@ -36,6 +40,7 @@ extern "C" {
         DFU_RSP_RESERVED = 0x00,                                        /**< Reserved for future use. */
         DFU_RSP_SUCCESS = 0x01,                                        /**< Success. */
         DFU_RSP_OP_CODE_NOT_SUPPORTED = 0x02,                                        /**< Op Code not supported. */
+        DFU_RSP_INVALID_PARAMETER = 0x03,                                        /**< Invalid parameter. */
         DFU_RSP_OPERATION_FAILED = 0x04,                                        /**< Operation Failed. */
         DFU_RSP_CCCD_CONFIG_IMPROPER = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR /**< CCCD is improperly configured. */
     } ble_dfu_rsp_code_t;
@@ -45,6 +50,7 @@ extern "C" {
     {
         DFU_OP_RESERVED = 0x00, /**< Reserved for future use. */
         DFU_OP_ENTER_BOOTLOADER = 0x01, /**< Enter bootloader. */
+        DFU_OP_SET_TIMEOUT = 0x02, /**< Store a timeout in the bootloader timeout policy. The write is the secret (16 bytes), this op code, the timeout reason (1 byte, nrf_dfu_timeout_reason_t) and the timeout in units of @ref BLE_DFU_TIMEOUT_UNIT_MS (2 bytes, little endian). */
         DFU_OP_RESPONSE_CODE = 0x20  /**< Response code. */
     } ble_dfu_buttonless_op_code_t;
 